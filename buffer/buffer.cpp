@@ -1,23 +1,35 @@
-#include <buffer.h>
+#include "buffer.h"
 
-// 构造函数
-Buffer::Buffer(int initBufferSize) : buffer_(initBufferSize), readPos_(0),writePos_(0)
+// 没有持有内存块时Peek/BeginWrite指向这里，可读可写长度都是0
+static char EMPTY_BUFFER[1];
+
+// 构造函数：不预先分配，第一次写入时才从池里取块
+Buffer::Buffer(int initBufferSize) : buffer_(nullptr), cap_(0),
+    hint_(initBufferSize > 0 ? initBufferSize : BufferPool::MIN_BLOCK), readPos_(0), writePos_(0) {}
+
+Buffer::~Buffer(){
+    Release_();
+}
 
 //  可写字长
-size_t Buffer::WritableBytes() cost{
-    return buffer_.size()-writePos_;
+size_t Buffer::WritableBytes() const{
+    return cap_ - writePos_;
 }
 
 // 可读的数量：写下标 - 读下标
 size_t Buffer::ReadableBytes() const{
-    return writePos_-readPos_;
+    return writePos_ - readPos_;
 }
 
-// 可预留空间：已经度过的就没用了，等于读下标
-size_t Buffer::PrependableBytes() const(){
+// 可预留空间：已经读过的就没用了，等于读下标
+size_t Buffer::PrependableBytes() const{
     return readPos_;
 }
 
+const char* Buffer::Peek() const{
+    return BeginPtr_() + readPos_;
+}
+
 // 确保可写的长度
 void Buffer::EnsureWriteable(size_t len){
     if(len > WritableBytes()){
@@ -26,22 +38,31 @@ void Buffer::EnsureWriteable(size_t len){
     assert(len <= WritableBytes());
 }
 
-// 移动下标，在Append中使用
+// 移动写下标，在Append中使用
+void Buffer::HasWritten(size_t len){
+    assert(len <= WritableBytes());
+    writePos_ += len;
+}
+
+// 移动读下标；数据全部取走时把块还给池
 void Buffer::Retrieve(size_t len){
+    assert(len <= ReadableBytes());
     readPos_ += len;
+    if(readPos_ == writePos_){
+        Release_();
+    }
 }
 
-// 读取len长度，移动读下标
+// 读取到end为止的数据，移动读下标
 void Buffer::RetrieveUntil(const char* end){
-    assert(Peek()<= end );
+    assert(Peek() <= end);
     Retrieve(end - Peek());
 }
 
-// 取出所有数据，buffer归零，读写下标归零,在别的函数中会用到
+// 取出所有数据，读写下标归零，内存块还给池
 void Buffer::RetrieveAll(){
-    bzero(&buffer_[0],Buffer_.size());
-    readPos_=writePos_=0;
-} 
+    Release_();
+}
 
 // 取出剩余可读的str
 std::string Buffer::RetrieveAllToStr(){
@@ -52,52 +73,70 @@ std::string Buffer::RetrieveAllToStr(){
 
 // 写指针位置
 const char* Buffer::BeginWriteConst() const{
-    return &buffer_[writePos_];
+    return BeginPtr_() + writePos_;
 }
 
 char* Buffer::BeginWrite(){
-    return &buffer_[writePos_];
+    return BeginPtr_() + writePos_;
+}
+
+void Buffer::Append(const std::string& str){
+    Append(str.data(),str.size());
 }
 
 // 添加str到缓存区
 void Buffer::Append(const char* str,size_t len){
+    if(len == 0){
+        return;
+    }
     assert(str);
     EnsureWriteable(len);
     std::copy(str,str+len,BeginWrite());
     HasWritten(len);
 }
 
-void Append(const void* data,size_t len){
+void Buffer::Append(const void* data,size_t len){
     Append(static_cast<const char*>(data),len);
 }
 
-// 将buffer中的读下标的地方放到该buffer中的写下标位置
+void Buffer::Append(const Buffer& buff){
+    Append(buff.Peek(),buff.ReadableBytes());
+}
+
+// 直接读进池里的块，不经过栈上的中转数组；块被读满说明socket里可能还有数据，
+// 换大一级的块接着读，到最大级别为止，剩下的留给下一次读事件
 ssize_t Buffer::ReadFd(int fd,int* Errno){
-    char buff[65535];
-    struct iovec iov[2];
-    size_t writeable = WritableBytes();
-    iov[0].iov_base = BeginWrite();
-    iov[0].iov_len = writeable;
-    iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
-
-    ssize_t len = readv(fd,iov,2);
-    if( len < 0 ){
-        *Errno = errno;
-    } else if(static_cast<size_t>(len) <= writeable){
+    ssize_t total = 0;
+    while(true){
+        if(WritableBytes() == 0){
+            EnsureWriteable(cap_ > 0 ? cap_ : hint_);
+        }
+        size_t writable = WritableBytes();
+        ssize_t len = read(fd,BeginWrite(),writable);
+        if(len < 0){
+            if(total == 0){
+                *Errno = errno;
+                total = -1;
+            }
+            break;
+        }
         writePos_ += len;
-    }else{
-        writePos_ = buffer_.size();
-        Append(buff,static_cast<size_t>(len-writeable));
+        total += len;
+        if(len == 0 || static_cast<size_t>(len) < writable || cap_ >= BufferPool::MAX_BLOCK){
+            break;
+        }
     }
-    return len;
+    if(ReadableBytes() == 0){
+        Release_();     // 没读到数据，不占着块
+    }
+    return total;
 }
 
 // 将buffer中可读的区域写入fd中
 ssize_t Buffer::WriteFd(int fd,int* Errno){
-    ssize_t len =write(fd,Peek(),ReadableBytes());
-    if(len<0){
-        *Errno=errno;
+    ssize_t len = write(fd,Peek(),ReadableBytes());
+    if(len < 0){
+        *Errno = errno;
         return len;
     }
     Retrieve(len);
@@ -105,22 +144,46 @@ ssize_t Buffer::WriteFd(int fd,int* Errno){
 }
 
 char* Buffer::BeginPtr_(){
-    return &buffer_[0];
+    return buffer_ ? buffer_ : EMPTY_BUFFER;
 }
 
 const char* Buffer::BeginPtr_() const{
-    return &buffer_[0];
+    return buffer_ ? buffer_ : EMPTY_BUFFER;
 }
 
-// 扩展空间
-void Buffer::MakeSpace_(size len){
-    if(WritableBytes()+ReadableBytes()<len){
-        buffer_.resize(writePos_+len+1);
+// 扩展空间：前面已读的空间够用就把数据挪到开头，否则换一个更大的块
+void Buffer::MakeSpace_(size_t len){
+    size_t readable = ReadableBytes();
+    if(buffer_ && WritableBytes() + PrependableBytes() >= len){
+        std::copy(BeginPtr_() + readPos_,BeginPtr_() + writePos_,BeginPtr_());
     }else{
-        size_t readable=ReadableBytes();
-        std::copy(BeginPtr_()+readPos_,BeginPtr_()+writePos_,BeginPtr_());
-        readPos_ = 0;
-        writePos_ = readble;
-        assert(Readable == ReadableBytes());
+        size_t want = readable + len > hint_ ? readable + len : hint_;
+        size_t cap = 0;
+        char* block = BufferPool::Alloc(want,&cap);
+        if(buffer_){
+            std::copy(BeginPtr_() + readPos_,BeginPtr_() + writePos_,block);
+            BufferPool::Free(buffer_,cap_);
+        }
+        buffer_ = block;
+        cap_ = cap;
+    }
+    readPos_ = 0;
+    writePos_ = readable;
+    assert(readable == ReadableBytes());
+}
+
+// 还块时记下这次需要的大小：用到一半以上的保持这个大小，否则减半，
+// 偶尔的大请求不会让之后的每次读都申请大块
+void Buffer::Release_(){
+    if(buffer_){
+        size_t next = (writePos_ >= cap_ / 2) ? cap_ : cap_ / 2;
+        hint_ = next > BufferPool::MIN_BLOCK ? next : BufferPool::MIN_BLOCK;
+        if(hint_ > BufferPool::MAX_BLOCK){
+            hint_ = BufferPool::MAX_BLOCK;
+        }
+        BufferPool::Free(buffer_,cap_);
+        buffer_ = nullptr;
+        cap_ = 0;
     }
+    readPos_ = writePos_ = 0;
 }
@@ -8,11 +8,17 @@
 #include <atomic>
 #include <assert.h>
 
+#include "bufferpool.h"
 
+// 读写缓冲区：内存取自BufferPool的分级内存块，数据全部取走时立即把块还回去，
+// 空闲的长连接不占用缓冲区内存。可读数据始终连续，解析器可以直接在上面扫描；
+// 空间不够时换更大一级的块，只拷贝尚未读取的数据
 class Buffer{
 public:
     Buffer(int initBufferSize = 1024);
-    ~Buffer() = default;
+    ~Buffer();
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
 
     size_t WritableBytes() const;
     size_t ReadableBytes() const;
@@ -35,18 +41,23 @@ public:
     void Append(const char* str,size_t len);
     void Append(const void* data,size_t len);
     void Append(const Buffer& buff);
-    
+
     ssize_t ReadFd(int fd,int* Errno);
     ssize_t WriteFd(int fd,int* Errno);
 
+    size_t Capacity() const { return cap_; }    // 当前持有的内存，空闲时为0
+
 private:
     char* BeginPtr_();
     const char* BeginPtr_() const;
     void MakeSpace_(size_t len);
+    void Release_();
 
-    std::vector<char> Buffer_;
+    char* buffer_;
+    size_t cap_;
+    size_t hint_;       // 下次申请块的大小：上一次用到的块大小，读大请求体时不用每次从最小块重新长起来
     std::atomic<std::size_t> readPos_;
     std::atomic<std::size_t> writePos_;
-}
+};
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,99 @@
+#include "bufferpool.h"
+
+std::mutex BufferPool::mtx_;
+std::vector<BufferPool::ThreadCache*> BufferPool::caches_;
+long BufferPool::retiredInUse_ = 0;
+
+BufferPool::ThreadCache::ThreadCache(){
+    std::lock_guard<std::mutex> locker(mtx_);
+    caches_.push_back(this);
+}
+
+// 线程退出时把缓存的块还给系统
+BufferPool::ThreadCache::~ThreadCache(){
+    for(int i = 0; i < CLASS_NUM; i++){
+        while(head[i]){
+            FreeBlock* block = head[i];
+            head[i] = block->next;
+            delete[] reinterpret_cast<char*>(block);
+        }
+        count[i] = 0;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    retiredInUse_ += inUse.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < caches_.size(); i++){
+        if(caches_[i] == this){
+            caches_[i] = caches_.back();
+            caches_.pop_back();
+            break;
+        }
+    }
+}
+
+BufferPool::ThreadCache& BufferPool::Cache_(){
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+int BufferPool::ClassOf_(size_t len){
+    int cls = 0;
+    size_t size = MIN_BLOCK;
+    while(size < len){
+        size <<= 1;
+        cls++;
+    }
+    return cls;
+}
+
+char* BufferPool::Alloc(size_t len,size_t* cap){
+    ThreadCache& cache = Cache_();
+    if(len > MAX_BLOCK){
+        *cap = len;
+        cache.inUse.fetch_add(len,std::memory_order_relaxed);
+        return new char[len];
+    }
+    int cls = ClassOf_(len);
+    *cap = MIN_BLOCK << cls;
+    cache.inUse.fetch_add(*cap,std::memory_order_relaxed);
+    if(cache.head[cls]){
+        FreeBlock* block = cache.head[cls];
+        cache.head[cls] = block->next;
+        cache.count[cls]--;
+        cache.cached.fetch_sub(*cap,std::memory_order_relaxed);
+        return reinterpret_cast<char*>(block);
+    }
+    return new char[*cap];
+}
+
+void BufferPool::Free(char* block,size_t cap){
+    ThreadCache& cache = Cache_();
+    cache.inUse.fetch_sub(cap,std::memory_order_relaxed);
+    if(cap > MAX_BLOCK){
+        delete[] block;
+        return;
+    }
+    int cls = ClassOf_(cap);
+    if((cache.count[cls] + 1) * cap > MAX_CACHED){
+        delete[] block;
+        return;
+    }
+    FreeBlock* node = reinterpret_cast<FreeBlock*>(block);
+    node->next = cache.head[cls];
+    cache.head[cls] = node;
+    cache.count[cls]++;
+    cache.cached.fetch_add(cap,std::memory_order_relaxed);
+}
+
+BufferPool::Stats BufferPool::GetStats(){
+    std::lock_guard<std::mutex> locker(mtx_);
+    long inUse = retiredInUse_;
+    long cached = 0;
+    for(ThreadCache* cache : caches_){
+        inUse += cache->inUse.load(std::memory_order_relaxed);
+        cached += cache->cached.load(std::memory_order_relaxed);
+    }
+    Stats stats;
+    stats.inUse = static_cast<size_t>(inUse);
+    stats.cached = static_cast<size_t>(cached);
+    return stats;
+}
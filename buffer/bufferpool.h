@@ -0,0 +1,52 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Buffer的内存块池：块大小按4KB、8KB...128KB分级，每个线程每级一条空闲链表，
+// 分配和归还只访问本线程的链表，不加锁；块在一个线程分配、另一个线程归还也没关系，
+// 只是挪到了归还线程的链表上。每级缓存的空闲块有上限，多出来的直接释放。
+// 超过最大级别的请求直接new/delete。统计也按线程计数，GetStats时再汇总
+class BufferPool {
+public:
+    static const size_t MIN_BLOCK = 4096;
+    static const int CLASS_NUM = 6;
+    static const size_t MAX_BLOCK = MIN_BLOCK << (CLASS_NUM - 1);
+    static const size_t MAX_CACHED = 1 << 20;   // 每个线程每级最多缓存的空闲字节数
+
+    struct Stats {
+        size_t inUse;       // 被Buffer持有的字节数
+        size_t cached;      // 各线程空闲链表里的字节数
+    };
+
+    // 返回至少len字节的块，*cap为实际大小
+    static char* Alloc(size_t len, size_t* cap);
+    static void Free(char* block, size_t cap);
+    static Stats GetStats();
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct ThreadCache {
+        ThreadCache();
+        ~ThreadCache();
+        FreeBlock* head[CLASS_NUM] = {};
+        size_t count[CLASS_NUM] = {};
+        // 只有本线程写，块可能在别的线程归还，所以inUse可以是负数
+        std::atomic<long> inUse{0};
+        std::atomic<long> cached{0};
+    };
+
+    static int ClassOf_(size_t len);
+    static ThreadCache& Cache_();
+
+    static std::mutex mtx_;
+    static std::vector<ThreadCache*> caches_;
+    static long retiredInUse_;      // 已退出线程的inUse
+};
+
+#endif //BUFFER_POOL_H
@@ -0,0 +1,194 @@
+#include "bodyreader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../log/log.h"
+
+using namespace std;
+
+const char* BodyStore::tmpDir = "/tmp";
+
+void BodyStore::Clear(){
+    if(fd_ >= 0){
+        close(fd_);
+        fd_ = -1;
+    }
+    mem_.clear();
+    size_ = 0;
+}
+
+bool BodyStore::OnData(const char* data,size_t len){
+    mem_.append(data,len);
+    size_ += len;
+    if(mem_.size() < SPILL_SIZE){
+        return true;
+    }
+    if(fd_ < 0 && !Spill_()){
+        return false;
+    }
+    return Flush_();
+}
+
+bool BodyStore::OnEnd(){
+    return fd_ < 0 || Flush_();
+}
+
+// 优先用O_TMPFILE，不产生目录项；文件系统不支持时退回mkstemp后立即unlink
+bool BodyStore::Spill_(){
+#ifdef O_TMPFILE
+    fd_ = open(tmpDir,O_TMPFILE | O_RDWR | O_CLOEXEC,0600);
+#endif
+    if(fd_ < 0){
+        string path = string(tmpDir) + "/webserver-body-XXXXXX";
+        fd_ = mkostemp(&path[0],O_CLOEXEC);
+        if(fd_ >= 0){
+            unlink(path.c_str());
+        }
+    }
+    if(fd_ < 0){
+        LOG_ERROR("Create body spill file in %s failed, errno:%d",tmpDir,errno);
+        return false;
+    }
+    LOG_DEBUG("Body spilled to temp file");
+    return true;
+}
+
+bool BodyStore::Flush_(){
+    const char* p = mem_.data();
+    size_t left = mem_.size();
+    while(left > 0){
+        ssize_t len = write(fd_,p,left);
+        if(len < 0){
+            if(errno == EINTR) continue;
+            LOG_ERROR("Write body spill file failed, errno:%d",errno);
+            return false;
+        }
+        p += len;
+        left -= len;
+    }
+    mem_.clear();
+    return true;
+}
+
+void BodyReader::Init(size_t length,bool chunked,size_t maxBody){
+    state_ = chunked ? CHUNK_SIZE : (length > 0 ? LENGTH : FINISH);
+    remain_ = chunked ? 0 : length;
+    received_ = 0;
+    maxBody_ = maxBody;
+    lineLen_ = digits_ = trailerLen_ = 0;
+}
+
+// 正文部分整段交给sink，只有chunk大小行、分隔CRLF和trailer逐字节处理
+BodyReader::STATUS BodyReader::Feed(const char* begin,const char* end,BodySink* sink,size_t* used){
+    const char* p = begin;
+    STATUS status = NEED_MORE;
+    while(p < end && state_ != FINISH && status == NEED_MORE){
+        if(state_ == LENGTH || state_ == CHUNK_DATA){
+            size_t len = static_cast<size_t>(end - p) < remain_ ? end - p : remain_;
+            if(!sink->OnData(p,len)){
+                status = BAD;
+                break;
+            }
+            p += len;
+            remain_ -= len;
+            received_ += len;
+            if(remain_ == 0){
+                state_ = (state_ == LENGTH) ? FINISH : CHUNK_DATA_CR;
+            }
+            continue;
+        }
+        char ch = *p++;
+        switch(state_){
+        case CHUNK_SIZE:
+            if(++lineLen_ > MAX_CHUNK_LINE){
+                status = BAD;
+            }else if(ch == ';' || ch == ' ' || ch == '\t'){
+                state_ = CHUNK_EXT;
+            }else if(ch == '\r'){
+                state_ = CHUNK_SIZE_LF;
+            }else if(ch == '\n'){
+                status = EndChunkLine_();
+            }else{
+                int v = (ch >= '0' && ch <= '9') ? ch - '0' :
+                        (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 :
+                        (ch >= 'A' && ch <= 'F') ? ch - 'A' + 10 : -1;
+                if(v < 0 || remain_ > (SIZE_MAX >> 4)){
+                    status = BAD;
+                }else{
+                    remain_ = (remain_ << 4) | v;
+                    digits_++;
+                }
+            }
+            break;
+        case CHUNK_EXT:     // chunk扩展直接忽略
+            if(++lineLen_ > MAX_CHUNK_LINE){
+                status = BAD;
+            }else if(ch == '\n'){
+                status = EndChunkLine_();
+            }
+            break;
+        case CHUNK_SIZE_LF:
+            status = (ch == '\n') ? EndChunkLine_() : BAD;
+            break;
+        case CHUNK_DATA_CR:
+            if(ch == '\r'){
+                state_ = CHUNK_DATA_LF;
+            }else if(ch == '\n'){
+                state_ = CHUNK_SIZE;
+            }else{
+                status = BAD;
+            }
+            break;
+        case CHUNK_DATA_LF:
+            if(ch == '\n'){
+                state_ = CHUNK_SIZE;
+            }else{
+                status = BAD;
+            }
+            break;
+        case TRAILER:       // trailer头不使用，读到空行为止
+            if(++trailerLen_ > MAX_TRAILER){
+                status = BAD;
+            }else if(ch == '\n'){
+                if(lineLen_ == 0){
+                    state_ = FINISH;
+                }
+                lineLen_ = 0;
+            }else if(ch != '\r'){
+                lineLen_++;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    *used = p - begin;
+    if(status != NEED_MORE){
+        return status;
+    }
+    if(state_ == FINISH){
+        return sink->OnEnd() ? DONE : BAD;
+    }
+    return NEED_MORE;
+}
+
+// chunk大小行结束：大小为0进入trailer，否则先检查总长度再接收数据
+BodyReader::STATUS BodyReader::EndChunkLine_(){
+    if(digits_ == 0){
+        return BAD;
+    }
+    lineLen_ = digits_ = 0;
+    if(remain_ == 0){
+        state_ = TRAILER;
+        return NEED_MORE;
+    }
+    if(remain_ > maxBody_ || received_ + remain_ > maxBody_){
+        return TOO_LARGE;
+    }
+    state_ = CHUNK_DATA;
+    return NEED_MORE;
+}
@@ -0,0 +1,92 @@
+#ifndef BODY_READER_H
+#define BODY_READER_H
+
+#include <string>
+#include <string_view>
+#include <stddef.h>
+
+// 请求体的消费者：解码后的正文按到达顺序一片一片交给OnData，
+// 片段直接指向读缓冲区，只在调用期间有效；全部到齐后调用OnEnd
+class BodySink {
+public:
+    virtual ~BodySink() = default;
+    virtual bool OnData(const char* data, size_t len) = 0;  // false: 中止请求
+    virtual bool OnEnd() { return true; }
+    virtual bool TooLarge() const { return false; }         // 中止是因为超过了sink自己的大小限制
+};
+
+// 默认的请求体存储：小请求体留在内存里；超过SPILL_SIZE后转存到匿名临时文件，
+// 之后内存只作为写文件的缓冲，不随请求体增长
+class BodyStore : public BodySink {
+public:
+    static const size_t SPILL_SIZE = 64 << 10;
+    static const char* tmpDir;
+
+    BodyStore() : fd_(-1), size_(0) {}
+    ~BodyStore() override { Clear(); }
+    BodyStore(const BodyStore&) = delete;
+    BodyStore& operator=(const BodyStore&) = delete;
+
+    void Clear();
+    bool OnData(const char* data, size_t len) override;
+    bool OnEnd() override;
+
+    size_t Size() const { return size_; }
+    bool Spilled() const { return fd_ >= 0; }
+    std::string_view Data() const { return Spilled() ? std::string_view() : std::string_view(mem_); }
+    int Fd() const { return fd_; }     // 转存后的临时文件，用pread读取
+
+private:
+    bool Spill_();
+    bool Flush_();
+
+    std::string mem_;
+    int fd_;
+    size_t size_;
+};
+
+// 请求体分帧：按Content-Length或chunked传输编码增量解码，数据可以任意切分到达。
+// 每次Feed消费掉的字节可以立即从读缓冲区取走，读缓冲区里只留尚未解码的部分
+class BodyReader {
+public:
+    enum STATUS {
+        NEED_MORE,
+        DONE,
+        BAD,            // 格式错误
+        TOO_LARGE,      // 超过maxBody
+    };
+
+    static const size_t MAX_CHUNK_LINE = 1024;      // chunk大小行（含扩展）的最大长度
+    static const size_t MAX_TRAILER = 8192;
+
+    BodyReader() { Init(0, false, 0); }
+
+    void Init(size_t length, bool chunked, size_t maxBody);
+    STATUS Feed(const char* begin, const char* end, BodySink* sink, size_t* used);
+    size_t Received() const { return received_; }
+
+private:
+    enum STATE {
+        LENGTH,
+        CHUNK_SIZE,
+        CHUNK_EXT,
+        CHUNK_SIZE_LF,
+        CHUNK_DATA,
+        CHUNK_DATA_CR,
+        CHUNK_DATA_LF,
+        TRAILER,
+        FINISH,
+    };
+
+    STATUS EndChunkLine_();
+
+    STATE state_;
+    size_t remain_;         // 当前Content-Length/chunk还剩多少字节
+    size_t received_;       // 已解码的正文字节数
+    size_t maxBody_;
+    size_t lineLen_;        // 当前chunk大小行/trailer行的长度
+    size_t digits_;
+    size_t trailerLen_;
+};
+
+#endif //BODY_READER_H
@@ -0,0 +1,81 @@
+#include "delimscanner.h"
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DELIM_SCANNER_X86 1
+#endif
+
+const char* DelimScanner::FindScalar(const char* begin, const char* end, const char* set, int n) {
+    assert(n >= 1 && n <= 4);
+    for(const char* p = begin; p < end; p++) {
+        for(int i = 0; i < n; i++) {
+            if(*p == set[i]) return p;
+        }
+    }
+    return end;
+}
+
+#ifdef DELIM_SCANNER_X86
+
+const char* DelimScanner::FindSSE2(const char* begin, const char* end, const char* set, int n) {
+    assert(n >= 1 && n <= 4);
+    __m128i needle[4];
+    for(int i = 0; i < n; i++) needle[i] = _mm_set1_epi8(set[i]);
+    const char* p = begin;
+    for(; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_cmpeq_epi8(chunk, needle[0]);
+        for(int i = 1; i < n; i++) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, needle[i]));
+        int mask = _mm_movemask_epi8(hit);
+        if(mask) return p + __builtin_ctz(mask);
+    }
+    return FindScalar(p, end, set, n);
+}
+
+__attribute__((target("avx2")))
+const char* DelimScanner::FindAVX2(const char* begin, const char* end, const char* set, int n) {
+    assert(n >= 1 && n <= 4);
+    __m256i needle[4];
+    for(int i = 0; i < n; i++) needle[i] = _mm256_set1_epi8(set[i]);
+    const char* p = begin;
+    for(; end - p >= 32; p += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_cmpeq_epi8(chunk, needle[0]);
+        for(int i = 1; i < n; i++) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(chunk, needle[i]));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if(mask) return p + __builtin_ctz(mask);
+    }
+    return FindSSE2(p, end, set, n);
+}
+
+DelimScanner::FindFunc DelimScanner::Select_() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return &FindAVX2;
+    return &FindSSE2;
+}
+
+const char* DelimScanner::ImplName() {
+    if(Select_() == &FindAVX2) return "avx2";
+    return "sse2";
+}
+
+#else
+
+const char* DelimScanner::FindSSE2(const char* begin, const char* end, const char* set, int n) {
+    return FindScalar(begin, end, set, n);
+}
+
+const char* DelimScanner::FindAVX2(const char* begin, const char* end, const char* set, int n) {
+    return FindScalar(begin, end, set, n);
+}
+
+DelimScanner::FindFunc DelimScanner::Select_() {
+    return &FindScalar;
+}
+
+const char* DelimScanner::ImplName() {
+    return "scalar";
+}
+
+#endif
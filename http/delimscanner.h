@@ -0,0 +1,27 @@
+#ifndef DELIM_SCANNER_H
+#define DELIM_SCANNER_H
+
+#include <stddef.h>
+
+// 分隔符扫描：在[begin,end)中找第一个属于set（1~4个字符）的字节，找不到返回end。
+// x86上一次比较16(SSE2)/32(AVX2)字节，启动时按CPU特性选择实现；其他平台走逐字节的标量实现。
+// 解析器用它找行尾和请求头冒号，表单解码用它一次跳过普通字符找 = & + %
+class DelimScanner {
+public:
+    static const char* Find(const char* begin, const char* end, const char* set, int n) {
+        static const FindFunc impl = Select_();   // 局部静态，避免静态初始化顺序问题
+        return impl(begin, end, set, n);
+    }
+
+    static const char* FindScalar(const char* begin, const char* end, const char* set, int n);
+    static const char* FindSSE2(const char* begin, const char* end, const char* set, int n);
+    static const char* FindAVX2(const char* begin, const char* end, const char* set, int n);
+
+    static const char* ImplName();
+
+private:
+    typedef const char* (*FindFunc)(const char*, const char*, const char*, int);
+    static FindFunc Select_();
+};
+
+#endif //DELIM_SCANNER_H
@@ -0,0 +1,483 @@
+#include "filecache.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <zlib.h>
+#include "httpresponse.h"
+#include "../log/log.h"
+
+using namespace std;
+
+CachedFile::~CachedFile() {
+    if(addr) munmap(addr, size);
+    if(fd >= 0) close(fd);
+}
+
+FileCache* FileCache::Instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+FileCache::FileCache() : shardBudget_(DEFAULT_BUDGET / SHARD_NUM),
+    smallMax_(DEFAULT_SMALL_MAX), smallBudget_(DEFAULT_SMALL_BUDGET), admitHits_(DEFAULT_ADMIT_HITS),
+    arenaBytes_(0), inotifyFd_(-1), isClose_(true) {}
+
+FileCache::ArenaChunk::ArenaChunk(size_t c, atomic<size_t>* cnt) :
+    data(new char[c]), cap(c), used(0), counter(cnt) {
+    counter->fetch_add(cap);
+}
+
+FileCache::ArenaChunk::~ArenaChunk() {
+    counter->fetch_sub(cap);
+}
+
+FileCache::~FileCache() {
+    Close();
+}
+
+void FileCache::Init(const string& root, size_t budget, size_t smallMax, size_t smallBudget, int admitHits) {
+    Close();
+    root_ = root;
+    if(!root_.empty() && root_.back() == '/') root_.pop_back();  // 请求路径自带前导'/'
+    shardBudget_ = budget / SHARD_NUM;
+    smallMax_ = smallMax;
+    smallBudget_ = smallBudget;
+    admitHits_ = admitHits;
+    Clear();
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd_ < 0) {
+        // 没有失效通知就不能安全地缓存，预算置零使每次都重新加载
+        LOG_WARN("FileCache: inotify_init1 failed, errno:%d, cache disabled", errno);
+        shardBudget_ = 0;
+        return;
+    }
+    WatchTree_("");
+    isClose_ = false;
+    watchThread_ = thread(&FileCache::WatchLoop_, this);
+}
+
+void FileCache::Close() {
+    if(!isClose_.exchange(true) && watchThread_.joinable()) {
+        watchThread_.join();
+        Stats s = GetStats();
+        LOG_INFO("FileCache hits:%llu misses:%llu smallHits:%llu admitted:%llu arena:%zu",
+                 (unsigned long long)s.hits, (unsigned long long)s.misses,
+                 (unsigned long long)s.smallHits, (unsigned long long)s.admitted, s.arenaBytes);
+    }
+    if(inotifyFd_ >= 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    lock_guard<mutex> locker(wdMtx_);
+    wdDir_.clear();
+}
+
+FileCache::Shard& FileCache::ShardOf_(const string& path) {
+    return shards_[hash<string>()(path) % SHARD_NUM];
+}
+
+// 含"//"、"/."的路径和资源文件的真实路径对不上，收不到针对它的失效事件，不进缓存
+bool FileCache::Cacheable_(const string& path) {
+    return path.find("//") == string::npos && path.find("/.") == string::npos;
+}
+
+// 命中时移到LRU表头并计数，需持有shard.mtx
+FileCache::FilePtr FileCache::Hit_(Shard& shard, const string& path) {
+    auto it = shard.index.find(path);
+    if(it == shard.index.end()) {
+        return nullptr;
+    }
+    Entry& entry = *it->second;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    shard.hits++;
+    if(!entry.file->blob && ++entry.hits >= admitHits_) {
+        if(Admit_(entry)) {
+            shard.admitted++;
+        } else {
+            entry.hits = -ADMIT_BACKOFF;    // 不合格或预算已满，隔一段时间再试，避免每次命中都去抢arenaMtx_
+        }
+    }
+    if(entry.file->blob) shard.smallHits++;
+    return entry.file;
+}
+
+// 事件循环线程用来判断能否就地响应，未命中不计数，由之后的Get计
+FileCache::FilePtr FileCache::Find(const string& path) {
+    Shard& shard = ShardOf_(path);
+    lock_guard<mutex> locker(shard.mtx);
+    return Hit_(shard, path);
+}
+
+FileCache::FilePtr FileCache::Get(const string& path) {
+    Shard& shard = ShardOf_(path);
+    uint64_t gen;
+    {
+        lock_guard<mutex> locker(shard.mtx);
+        FilePtr hit = Hit_(shard, path);
+        if(hit) {
+            return hit;
+        }
+        shard.misses++;
+        gen = shard.gen;
+    }
+
+    // 未命中：在锁外打开和映射文件
+    FilePtr file = Load_(path);
+    size_t charge = file->size + sizeof(CachedFile) + path.size();
+    if(file->gzip && file->gzip->blob) charge += file->gzip->blobLen;   // 内存里压缩出来的变体
+    if(!Cacheable_(path) || charge > shardBudget_ / 4) {
+        return file;    // 超大文件不占缓存，响应发完即释放
+    }
+
+    lock_guard<mutex> locker(shard.mtx);
+    if(shard.gen != gen) return file;
+    auto it = shard.index.find(path);
+    if(it != shard.index.end()) {
+        return it->second->file;    // 其他线程已经加载好了
+    }
+    shard.lru.push_front({path, file, charge, 0});
+    shard.index[path] = shard.lru.begin();
+    shard.bytes += charge;
+    Evict_(shard);
+    return file;
+}
+
+// 只映射会进缓存的文件；更大的文件只保留fd，用sendfile按偏移发送，不为一次请求映射整个文件
+std::shared_ptr<CachedFile> FileCache::Open_(const string& full) const {
+    shared_ptr<CachedFile> file = make_shared<CachedFile>();
+    if(stat(full.c_str(), &file->st) < 0 || S_ISDIR(file->st.st_mode)) {
+        file->status = CachedFile::NOT_FOUND;
+        return file;
+    }
+    if(!(file->st.st_mode & S_IROTH)) {
+        file->status = CachedFile::FORBIDDEN;
+        return file;
+    }
+    file->fd = open(full.c_str(), O_RDONLY | O_CLOEXEC);
+    if(file->fd < 0) {
+        file->status = (errno == EACCES) ? CachedFile::FORBIDDEN : CachedFile::NOT_FOUND;
+        return file;
+    }
+    file->status = CachedFile::OK;
+    file->size = file->st.st_size;
+    if(file->size > 0 && file->size <= shardBudget_ / 4) {
+        void* addr = mmap(nullptr, file->size, PROT_READ, MAP_SHARED, file->fd, 0);
+        file->addr = (addr == MAP_FAILED) ? nullptr : static_cast<char*>(addr);
+    }
+    return file;
+}
+
+// 请求路径直接拼在root_后面，含".."段（解码后的%2e%2e也在内）或'\0'的路径可能逃出根目录，一律拒绝
+bool FileCache::SafePath_(const string& path) {
+    if(path.empty() || path[0] != '/' || path.find('\0') != string::npos) return false;
+    for(size_t begin = 1; begin <= path.size(); ) {
+        size_t end = path.find('/', begin);
+        if(end == string::npos) end = path.size();
+        if(end - begin == 2 && path[begin] == '.' && path[begin + 1] == '.') return false;
+        begin = end + 1;
+    }
+    return true;
+}
+
+FileCache::FilePtr FileCache::Load_(const string& path) const {
+    if(!SafePath_(path)) {
+        LOG_WARN("FileCache: reject path %s", path.c_str());
+        shared_ptr<CachedFile> file = make_shared<CachedFile>();
+        file->status = CachedFile::FORBIDDEN;
+        return file;
+    }
+    string full = root_ + path;
+    shared_ptr<CachedFile> file = Open_(full);
+    if(!file->Ok()) return file;
+    file->mime = HttpResponse::FileType(path);
+    file->etag = MakeETag_(file->st, "");
+    file->cacheControl = CacheControlFor_(path);
+    char date[64];
+    struct tm tm;
+    gmtime_r(&file->st.st_mtime, &tm);
+    file->lastModified.assign(date, strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm));
+    if(Compressible_(file->mime)) {
+        file->br = OpenVariant_(path, ".br", "br", *file);
+        file->gzip = OpenVariant_(path, ".gz", "gzip", *file);
+        // 只压缩能进缓存的文件，否则每次加载都要重新压缩
+        if(!file->gzip && file->size >= MIN_COMPRESS && file->size <= MAX_COMPRESS &&
+           file->size <= shardBudget_ / 4) {
+            file->gzip = Gzip_(*file);
+        }
+    }
+    BuildHeader_(file.get(), nullptr, file->gzip || file->br);
+    LOG_DEBUG("FileCache load %s, size:%d, gzip:%d, br:%d", full.c_str(), (int)file->size,
+              file->gzip != nullptr, file->br != nullptr);
+    return file;
+}
+
+// 预压缩的兄弟文件比原文件旧时视为过期，不使用
+shared_ptr<CachedFile> FileCache::OpenVariant_(const string& path, const char* suffix,
+                                               const char* encoding, const CachedFile& origin) const {
+    shared_ptr<CachedFile> file = Open_(root_ + path + suffix);
+    if(!file->Ok() || file->st.st_mtime < origin.st.st_mtime) return nullptr;
+    file->mime = origin.mime;
+    file->etag = MakeETag_(file->st, suffix);     // 兄弟文件单独变化时ETag也要变
+    file->lastModified = origin.lastModified;
+    file->cacheControl = origin.cacheControl;
+    BuildHeader_(file.get(), encoding, true);
+    return file;
+}
+
+// 在内存里压缩一份gzip，header和压缩数据连续存放，和小文件层一样整段发送。
+// 原文用pread读进私有缓冲区，不读共享映射：压缩期间文件被截断也只是读短，不会SIGBUS
+shared_ptr<CachedFile> FileCache::Gzip_(const CachedFile& origin) {
+    string src(origin.size, '\0');
+    if(pread(origin.fd, &src[0], src.size(), 0) != static_cast<ssize_t>(src.size())) {
+        return nullptr;
+    }
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nullptr;
+    }
+    string data(deflateBound(&zs, origin.size), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(&src[0]);
+    zs.avail_in = origin.size;
+    zs.next_out = reinterpret_cast<Bytef*>(&data[0]);
+    zs.avail_out = data.size();
+    int ret = deflate(&zs, Z_FINISH);
+    size_t len = zs.total_out;
+    deflateEnd(&zs);
+    if(ret != Z_STREAM_END || len >= origin.size - origin.size / 10) {
+        return nullptr;     // 压缩不到九成，不值得
+    }
+
+    shared_ptr<CachedFile> file = make_shared<CachedFile>();
+    file->status = CachedFile::OK;
+    file->st = origin.st;
+    file->size = len;
+    file->mime = origin.mime;
+    file->etag = MakeETag_(origin.st, ".gz");     // 内容完全由原文件决定
+    file->lastModified = origin.lastModified;
+    file->cacheControl = origin.cacheControl;
+    BuildHeader_(file.get(), "gzip", true);
+    shared_ptr<string> blob = make_shared<string>();
+    blob->reserve(file->header.size() + len);
+    blob->append(file->header);
+    blob->append(data.data(), len);
+    file->blob = blob->data();
+    file->blobLen = blob->size();
+    file->arena = blob;
+    return file;
+}
+
+bool FileCache::Compressible_(const string& mime) {
+    return mime.compare(0, 5, "text/") == 0 || mime.find("xml") != string::npos ||
+           mime.find("javascript") != string::npos || mime.find("json") != string::npos;
+}
+
+// 200用的header和304用的notModified共用验证相关的头
+void FileCache::BuildHeader_(CachedFile* file, const char* encoding, bool vary) {
+    string common = "ETag: " + file->etag + "\r\nLast-Modified: " + file->lastModified + "\r\n";
+    if(!file->cacheControl.empty()) common += "Cache-Control: " + file->cacheControl + "\r\n";
+    if(vary) common += "Vary: Accept-Encoding\r\n";
+    file->notModified = common + "\r\n";
+    file->header = "Content-type: " + file->mime + "\r\n";
+    if(encoding) file->header += string("Content-Encoding: ") + encoding + "\r\n";
+    else file->header += "Accept-Ranges: bytes\r\n";
+    file->header += common;
+    file->header += "Content-length: " + to_string(file->size) + "\r\n\r\n";
+}
+
+string FileCache::MakeETag_(const struct stat& st, const char* suffix) {
+    char buf[96];
+    unsigned long long mtime = (unsigned long long)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+    int n = snprintf(buf, sizeof(buf), "\"%llx-%llx-%llx%s%s\"", (unsigned long long)st.st_ino,
+                     (unsigned long long)st.st_size, mtime, suffix[0] ? "-" : "", suffix[0] ? suffix + 1 : "");
+    return string(buf, n);
+}
+
+string FileCache::CacheControlFor_(const string& path) const {
+    size_t best = 0;
+    const string* value = nullptr;
+    for(const auto& rule : cacheControl_) {
+        if(rule.first.size() >= best && path.compare(0, rule.first.size(), rule.first) == 0) {
+            best = rule.first.size();
+            value = &rule.second;
+        }
+    }
+    return value ? *value : string();
+}
+
+void FileCache::AddCacheControl(const string& prefix, const string& value) {
+    cacheControl_.emplace_back(prefix, value);
+    Clear();
+}
+
+// 从表尾淘汰直到不超过本片预算；被淘汰的文件若还在发送，由引用计数延后释放
+void FileCache::Evict_(Shard& shard) {
+    while(shard.bytes > shardBudget_ && !shard.lru.empty()) {
+        Entry& victim = shard.lru.back();
+        shard.bytes -= victim.charge;
+        shard.index.erase(victim.path);
+        shard.lru.pop_back();
+    }
+}
+
+// 把热点小文件的header和正文拷进内存块，用新的CachedFile替换条目；
+// 旧条目（映射和fd）在正在发送它的响应结束后释放。
+// 正文用pread读：文件可能已被截断而inotify还没使条目失效，读共享映射越过文件末尾会SIGBUS，
+// pread只会读短，读到的长度不对就放弃接纳（内存块里这段空间随块一起归还）
+bool FileCache::Admit_(Entry& entry) {
+    const CachedFile& old = *entry.file;
+    if(!old.Ok() || old.size > smallMax_ || (old.size > 0 && old.fd < 0)) return false;
+    shared_ptr<CachedFile> file = make_shared<CachedFile>();
+    size_t len = old.header.size() + old.size;
+    char* blob = ArenaAlloc_(len, &file->arena);
+    if(!blob) return false;
+    memcpy(blob, old.header.data(), old.header.size());
+    if(old.size > 0 && pread(old.fd, blob + old.header.size(), old.size, 0) != static_cast<ssize_t>(old.size)) {
+        LOG_WARN("FileCache: %s changed while admitting", entry.path.c_str());
+        return false;
+    }
+    file->status = CachedFile::OK;
+    file->size = old.size;
+    file->st = old.st;
+    file->mime = old.mime;
+    file->header = old.header;
+    file->etag = old.etag;
+    file->lastModified = old.lastModified;
+    file->cacheControl = old.cacheControl;
+    file->notModified = old.notModified;
+    file->gzip = old.gzip;
+    file->br = old.br;
+    file->blob = blob;
+    file->blobLen = len;
+    entry.file = file;
+    return true;
+}
+
+// 在当前块上追加，放不下时开新块；新块会超出小文件层预算时返回nullptr
+char* FileCache::ArenaAlloc_(size_t len, shared_ptr<const void>* owner) {
+    lock_guard<mutex> locker(arenaMtx_);
+    len = (len + 7) & ~static_cast<size_t>(7);
+    if(!arena_ || arena_->cap - arena_->used < len) {
+        size_t cap = len > ARENA_CHUNK ? len : ARENA_CHUNK;
+        if(arenaBytes_.load() + cap > smallBudget_) return nullptr;
+        arena_ = make_shared<ArenaChunk>(cap, &arenaBytes_);
+    }
+    char* p = arena_->data.get() + arena_->used;
+    arena_->used += len;
+    *owner = arena_;
+    return p;
+}
+
+FileCache::Stats FileCache::GetStats() {
+    Stats s = {0, 0, 0, 0, arenaBytes_.load()};
+    for(auto& shard : shards_) {
+        lock_guard<mutex> locker(shard.mtx);
+        s.hits += shard.hits;
+        s.misses += shard.misses;
+        s.smallHits += shard.smallHits;
+        s.admitted += shard.admitted;
+    }
+    return s;
+}
+
+void FileCache::Invalidate(const string& path) {
+    Shard& shard = ShardOf_(path);
+    lock_guard<mutex> locker(shard.mtx);
+    shard.gen++;
+    auto it = shard.index.find(path);
+    if(it == shard.index.end()) return;
+    shard.bytes -= it->second->charge;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+void FileCache::Clear() {
+    for(auto& shard : shards_) {
+        lock_guard<mutex> locker(shard.mtx);
+        shard.gen++;
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+// 递归监视dir及其子目录，dir为相对根目录的路径
+void FileCache::WatchTree_(const string& dir) {
+    const uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                          IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    string full = root_ + dir;
+    int wd = inotify_add_watch(inotifyFd_, full.c_str(), mask);
+    if(wd < 0) {
+        LOG_WARN("FileCache: watch %s failed, errno:%d", full.c_str(), errno);
+        return;
+    }
+    {
+        lock_guard<mutex> locker(wdMtx_);
+        wdDir_[wd] = dir;
+    }
+    DIR* dp = opendir(full.c_str());
+    if(!dp) return;
+    struct dirent* ent;
+    while((ent = readdir(dp)) != nullptr) {
+        if(ent->d_name[0] == '.') continue;
+        string sub = dir + "/" + ent->d_name;
+        struct stat st;
+        if(stat((root_ + sub).c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            WatchTree_(sub);
+        }
+    }
+    closedir(dp);
+}
+
+void FileCache::WatchLoop_() {
+    alignas(struct inotify_event) char buf[16384];
+    struct pollfd pfd = { inotifyFd_, POLLIN, 0 };
+    while(!isClose_) {
+        if(poll(&pfd, 1, 1000) <= 0) continue;     // 超时用来检查isClose_
+        ssize_t len;
+        while((len = read(inotifyFd_, buf, sizeof(buf))) > 0) {
+            for(char* p = buf; p < buf + len; ) {
+                const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + ev->len;
+                if(ev->mask & IN_Q_OVERFLOW) {
+                    Clear();
+                    continue;
+                }
+                string dir;
+                {
+                    lock_guard<mutex> locker(wdMtx_);
+                    auto it = wdDir_.find(ev->wd);
+                    if(it == wdDir_.end()) continue;
+                    dir = it->second;
+                    if(ev->mask & IN_IGNORED) {
+                        wdDir_.erase(it);
+                        continue;
+                    }
+                }
+                if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    Clear();
+                    continue;
+                }
+                if(ev->len == 0) continue;
+                string path = dir + "/" + ev->name;
+                if(ev->mask & IN_ISDIR) {
+                    // 目录被创建/删除/改名：新目录加入监视，目录下缓存的条目一律清掉
+                    if(ev->mask & (IN_CREATE | IN_MOVED_TO)) WatchTree_(path);
+                    Clear();
+                    continue;
+                }
+                Invalidate(path);
+                // 预压缩的兄弟文件变化时，原文件条目上挂的变体也要失效
+                size_t n = path.size();
+                if(n > 3 && path.compare(n - 3, 3, ".gz") == 0) Invalidate(path.substr(0, n - 3));
+                if(n > 3 && path.compare(n - 3, 3, ".br") == 0) Invalidate(path.substr(0, n - 3));
+            }
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <sys/stat.h>
+
+// 缓存的静态文件：打开的fd、stat结果、整个文件的只读映射、MIME类型和预先拼好的
+// "Content-type/Content-length"头部块。通过shared_ptr引用计数，
+// 被淘汰或失效后，仍在发送中的响应持有的引用保证fd和映射在发完之前不会被释放
+struct CachedFile {
+    enum STATUS {
+        OK,
+        NOT_FOUND,      // 不存在或是目录
+        FORBIDDEN,      // 其他用户不可读
+    };
+
+    CachedFile() : status(NOT_FOUND), fd(-1), addr(nullptr), size(0), st(), blob(nullptr), blobLen(0) {}
+    ~CachedFile();
+    CachedFile(const CachedFile&) = delete;
+    CachedFile& operator=(const CachedFile&) = delete;
+
+    bool Ok() const { return status == OK; }
+
+    STATUS status;
+    int fd;
+    char* addr;             // 空文件、大文件或映射失败时为nullptr，此时用fd发送
+    size_t size;
+    struct stat st;
+    std::string mime;
+    std::string header;     // "Content-type: ...\r\nContent-length: ...\r\n\r\n"
+
+    // 缓存验证：强ETag由inode、大小、修改时间生成；notModified是304用的头部块（不含Content-length）
+    std::string etag;
+    std::string lastModified;
+    std::string cacheControl;
+    std::string notModified;
+
+    // 小文件层：header+正文连续存放在共享只读的内存块里，整段用一个iovec发送。
+    // 进入小文件层的条目不再持有fd和映射
+    const char* blob;
+    size_t blobLen;
+    std::shared_ptr<const void> arena;  // 持有blob所在的内存块
+
+    // 压缩变体：优先用同目录下较新的 file.br / file.gz，没有gz时对文本类文件在首次加载时用zlib压缩一份。
+    // 有变体的文件（包括原文件本身）header里都带 Vary: Accept-Encoding
+    std::shared_ptr<const CachedFile> gzip;
+    std::shared_ptr<const CachedFile> br;
+};
+
+// 进程级的静态资源缓存，按请求路径（相对资源根目录）分片加锁，每片一个LRU链表，总字节数有上限。
+// 命中时不做任何文件系统调用；资源目录上的inotify监视线程在文件被修改、删除、改名、
+// 改权限时使对应条目失效，目录本身变化或事件队列溢出时清空整个缓存。
+// 不存在/无权限的结果也会缓存（文件创建或改权限时同样会收到事件）。
+// 不超过smallMax的文件命中次数达到admitHits后进入小文件层：内容拷进连续的内存块，
+// 释放映射和fd；小文件层占用的内存块总量不超过smallBudget，超出时不再接纳新文件
+class FileCache {
+public:
+    typedef std::shared_ptr<const CachedFile> FilePtr;
+
+    static const size_t DEFAULT_BUDGET = 64 << 20;
+    static const size_t DEFAULT_SMALL_MAX = 32 << 10;
+    static const size_t DEFAULT_SMALL_BUDGET = 16 << 20;
+    static const int DEFAULT_ADMIT_HITS = 2;
+
+    struct Stats {
+        uint64_t hits;          // 命中缓存
+        uint64_t misses;        // 未命中，需要访问文件系统
+        uint64_t smallHits;     // 命中且由小文件层直接提供
+        uint64_t admitted;      // 进入小文件层的次数
+        size_t arenaBytes;      // 小文件层已分配的内存
+    };
+
+    static FileCache* Instance();
+
+    void Init(const std::string& root, size_t budget = DEFAULT_BUDGET,
+              size_t smallMax = DEFAULT_SMALL_MAX, size_t smallBudget = DEFAULT_SMALL_BUDGET,
+              int admitHits = DEFAULT_ADMIT_HITS);
+    void Close();
+    Stats GetStats();
+
+    FilePtr Get(const std::string& path);   // path形如"/index.html"，总是返回非空
+    FilePtr Find(const std::string& path);  // 只查缓存，未命中返回空，不访问文件系统
+    // 按路径前缀配置Cache-Control，最长前缀优先；会清空缓存，应在开始服务前调用
+    void AddCacheControl(const std::string& prefix, const std::string& value);
+    void Invalidate(const std::string& path);
+    void Clear();
+
+private:
+    FileCache();
+    ~FileCache();
+
+    static const int SHARD_NUM = 16;
+
+    static const size_t ARENA_CHUNK = 1 << 20;
+    static const size_t MIN_COMPRESS = 256;         // 太小的文件压缩收益抵不过头部开销
+    static const size_t MAX_COMPRESS = 1 << 20;     // 首次加载时同步压缩的上限
+    static const int ADMIT_BACKOFF = 256;
+
+    struct Entry {
+        std::string path;
+        FilePtr file;
+        size_t charge;      // 计入预算的字节数
+        int hits;
+    };
+    struct Shard {
+        std::mutex mtx;
+        std::list<Entry> lru;       // 表头最近使用
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        uint64_t gen = 0;           // 每次失效加一，防止失效前开始的加载把旧内容放回缓存
+        uint64_t hits = 0, misses = 0, smallHits = 0, admitted = 0;    // 在锁内累加，避免共享计数器的缓存行争用
+    };
+    // 只追加的内存块，块上所有blob的引用都释放后整块归还
+    struct ArenaChunk {
+        ArenaChunk(size_t cap, std::atomic<size_t>* counter);
+        ~ArenaChunk();
+        std::unique_ptr<char[]> data;
+        size_t cap;
+        size_t used;
+        std::atomic<size_t>* counter;
+    };
+
+    Shard& ShardOf_(const std::string& path);
+    FilePtr Hit_(Shard& shard, const std::string& path);
+    FilePtr Load_(const std::string& path) const;
+    std::shared_ptr<CachedFile> Open_(const std::string& full) const;
+    std::shared_ptr<CachedFile> OpenVariant_(const std::string& path, const char* suffix,
+                                             const char* encoding, const CachedFile& origin) const;
+    static std::shared_ptr<CachedFile> Gzip_(const CachedFile& origin);
+    static bool Compressible_(const std::string& mime);
+    static void BuildHeader_(CachedFile* file, const char* encoding, bool vary);
+    static std::string MakeETag_(const struct stat& st, const char* suffix);
+    std::string CacheControlFor_(const std::string& path) const;
+    void Evict_(Shard& shard);
+    bool Admit_(Entry& entry);
+    char* ArenaAlloc_(size_t len, std::shared_ptr<const void>* owner);
+    static bool Cacheable_(const std::string& path);
+    static bool SafePath_(const std::string& path);
+
+    void WatchTree_(const std::string& dir);
+    void WatchLoop_();
+
+    std::string root_;
+    std::vector<std::pair<std::string, std::string>> cacheControl_;   // 前缀 -> Cache-Control值
+    size_t shardBudget_;
+    Shard shards_[SHARD_NUM];
+
+    size_t smallMax_;
+    size_t smallBudget_;
+    int admitHits_;
+    std::mutex arenaMtx_;
+    std::shared_ptr<ArenaChunk> arena_;     // 当前追加的块
+    std::atomic<size_t> arenaBytes_;
+
+    int inotifyFd_;
+    std::mutex wdMtx_;
+    std::unordered_map<int, std::string> wdDir_;    // watch描述符 -> 相对目录（根目录为""）
+    std::atomic<bool> isClose_;
+    std::thread watchThread_;
+};
+
+#endif //FILE_CACHE_H
@@ -4,11 +4,19 @@ using namespace std;
 const char* HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+bool HttpConn::zeroCopy;
 
 HttpConn::HttpConn(){
     fd_ = -1;
-    addr_ = {0};
+    addr_ = {};
     isClose_ = true;
+    stage_ = PARSE;
+    respCnt_ = 0;
+    keepAlive_ = false;
+}
+
+HttpConn::~HttpConn(){
+    Close();
 }
 
 void HttpConn::init(int fd,const sockaddr_in& addr){
@@ -16,19 +24,25 @@ void HttpConn::init(int fd,const sockaddr_in& addr){
     userCount++;
     addr_ = addr;
     fd_ = fd;
-    writeBuff_.RetrieveAll();
+    ClearOutput_();
     readBuff_.RetrieveAll();
+    request_.Init();
+    stage_ = PARSE;
+    keepAlive_ = false;
     isClose_ = false;
     LOG_INFO("Client[%d](%s:%d) in,userCount:%d",fd_,GetIP(),GetPort(),(int)userCount);
 }
 
 void HttpConn::Close() {
     response_.UnmapFile();
+    ClearOutput_();
+    request_.Init();    // 关闭时还没收完的上传文件随之删除
+    stage_ = PARSE;
     if(isClose_ == false){
         isClose_ = true;
         userCount--;
-        close(fd_);
         LOG_INFO("Client[%d](%s:%d) quit,UserCount:%d",fd_,GetIP(),GetPort(),(int)userCount);
+        close(fd_);     // 最后关闭：之后loop线程可能立即accept到同一个fd并复用这个对象
     }
 }
 
@@ -56,59 +70,116 @@ ssize_t HttpConn::read(int* saveErrno){
         if(len <= 0){
             break;
         }
-    }while (isET) //ET:边沿触发，要一次性全部读出
+    }while (isET); //ET:边沿触发，要一次性全部读出
     return len;
 }
 
+// 每次调用发出输出链的一部分：连续的内存段一次writev，文件段sendfile，部分发送后下次从断点继续
 ssize_t HttpConn::write(int* saveErrno){
     ssize_t len=-1;
     do{
-        len = writev(fd_,iov_,iovCnt_); //将iov的内容写到fd中
+        len = out_.Write(fd_,saveErrno);
         if(len < 0){
-            *saveErrno =errno;
             break;
         }
-        if(iov_[0].iov_len+ iov_[1].iov_len == 0) break; // 传输结束
-        else if(static_cast<size_t>(len) > iov_[0].iov_len){
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base+(len - iov[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len){
-                writeBuff_.RetrueveAll();
-                iov_[0].iov_len =0;
-            }
-        }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base+len;
-            iov_[0].iov_len -= len;
-            writeBuff_.Retrieve(len);
+        if(out_.Bytes() == 0){
+            ClearOutput_();     // 传输结束，写缓冲区的内存和文件引用立即释放，空闲连接不占内存
+            break;
         }
     }while (isET || ToWriteBytes() > 10240);
     return len;
 }
 
-bool HttpConn::process(){
-    request_.Init();
-    if(readBuff_.ReadableBytes() <= 0){
-        return false;
-    }
-    else if(request_.parse(readBuff_)){
-        LOG_DEBUG("%s",request_.path().c_str());
-        response_.Init(srcDir,request_.path(),request_.IsKeepAlive(),200);
-    }else{
-        response_.Init(srcDir,request_.path(),false,400);
-    }
+// 释放上一轮已写完的响应：响应头和对缓存文件的引用
+void HttpConn::ClearOutput_(){
+    out_.Clear();
+    respCnt_ = 0;
+}
 
-    response_.MakeResponse(writeBuff_); //生成响应报文放入writeBuff_中
-    // 响应头
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ =1;
+// 生成当前请求的响应，头部和分段文本追加到输出链的文本缓冲区，正文各段和文件引用入队
+void HttpConn::AppendResponse_(){
+    Buffer& text = out_.Text();
+    response_.MakeResponse(text);
+    FileCache::FilePtr file = response_.DetachFile();
+    const HttpResponse::BodyPiece* body = response_.Pieces();
+    for(int i = 0; i < response_.PieceCount(); i++){
+        out_.AddText(body[i].textEnd);
+        // 小文件层总是直接发内存；没有映射（大文件、映射失败）时走sendfile
+        const char* mem = nullptr;
+        if(file->blob){
+            mem = body[i].withHeader ? file->blob : file->blob + file->header.size();
+        }else if(!zeroCopy){
+            mem = file->addr;
+        }
+        if(mem){
+            out_.AddMemory(mem + body[i].off,body[i].len);
+        }else{
+            out_.AddFile(file->fd,body[i].off,body[i].len);
+        }
+    }
+    out_.AddText(text.ReadableBytes());     // 正文之后的文本（如multipart结尾）或没有正文的整个响应
+    out_.AddOwner(std::move(file));
+}
 
-    if(response_.FileLen()>0 && response_.File()){
-        iov_[1].iov_base = respnse_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ =2;
+// 流水线：把读缓冲区里已经完整到达的请求全部解析掉，响应按顺序排进同一条输出链，
+// 尽量少的系统调用发出；不完整的请求留在缓冲区等待下一次EPOLLIN
+bool HttpConn::process(bool inlineOnly){
+    if(stage_ == PARSE){
+        ClearOutput_();     // 否则是接着循环线程没处理完的部分，已排进输出链的响应保留
     }
-    LOG_DEBUG("filesize:%d,%d to %d",response_.FileLnen(),iovCnt_,ToWriteBytes());
+    while(respCnt_ < MAX_PIPELINE){
+        if(stage_ == PARSE){
+            // 上一个请求的字段引用着读缓冲区，直到开始处理下一个请求才把它的字节取走
+            if(request_.IsFinish()){
+                readBuff_.Retrieve(request_.Consumed());
+                request_.Init();
+            }
+            if(readBuff_.ReadableBytes() <= 0){
+                break;
+            }
+            if(request_.parse(readBuff_)){
+                if(!request_.IsFinish()){
+                    break;   // 请求不完整，继续等待EPOLLIN
+                }
+                LOG_DEBUG("%s",request_.path().c_str());
+                keepAlive_ = request_.IsKeepAlive();
+                response_.Init(srcDir,request_.path(),keepAlive_,200,request_.AcceptEncoding(),
+                               request_.method() == "HEAD");
+                if(request_.method() == "GET" || request_.method() == "HEAD"){
+                    response_.SetConditional(request_.GetHeader("If-None-Match"),
+                                             request_.GetHeader("If-Modified-Since"));
+                }
+                if(request_.method() == "GET"){
+                    response_.SetRange(request_.GetHeader("Range"),request_.GetHeader("If-Range"));
+                }
+                stage_ = DISPATCH;
+            }else{
+                readBuff_.RetrieveAll();
+                keepAlive_ = false;
+                response_.Init(srcDir,request_.path(),false,request_.ErrorCode());
+                stage_ = RESPOND;
+            }
+        }
+        if(stage_ == DISPATCH){
+            if(!Router::Instance()->Dispatch(request_,response_,inlineOnly)){
+                break;      // 处理函数可能阻塞（如查数据库）
+            }
+            stage_ = RESPOND;
+        }
+        if(inlineOnly && !response_.CacheHit()){
+            break;          // 文件不在缓存内存里，生成响应要访问磁盘
+        }
+        AppendResponse_();
+        respCnt_++;
+        stage_ = PARSE;
+        if(!keepAlive_){
+            break;      // 这个响应之后连接就要关闭，后面的请求不再处理
+        }
+    }
+    if(respCnt_ == 0 || Deferred()){
+        return false;
+    }
+    out_.Seal();
+    LOG_DEBUG("pipeline:%d responses,%d segments,%d bytes",respCnt_,(int)out_.SegmentCount(),(int)out_.Bytes());
     return true;
-}
\ No newline at end of file
+}
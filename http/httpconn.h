@@ -3,6 +3,8 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -11,6 +13,8 @@
 #include "../buffer/buffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "router.h"
+#include "outputqueue.h"
 // 进行读写数据并调用httprequest 来解析数据以及httpresponse 来生成响应
 
 class HttpConn{
@@ -26,18 +30,29 @@ public:
     int GetPort() const;
     const char* GetIP() const;
     sockaddr_in GetAddr() const;
-    bool process();
+    // inlineOnly：在事件循环线程上调用，只处理不会阻塞的请求（路由标记为nonBlocking、
+    // 响应内容在缓存内存里），遇到其他请求就停下，Deferred()为真，由工作线程再调用process()接着处理
+    bool process(bool inlineOnly = false);
+    bool Deferred() const { return stage_ != PARSE; }
 
     //写的总长度
-    int ToWriteBytes(){
-        return iov_[0].iov_len + iov_[1].iov_len;
+    size_t ToWriteBytes() const {
+        return out_.Bytes();
     }
 
+    // 最后一个已处理请求的连接选项
     bool IsKeepAlive() const{
-        return request_.IsKeepAlive();
+        return keepAlive_;
     }
 
+    // 读缓冲区里还有没处理的字节（一轮最多处理MAX_PIPELINE个请求，剩下的不会再触发EPOLLIN）
+    bool HasPending() const{
+        return readBuff_.ReadableBytes() > (request_.IsFinish() ? request_.Consumed() : 0);
+    }
+
+    static const int MAX_PIPELINE = 16;     // 一次process最多处理的流水线请求数，保证各连接之间的公平
     static bool isET;
+    static bool zeroCopy;   // 正文用sendfile发送而不是mmap+writev
     static const char* srcDir;
     static std::atomic<int> userCount;  //原子
 
@@ -48,15 +63,28 @@ private:
 
     bool isClose_;
 
-    int iovCnt_;
-    struct iovec uov_[2];
+    // 一次process里所有响应排成out_的一条输出链：响应头和分段文本在out_.Text()里，
+    // 文件内容来自FileCache（小文件层内存、映射或fd），每段是文件的一个区间，
+    // 文件引用随链一起持有，缓存淘汰/失效不影响正在发送的内容
+    void AppendResponse_();
+    void ClearOutput_();
+
+    // 当前请求处理到哪一步，循环线程中途停下时工作线程从这里继续
+    enum STAGE {
+        PARSE,      // 解析下一个请求
+        DISPATCH,   // 已解析，还没调用路由处理函数
+        RESPOND,    // 处理函数已执行，还没生成响应
+    };
+    STAGE stage_;
+    int respCnt_;   // 本轮已排进输出链的响应数
+    OutputQueue out_;
+    bool keepAlive_;
 
     Buffer readBuff_;
-    Buffer writeBuff_;
 
     HttpResponse response_;
     HttpRequest request_; 
 
-}
+};
 
 #endif
\ No newline at end of file
@@ -1,189 +1,334 @@
 #include "httprequest.h"
+#include "router.h"
 using namespace std;
 
-const unordered_set<string> HttpRequest::DEFAULT_HTML{
-    "/index", "/register", "/login",
-    "/welcome", "/video", "/picture"};
-
-const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG
-{
-    {"/register.html", 0}, {"/login.html", 1};
-}
+size_t HttpRequest::maxBody = HttpRequest::DEFAULT_MAX_BODY;
+size_t HttpRequest::maxUpload = HttpRequest::DEFAULT_MAX_UPLOAD;
 
 void HttpRequest::Init()
 {
-    method_ = path_ = version_ = body_ = "";
+    path_ = "";
+    head_.clear();
+    body_.Clear();
+    multipart_.Clear();
+    sink_ = nullptr;
+    method_ = version_ = {0, 0};
     state_ = REQUEST_LINE;
-    header_.clear();
+    base_ = nullptr;
+    parsed_ = consumed_ = 0;
+    errorCode_ = 400;
+    headerCnt_ = 0;
     post_.clear();
 }
 
+// 从上次停下的位置继续扫描，遇到不完整的行就返回，等下一次ReadFd后再进来
 bool HttpRequest::parse(Buffer &buff)
 {
-    const char CRLF[] = "\r\n";
     if (buff.ReadableBytes() <= 0)
     {
         return false;
     }
+    if (state_ == BODY)
+    {
+        return ParseBody_(buff);
+    }
+    base_ = buff.Peek();
+    const char *end = buff.BeginWriteConst();
 
-    while (buff.ReadableBytes() && state_ != FINISH)
+    while (state_ == REQUEST_LINE || state_ == HEADERS)
     {
-        const char *lineEnd = search(buff.begin(), buff.BeginWriteConst(), CRLF, CRLF + 2);
+        const char *lineBegin = base_ + parsed_;
+        const char *lineEnd = DelimScanner::Find(lineBegin, end, "\n", 1);
+        if (lineEnd == end)
+        {
+            // 行还没收完整：超过长度限制直接判错，否则等待更多数据
+            if (static_cast<size_t>(end - lineBegin) > MAX_LINE || static_cast<size_t>(end - base_) > MAX_HEADER_BYTES)
+            {
+                LOG_ERROR("Request header too large");
+                return false;
+            }
+            return true;
+        }
+        const char *next = lineEnd + 1;
+        if (lineEnd > lineBegin && *(lineEnd - 1) == '\r')
+        {
+            lineEnd--;
+        }
+        if (static_cast<size_t>(lineEnd - lineBegin) > MAX_LINE || static_cast<size_t>(next - base_) > MAX_HEADER_BYTES)
+        {
+            LOG_ERROR("Request header too large");
+            return false;
+        }
+        parsed_ = next - base_;
 
-        std::string line(buff.Peek(), lineEnd);
-        switch (state_)
+        if (state_ == REQUEST_LINE)
         {
-        case REQUEST_LINE:
-            if (!ParseRequestLine_(line))
+            if (!ParseRequestLine_(lineBegin, lineEnd))
             {
                 return false;
             }
-            ParsePath_();
-            break;
-        case HEADERS:
-            ParseHeader_(line);
-            if (buff.ReadableBytes() <= 2)
+        }
+        else if (lineBegin == lineEnd)
+        {
+            // 空行：请求头结束
+            if (!ParseHeadersEnd_(buff))
             {
-                state_ = FINISH;
+                return false;
+            }
+            if (state_ == BODY)
+            {
+                return ParseBody_(buff);
             }
-            break;
-        case BODY:
-            ParseBody_(line);
-            break;
-        default:
-            break;
         }
-        if (lineEnd == buff.BeginWrite())
+        else if (!ParseHeader_(lineBegin, lineEnd))
         {
-            break;
-        } // 读到最后了
-        buff.RetrieveUntil(lineEnd + 2); // 跳过回车换行
+            return false;
+        }
     }
-    LOG_DEBUG("[%s],[%s],[%s]", method_.c_str(), path_.c_str(), version_.c_str());
+
+    consumed_ = parsed_;
+    LOG_DEBUG("[%.*s],[%s],[%.*s]", (int)method_.len, base_ + method_.off, path_.c_str(),
+              (int)version_.len, base_ + version_.off);
     return true;
 }
 
-// 解析路径
-void HttpRequest::ParsePath_()
+// METHOD SP PATH SP HTTP/x.y
+bool HttpRequest::ParseRequestLine_(const char *begin, const char *end)
 {
-    if (path_ == "/")
+    const char *sp1 = static_cast<const char *>(memchr(begin, ' ', end - begin));
+    if (sp1 && sp1 > begin)
     {
-        path_ = "/index.html";
+        const char *sp2 = static_cast<const char *>(memchr(sp1 + 1, ' ', end - sp1 - 1));
+        if (sp2 && sp2 > sp1 + 1 && end - sp2 > 6 && memcmp(sp2 + 1, "HTTP/", 5) == 0 &&
+            !memchr(sp2 + 1, ' ', end - sp2 - 1))
+        {
+            method_ = MakeSpan_(begin, sp1);
+            path_.assign(sp1 + 1, sp2);
+            version_ = MakeSpan_(sp2 + 6, end);
+            state_ = HEADERS;
+            return true;
+        }
+    }
+    LOG_ERROR("RequestLine Error");
+    return false;
+}
+
+// name ":" OWS value OWS
+bool HttpRequest::ParseHeader_(const char *begin, const char *end)
+{
+    const char *colon = DelimScanner::Find(begin, end, ":", 1);
+    if (colon == end || colon == begin || headerCnt_ >= MAX_HEADERS)
+    {
+        LOG_ERROR("Header Error");
+        return false;
+    }
+    const char *value = colon + 1;
+    while (value < end && (*value == ' ' || *value == '\t'))
+    {
+        value++;
+    }
+    const char *valueEnd = end;
+    while (valueEnd > value && (*(valueEnd - 1) == ' ' || *(valueEnd - 1) == '\t'))
+    {
+        valueEnd--;
+    }
+    headers_[headerCnt_][0] = MakeSpan_(begin, colon);
+    headers_[headerCnt_][1] = MakeSpan_(value, valueEnd);
+    headerCnt_++;
+    return true;
+}
+
+// Transfer-Encoding: chunked 优先；同时带Content-Length的请求可能被用来走私请求，直接拒绝
+bool HttpRequest::ParseHeadersEnd_(Buffer &buff)
+{
+    std::string_view te = GetHeader("Transfer-Encoding");
+    std::string_view len = GetHeader("Content-Length");
+    std::string_view type = GetHeader("Content-Type");
+    // 文件上传直接落盘，不占内存，单独放宽总长度上限；只有标记了接收上传的路由才落盘
+    bool multipart = method() == "POST" && !MultipartParser::uploadDir.empty() && type.size() >= 19 &&
+                     strncasecmp(type.data(), "multipart/form-data", 19) == 0 &&
+                     Router::Instance()->AcceptsUpload(method(), path_);
+    size_t limit = multipart ? maxUpload : maxBody;
+    bool chunked = false;
+    size_t length = 0;
+    if (!te.empty())
+    {
+        if (te.size() != 7 || strncasecmp(te.data(), "chunked", 7) != 0 || !len.empty())
+        {
+            LOG_ERROR("Unsupported Transfer-Encoding");
+            return false;
+        }
+        chunked = true;
     }
     else
     {
-        for (auto &item : DEFAULT_HTML)
+        for (char ch : len)
         {
-            if (item == path_)
+            if (ch < '0' || ch > '9')
+            {
+                LOG_ERROR("Bad Content-Length");
+                return false;
+            }
+            if (length <= limit)
             {
-                path_ += ".html";
-                break;
+                length = length * 10 + (ch - '0');
             }
         }
+        if (length > limit)
+        {
+            LOG_ERROR("Body too large");
+            errorCode_ = 413;
+            return false;
+        }
     }
+    if (!chunked && length == 0)
+    {
+        state_ = FINISH;
+        return true;
+    }
+    // 请求头拷出来，读缓冲区从请求体开始，解码过的字节随即取走
+    head_.assign(base_, parsed_);
+    base_ = head_.data();
+    buff.Retrieve(parsed_);
+    parsed_ = 0;
+    bodyReader_.Init(length, chunked, limit);
+    sink_ = SelectSink_(multipart);
+    if (!sink_)
+    {
+        return false;
+    }
+    state_ = BODY;
+    return true;
 }
 
-bool HttpRequest::ParseRequestLine_(const string &line)
+// 请求体交给谁：multipart上传交给流式解析器，其余存进body_
+BodySink *HttpRequest::SelectSink_(bool multipart)
 {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten))
+    if (multipart)
     {
-        // subMatch[0] 是整个捕获的字符串
-        method_ = subMatch[1];
-        path_ = subMatc[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
-        return true;
+        return multipart_.Init(GetHeader("Content-Type")) ? &multipart_ : nullptr;
     }
-    LOG_ERROR("RequestLine Error");
-    return false;
+    return &body_;
 }
 
-void HttpRequest::ParseHeader_(const string &line)
+// 解码当前缓冲区里已到达的请求体；返回true且未FINISH表示还要等待数据
+bool HttpRequest::ParseBody_(Buffer &buff)
 {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten))
+    size_t used = 0;
+    BodyReader::STATUS status = bodyReader_.Feed(buff.Peek(), buff.BeginWriteConst(), sink_, &used);
+    buff.Retrieve(used);
+    if (status == BodyReader::NEED_MORE)
     {
-        header_[subMatch[1]] = subMatch[2];
+        return true;
     }
-    else
+    if (status != BodyReader::DONE)
     {
-        state_ = BODY;
+        LOG_ERROR("Body error, received:%zu", bodyReader_.Received());
+        errorCode_ = (status == BodyReader::TOO_LARGE || sink_->TooLarge()) ? 413 : 400;
+        multipart_.Clear();     // 上传没完成，删掉已经写下的文件
+        return false;
     }
-}
-
-void HttpRequest::ParseBody_(const string &line)
-{
-    body_ = line;
-    ParsePost_();
     state_ = FINISH;
-    LOG_DEBUG("Body:%s,len:%d", line.c_str(), line.size());
+    consumed_ = 0;      // 请求体已经边解码边取走了
+    LOG_DEBUG("[%.*s],[%s],body len:%zu", (int)method_.len, base_ + method_.off, path_.c_str(), body_.Size());
+    ParsePost_();
+    return true;
 }
 
-int HttpRequest : ConverHex(char ch)
+// 十六进制字符转数值，非法字符返回-1
+int HttpRequest::ConverHex(char ch)
 {
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
     if (ch >= 'A' && ch <= 'F')
         return ch - 'A' + 10;
     if (ch >= 'a' && ch <= 'f')
         return ch - 'a' + 10;
-    return ch;
+    return -1;
 }
 
-void HttpRequest : ParsePost_()
+void HttpRequest::ParsePost_()
 {
-    if (method_ == "POST")
+    if (method() == "POST" && GetHeader("Content-Type") == "application/x-www-form-urlencoded")
     {
+        ParseFromUrlencoded_();
+    }
+    else if (sink_ == &multipart_)
+    {
+        post_ = multipart_.Fields();
     }
 }
 
-// 从url中解析编码
+// 从url中解析编码：用DelimScanner一次跳过一整段普通字符，只在 = & + % 处停下
 void HttpRequest::ParseFromUrlencoded_()
 {
-    if (body_.size() == 0)
+    std::string_view body = body_.Data();   // 转存到临时文件的大请求体不当作表单解析
+    if (body.empty())
     {
         return;
     }
 
     string key, value;
-    int num = 0;
-    int n = body_.size();
-    int i = 0, j = 0;
+    string *cur = &key;
+    bool inValue = false;
+    const char *p = body.data();
+    const char *end = p + body.size();
 
-    for (; i < n; i++)
+    while (p < end)
     {
-        char ch = body_[i];
-        switch (ch)
+        const char *q = DelimScanner::Find(p, end, "=&+%", 4);
+        cur->append(p, q);
+        if (q == end)
+        {
+            break;
+        }
+        p = q + 1;
+        switch (*q)
         {
         case '=':
-            key = body_.substr(j, i - j);
-            j = i + 1;
+            if (!inValue)
+            {
+                inValue = true;
+                cur = &value;
+            }
+            else
+            {
+                cur->push_back('=');
+            }
             break;
         case '+':
-            body_[i] = ' ';
+            cur->push_back(' ');
             break;
         case '%':
-            num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
-            body_[i + 2] = num % 10 + '0';
-            body_[i + 1] = num / 10 + '0';
-            i += 2;
+            if (end - q > 2 && ConverHex(q[1]) >= 0 && ConverHex(q[2]) >= 0)
+            {
+                cur->push_back(static_cast<char>(ConverHex(q[1]) * 16 + ConverHex(q[2])));
+                p = q + 3;
+            }
+            else
+            {
+                cur->push_back('%');
+            }
             break;
         case '&':
-            value = body_.substr(j, i - j);
-            j = i + 1;
-            post_[key] = value;
-            LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
+            if (!key.empty())
+            {
+                LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
+                post_[key] = value;
+            }
+            key.clear();
+            value.clear();
+            cur = &key;
+            inValue = false;
             break;
         default:
             break;
         }
-        assert(j <= i);
-        if (post_.count(key) == 0 && j < i)
-        {
-            value = body_.substr(j, i - j);
-            post_[key] = value;
-        }
+    }
+    if (!key.empty())
+    {
+        LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
+        post_[key] = value;
     }
 }
 
@@ -194,14 +339,16 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
         return false;
     }
     LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL *sql;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-    assert(sql);
+    MYSQL *sql = nullptr;
+    SqlConnRAII sqlRAII(&sql, SqlConnPool::Instance());    // 具名对象，连接持有到函数返回
+    if (!sql)
+    {
+        LOG_ERROR("UserVerify: no database connection");
+        return false;
+    }
 
     bool flag = false;
-    unsigned int j = 0;
     char order[256] = {0};
-    MYSQL_FIELD *fields = nullptr;
     MYSQL_RES *res = nullptr;
 
     if (!isLogin)
@@ -218,8 +365,6 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
     }
 
     res = mysql_store_result(sql);
-    j = mysql_num_fields(res);
-    fields = mysql_fetch_fields(res);
 
     while (MYSQL_ROW row = mysql_fetch_row(res))
     {
@@ -266,16 +411,81 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
 
 bool HttpRequest::IsKeepAlive() const
 {
-    if (header_.count("Connection") == 1)
+    std::string_view conn = GetHeader("Connection");
+    if (conn.size() == 10 && strncasecmp(conn.data(), "keep-alive", 10) == 0)
     {
-        return header_.find("Connection")->second == "keep_alive" && version_ == "1.1";
+        return true;
     }
-    return false;
+    if (conn.size() == 5 && strncasecmp(conn.data(), "close", 5) == 0)
+    {
+        return false;
+    }
+    return version() == "1.1";
+}
+
+// 请求头名不区分大小写，个数有上限，线性查找比哈希更快
+std::string_view HttpRequest::GetHeader(std::string_view key) const
+{
+    for (size_t i = 0; i < headerCnt_; i++)
+    {
+        std::string_view name = View_(headers_[i][0]);
+        if (name.size() == key.size() && strncasecmp(name.data(), key.data(), key.size()) == 0)
+        {
+            return View_(headers_[i][1]);
+        }
+    }
+    return std::string_view();
+}
+
+// Accept-Encoding: gzip, deflate;q=0.5, br;q=0  -> ACCEPT_GZIP
+int HttpRequest::AcceptEncoding() const
+{
+    std::string_view value = GetHeader("Accept-Encoding");
+    int mask = 0;
+    while (!value.empty())
+    {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        value = (comma == std::string_view::npos) ? std::string_view() : value.substr(comma + 1);
+
+        size_t semi = item.find(';');
+        std::string_view name = item.substr(0, semi);
+        while (!name.empty() && (name.front() == ' ' || name.front() == '\t'))
+            name.remove_prefix(1);
+        while (!name.empty() && (name.back() == ' ' || name.back() == '\t'))
+            name.remove_suffix(1);
+        if (semi != std::string_view::npos)
+        {
+            std::string_view params = item.substr(semi + 1);
+            size_t q = params.find("q=");
+            if (q != std::string_view::npos)
+            {
+                // q=0、q=0.0、q=0.000 都表示不接受
+                std::string_view qv = params.substr(q + 2);
+                size_t i = 0;
+                bool zero = i < qv.size() && qv[i] == '0';
+                for (i = 1; zero && i < qv.size() && qv[i] != ' ' && qv[i] != ';'; i++)
+                {
+                    if (qv[i] != '.' && qv[i] != '0')
+                        zero = false;
+                }
+                if (zero)
+                    continue;
+            }
+        }
+        if (name.size() == 4 && strncasecmp(name.data(), "gzip", 4) == 0)
+            mask |= ACCEPT_GZIP;
+        else if (name.size() == 2 && strncasecmp(name.data(), "br", 2) == 0)
+            mask |= ACCEPT_BR;
+        else if (name == "*")
+            mask |= ACCEPT_GZIP | ACCEPT_BR;
+    }
+    return mask;
 }
 
 std::string HttpRequest::path() const
 {
-    return path;
+    return path_;
 }
 
 std::string &HttpRequest::path()
@@ -283,14 +493,14 @@ std::string &HttpRequest::path()
     return path_;
 }
 
-std::string HttpRequest::method() const
+std::string_view HttpRequest::method() const
 {
-    return method_;
+    return base_ ? View_(method_) : std::string_view();
 }
 
-std::string HttpRequest::version() const
+std::string_view HttpRequest::version() const
 {
-    return version_;
+    return base_ ? View_(version_) : std::string_view();
 }
 
 std::string HttpRequest::GetPost(const std::string &key) const
@@ -306,7 +516,7 @@ std::string HttpRequest::GetPost(const std::string &key) const
 std::string HttpRequest::GetPost(const char *key) const
 {
     assert(key != nullptr);
-    id(post_.count(key) == 1)
+    if (post_.count(key) == 1)
     {
         return post_.find(key)->second;
     }
@@ -2,16 +2,25 @@
 #define HTTP_REQUEST_H
 
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
 #include <errno.h>
+#include <strings.h>
 #include <mysql/mysql.h>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
 #include "../pool/sqlconnpool.h"
+#include "delimscanner.h"
+#include "bodyreader.h"
+#include "multipart.h"
 
+// 手写的可恢复状态机解析器：直接在读缓冲区上扫描，不拷贝行、不用正则。
+// 请求行和请求头只记录相对请求起点的偏移，数据跨多次ReadFd到达时从上次位置继续，
+// 缓冲区扩容/搬移不影响已解析的字段；字段以string_view形式返回，
+// 在下一次parse之前有效（请求的字节在下一个请求开始解析时才从缓冲区取走）。
+// 有请求体时，请求头结束后把请求头拷出来，请求体边到达边解码交给BodySink并从缓冲区取走，
+// 读缓冲区不会因为大请求体而膨胀
 class HttpRequest{
 public:
     enum PARSE_STATE{
@@ -21,40 +30,83 @@ public:
         FINISH,
     };
 
-    HttpRequest() { init();}
+    static const size_t MAX_LINE = 8192;            // 请求行/单个请求头的最大长度
+    static const size_t MAX_HEADERS = 64;           // 请求头最大个数
+    static const size_t MAX_HEADER_BYTES = 32768;   // 请求行+请求头总长度上限
+    static const size_t DEFAULT_MAX_BODY = 64 << 20;
+    static size_t maxBody;                          // 请求体上限，超过时返回413
+    static const size_t DEFAULT_MAX_UPLOAD = 1UL << 30;
+    static size_t maxUpload;                        // multipart上传的请求体上限
+
+    enum ENCODING {                                 // AcceptEncoding()返回的位掩码
+        ACCEPT_GZIP = 1,
+        ACCEPT_BR = 2,
+    };
+
+    HttpRequest() { Init();}
     ~HttpRequest() = default;
 
     void Init();
-    bool parse(Buffer& buff);
+    bool parse(Buffer& buff);   // false: 请求格式错误；true且IsFinish()为假：数据不完整，等待更多数据
+    bool IsFinish() const { return state_ == FINISH; }
+    int ErrorCode() const { return errorCode_; }    // parse返回false时应答的状态码
+    size_t Consumed() const { return consumed_; }   // 本请求在缓冲区中占用的字节数
 
     std::string path() const;
     std::string &path();
-    std::string method() const;
-    std::string version() const;
+    std::string_view method() const;
+    std::string_view version() const;
+    std::string_view GetHeader(std::string_view key) const;
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
 
     bool IsKeepAlive() const;
+    int AcceptEncoding() const;     // 客户端可接受的压缩编码，q=0的项视为不接受
+    const BodyStore& Body() const { return body_; }
+    static bool UserVerify(const std::string& name,const std::string& pwd,bool isLogin);
+    // multipart上传保存下来的文件，普通字段通过GetPost取。
+    // 没有认领的文件在下一个请求开始（或连接关闭）时删除；认领后由处理函数移走或删除
+    const std::vector<MultipartParser::File>& Uploads() const { return multipart_.Files(); }
+    const std::string& ClaimUpload(size_t i) { return multipart_.Claim(i); }
 
 private:
-    bool ParseRequestLine_(const std::string& line);    //处理请求行
-    void ParseHeader_(const std::string& line);         //处理请求头
-    void ParseBody_(const std::string& line);           //处理请求体
+    struct Span {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    bool ParseRequestLine_(const char* begin, const char* end);  //处理请求行
+    bool ParseHeader_(const char* begin, const char* end);       //处理请求头
+    bool ParseHeadersEnd_(Buffer& buff);                         //请求头结束，确定请求体分帧
+    bool ParseBody_(Buffer& buff);                               //处理请求体
+    BodySink* SelectSink_(bool multipart);
 
-    void ParsePath_();                                  //处理请求路径
     void ParsePost_();                                  //处理Post事件
     void ParseFromUrlencoded_();                        //从url中解析编码
 
-    static bool UserVerify(const std::string& name,const std::string& pwd,bool isLogin);
+    std::string_view View_(Span s) const { return std::string_view(base_ + s.off, s.len); }
+    Span MakeSpan_(const char* begin, const char* end) const {
+        return { static_cast<uint32_t>(begin - base_), static_cast<uint32_t>(end - begin) };
+    }
 
     PARSE_STATE state_;
-    std::string method_,path_,version_,body_;
-    std::unordered_map<std::string,std::string> header_;
-    std::unordered_map<std::string,int> post_;
+    const char* base_;          // 本次parse时请求起点(buff.Peek())
+    size_t parsed_;             // 已扫描到的位置，相对base_
+    size_t consumed_;
+    int errorCode_;
+
+    Span method_, version_;
+    std::string path_;
+    std::string head_;          // 有请求体时请求头的副本，base_指向这里
+    BodyReader bodyReader_;
+    BodySink* sink_;
+    BodyStore body_;
+    MultipartParser multipart_;
+    Span headers_[MAX_HEADERS][2];
+    size_t headerCnt_;
+    std::unordered_map<std::string,std::string> post_;
 
-    static const std::unordered_set<std::string> DEFAULT_HTML;
-    static const std::unordered_map<std::string,int> DEFAULT_HTML_TAG;
     static int ConverHex(char ch);
 };
 
-#endif
\ No newline at end of file
+#endif
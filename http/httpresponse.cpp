@@ -22,121 +22,470 @@ const unordered_map<string,string> HttpResponse::SUFFIX_TYPE={
     { ".tar",   "application/x-tar" },
     { ".css",   "text/css "},
     { ".js",    "text/javascript "},
-}
+};
 
 const unordered_map<int,string> HttpResponse::CODE_STATUS={
     { 200, "OK" },
+    { 206, "Partial Content" },
+    { 304, "Not Modified" },
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
-}
+    { 405, "Method Not Allowed" },
+    { 413, "Payload Too Large" },
+    { 416, "Range Not Satisfiable" },
+};
 
 const unordered_map<int,string> HttpResponse::CODE_PATH ={
     { 400, "/400.html" },
     { 403, "/403.html" },
     { 404, "/404.html" },
-}
+    { 405, "/405.html" },
+    { 413, "/413.html" },
+};
+
+const ResponseTemplate HttpResponse::TEMPLATE(HttpResponse::CODE_STATUS);
+
+const string HttpResponse::BOUNDARY = [](){
+    random_device rd;
+    char buf[40];
+    snprintf(buf,sizeof(buf),"tinywebserver-%08x%08x",rd(),rd());
+    return string(buf);
+}();
 
 HttpResponse::HttpResponse(){
     code_=-1;
     path_ =srcDir_ = "";
-    isKeepAlive_ = false;
-    mmFile_=nullptr;
-    mmFileStat_={0};
+    isKeepAlive_ = isHead_ = false;
+    acceptEncoding_ = 0;
+    rangeCnt_ = pieceCnt_ = 0;
+    hasContent_ = false;
 }
 
 HttpResponse::~HttpResponse(){
     UnmapFile();
 }
 
-void HttpResponse::Init(cosnt string& srcDir,string& path,bool isKeepAlive,int code){
-    assert(srcDir != "");
-    if(mmFile_) {UnmapFile();}
+void HttpResponse::Init(const char* srcDir,string& path,bool isKeepAlive,int code,int acceptEncoding,bool isHead){
+    assert(srcDir && *srcDir);
+    UnmapFile();
     code_ = code;
-    isKeepAlice_ = isKeepAlive;
+    isKeepAlive_ = isKeepAlive;
+    isHead_ = isHead;
+    acceptEncoding_ = acceptEncoding;
+    allow_.clear();
+    ifNoneMatch_ = ifModifiedSince_ = string_view();
+    range_ = ifRange_ = string_view();
+    rangeCnt_ = pieceCnt_ = 0;
+    hasContent_ = false;
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr;
-    mmfileStat_ = { 0 };
 }
 
-void HttpResponse::MakeResponse(Buffer& buff){
-    if(stat((srcDir_ + path_).data(),&mmFileStat_)<0 || S_ISDIR(mmFileStat_.st_mode)){
-        code_ =404;
+void HttpResponse::SetConditional(string_view ifNoneMatch,string_view ifModifiedSince){
+    ifNoneMatch_ = ifNoneMatch;
+    ifModifiedSince_ = ifModifiedSince;
+}
+
+// If-None-Match优先（弱比较，忽略W/前缀）；没有时才看If-Modified-Since
+bool HttpResponse::NotModified_() const{
+    if(!ifNoneMatch_.empty()){
+        string_view list = ifNoneMatch_;
+        while(!list.empty()){
+            size_t comma = list.find(',');
+            string_view tag = list.substr(0,comma);
+            list = (comma == string_view::npos) ? string_view() : list.substr(comma + 1);
+            while(!tag.empty() && tag.front() == ' ') tag.remove_prefix(1);
+            while(!tag.empty() && tag.back() == ' ') tag.remove_suffix(1);
+            if(tag.size() > 2 && tag[0] == 'W' && tag[1] == '/') tag.remove_prefix(2);
+            if(tag == "*" || tag == file_->etag){
+                return true;
+            }
+        }
+        return false;
+    }
+    if(!ifModifiedSince_.empty()){
+        if(ifModifiedSince_ == file_->lastModified){
+            return true;    // 客户端原样带回的最常见情况，不用解析日期
+        }
+        char date[64];
+        if(ifModifiedSince_.size() >= sizeof(date)) return false;
+        memcpy(date,ifModifiedSince_.data(),ifModifiedSince_.size());
+        date[ifModifiedSince_.size()] = '\0';
+        struct tm tm = {};
+        const char* end = strptime(date,"%a, %d %b %Y %H:%M:%S GMT",&tm);
+        return end && *end == '\0' && file_->st.st_mtime <= timegm(&tm);
+    }
+    return false;
+}
+
+void HttpResponse::SetRange(string_view range,string_view ifRange){
+    range_ = range;
+    ifRange_ = ifRange;
+}
+
+// If-Range带ETag时强比较，带日期时和Last-Modified精确比较；不匹配则忽略Range
+bool HttpResponse::IfRangeMatch_() const{
+    if(ifRange_.empty()){
+        return true;
+    }
+    if(ifRange_[0] == '"'){
+        return ifRange_ == file_->etag;
+    }
+    if(ifRange_.size() > 2 && ifRange_[0] == 'W' && ifRange_[1] == '/'){
+        return false;
+    }
+    return ifRange_ == file_->lastModified;
+}
+
+// bytes=0-99, 200-, -500
+int HttpResponse::ParseRange_(){
+    string_view spec = range_;
+    if(spec.size() < 6 || strncasecmp(spec.data(),"bytes=",6) != 0){
+        return -1;
+    }
+    spec.remove_prefix(6);
+    size_t size = file_->size;
+    int cnt = 0;
+    int total = 0;
+    while(!spec.empty()){
+        size_t comma = spec.find(',');
+        string_view item = spec.substr(0,comma);
+        spec = (comma == string_view::npos) ? string_view() : spec.substr(comma + 1);
+        while(!item.empty() && item.front() == ' ') item.remove_prefix(1);
+        while(!item.empty() && item.back() == ' ') item.remove_suffix(1);
+        if(item.empty()){
+            continue;
+        }
+        if(++total > MAX_RANGES){
+            return -1;
+        }
+        size_t dash = item.find('-');
+        if(dash == string_view::npos){
+            return -1;
+        }
+        // 解析两端的数字，位数限制防止溢出
+        size_t num[2] = {0, 0};
+        bool has[2] = {false, false};
+        string_view part[2] = {item.substr(0,dash), item.substr(dash + 1)};
+        for(int k = 0; k < 2; k++){
+            if(part[k].size() > 18){
+                return -1;
+            }
+            for(char ch : part[k]){
+                if(ch < '0' || ch > '9'){
+                    return -1;
+                }
+                num[k] = num[k] * 10 + (ch - '0');
+            }
+            has[k] = !part[k].empty();
+        }
+        size_t first, last;
+        if(!has[0]){
+            if(!has[1]){
+                return -1;
+            }
+            if(num[1] == 0 || size == 0){
+                continue;   // 后缀长度为0，无法满足
+            }
+            first = num[1] >= size ? 0 : size - num[1];
+            last = size - 1;
+        }else{
+            if(has[1] && num[1] < num[0]){
+                return -1;
+            }
+            if(num[0] >= size){
+                continue;   // 起点超出文件，无法满足
+            }
+            first = num[0];
+            last = (has[1] && num[1] < size) ? num[1] : size - 1;
+        }
+        ranges_[cnt].off = first;
+        ranges_[cnt].len = last - first + 1;
+        cnt++;
+    }
+    return total == 0 ? -1 : cnt;
+}
+
+// "Content-Range: bytes first-last/size\r\n"，写入buf并返回长度
+size_t HttpResponse::FormatContentRange_(char* buf,const Range& r) const{
+    static const char HEAD[] = "Content-Range: bytes ";
+    char num[24];
+    char* end = num + sizeof(num);
+    char* p = buf;
+    memcpy(p,HEAD,sizeof(HEAD) - 1);
+    p += sizeof(HEAD) - 1;
+    char* d = ResponseTemplate::FormatUint(r.off,end);
+    memcpy(p,d,end - d);
+    p += end - d;
+    *p++ = '-';
+    d = ResponseTemplate::FormatUint(r.off + r.len - 1,end);
+    memcpy(p,d,end - d);
+    p += end - d;
+    *p++ = '/';
+    d = ResponseTemplate::FormatUint(file_->size,end);
+    memcpy(p,d,end - d);
+    p += end - d;
+    *p++ = '\r';
+    *p++ = '\n';
+    return p - buf;
+}
+
+// HEAD不发正文；小文件层blob开头的那段头部（withHeader）仍要发，由调用方把len截成头部长度
+void HttpResponse::AddPiece_(Buffer& buff,off_t off,size_t len,bool withHeader){
+    if(len == 0 || (isHead_ && !withHeader)){
+        return;
     }
-    else if(!(mmFileStat_.st_mode & S_IROTH)){
-        code_ =403;
+    BodyPiece& piece = pieces_[pieceCnt_++];
+    piece.textEnd = buff.ReadableBytes();
+    piece.off = off;
+    piece.len = len;
+    piece.withHeader = withHeader;
+}
+
+// 206：单个区间直接发文件的一段；多个区间按multipart/byteranges组织，
+// 各部分的头部写进缓冲区，区间数据由连接从文件偏移处直接发送
+void HttpResponse::AddRangeContent_(Buffer& buff){
+    // notModified是 ETag/Last-Modified/Cache-Control/Vary 加结尾空行，这里去掉空行复用
+    string_view validators(file_->notModified.data(),file_->notModified.size() - 2);
+    char contentRange[MAX_RANGES][96];
+    size_t rangeLen[MAX_RANGES];
+    for(int i = 0; i < rangeCnt_; i++){
+        rangeLen[i] = FormatContentRange_(contentRange[i],ranges_[i]);
     }
-    else if(code_ == -1){
-        code_ = 200;
+    buff.Append("Accept-Ranges: bytes\r\n",22);
+    buff.Append(validators.data(),validators.size());
+    if(rangeCnt_ == 1){
+        buff.Append("Content-type: ",14);
+        buff.Append(file_->mime);
+        buff.Append("\r\n",2);
+        buff.Append(contentRange[0],rangeLen[0]);
+        ResponseTemplate::AppendContentLength(buff,ranges_[0].len);
+        AddPiece_(buff,ranges_[0].off,ranges_[0].len,false);
+        return;
+    }
+
+    // 每部分：CRLF--boundary CRLF Content-type CRLF Content-Range CRLF CRLF 数据；最后 CRLF--boundary--CRLF
+    size_t partFixed = 4 + BOUNDARY.size() + 2 + 14 + file_->mime.size() + 2 + 2;
+    size_t total = 4 + BOUNDARY.size() + 4;
+    for(int i = 0; i < rangeCnt_; i++){
+        total += partFixed + rangeLen[i] + ranges_[i].len;
+    }
+    buff.Append("Content-type: multipart/byteranges; boundary=",45);
+    buff.Append(BOUNDARY);
+    buff.Append("\r\n",2);
+    ResponseTemplate::AppendContentLength(buff,total);
+    if(isHead_){
+        return;
+    }
+    for(int i = 0; i < rangeCnt_; i++){
+        buff.Append("\r\n--",4);
+        buff.Append(BOUNDARY);
+        buff.Append("\r\nContent-type: ",16);
+        buff.Append(file_->mime);
+        buff.Append("\r\n",2);
+        buff.Append(contentRange[i],rangeLen[i]);
+        buff.Append("\r\n",2);
+        AddPiece_(buff,ranges_[i].off,ranges_[i].len,false);
+    }
+    buff.Append("\r\n--",4);
+    buff.Append(BOUNDARY);
+    buff.Append("--\r\n",4);
+}
+
+void HttpResponse::SetContent(string_view contentType,string_view content){
+    hasContent_ = true;
+    contentType_.assign(contentType.data(),contentType.size());
+    content_.assign(content.data(),content.size());
+}
+
+// 出错时（包括文件不存在/无权限）MakeResponse会通过ErrorHtml_读错误页，错误页也要在缓存里
+bool HttpResponse::CacheHit(){
+    if(hasContent_){
+        return true;
+    }
+    int code = code_;
+    if(code_ < 400){
+        file_ = FileCache::Instance()->Find(path_);
+        if(!file_){
+            return false;
+        }
+        if(file_->Ok()){
+            return file_->blob || file_->addr;
+        }
+        code = (file_->status == CachedFile::FORBIDDEN) ? 403 : 404;
+    }
+    auto it = CODE_PATH.find(code);
+    if(it == CODE_PATH.end()){
+        return true;    // 没有错误页，用内置的错误正文
+    }
+    FileCache::FilePtr page = FileCache::Instance()->Find(it->second);
+    return page && (!page->Ok() || page->blob || page->addr);
+}
+
+void HttpResponse::MakeResponse(Buffer& buff){
+    pieceCnt_ = 0;
+    // 处理函数给出的正文：没有文件、不做条件请求和Range
+    if(hasContent_){
+        if(code_ == -1){
+            code_ = 200;
+        }
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        buff.Append("Content-type: ",14);
+        buff.Append(contentType_);
+        buff.Append("\r\n",2);
+        ResponseTemplate::AppendContentLength(buff,content_.size());
+        if(!isHead_){
+            buff.Append(content_);
+        }
+        return;
+    }
+    // 热点文件的stat/open/mmap都命中缓存，不产生文件系统调用；
+    // 请求本身有错（400/413）时不查请求的文件，直接用错误页
+    if(code_ < 400){
+        if(!file_){
+            file_ = FileCache::Instance()->Get(path_);
+        }
+        if(file_->status == CachedFile::NOT_FOUND){
+            code_ =404;
+        }
+        else if(file_->status == CachedFile::FORBIDDEN){
+            code_ =403;
+        }
+        else if(code_ == -1){
+            code_ = 200;
+        }
     }
     ErrorHtml_();
-    AddStateLinde_(buff);
+    pieceCnt_ = 0;
+    // Range只作用于未压缩的原文件，请求了区间时不选压缩变体
+    bool ranged = code_ == 200 && file_->Ok() && !range_.empty() && IfRangeMatch_();
+    // 按Accept-Encoding选压缩变体，br优先
+    if(file_->Ok() && !ranged){
+        if((acceptEncoding_ & HttpRequest::ACCEPT_BR) && file_->br){
+            file_ = file_->br;
+        }else if((acceptEncoding_ & HttpRequest::ACCEPT_GZIP) && file_->gzip){
+            file_ = file_->gzip;
+        }
+    }
+    // 条件请求命中：只发头部，正文不发送（缓存命中时也不会打开或映射文件）
+    if(code_ == 200 && file_->Ok() && NotModified_()){
+        code_ = 304;
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        buff.Append(file_->notModified);
+        file_.reset();
+        return;
+    }
+    if(ranged){
+        rangeCnt_ = ParseRange_();
+        if(rangeCnt_ == 0){
+            code_ = 416;
+            AddStateLine_(buff);
+            AddHeader_(buff);
+            buff.Append("Content-Range: bytes */",23);
+            char num[24];
+            char* numEnd = num + sizeof(num);
+            char* d = ResponseTemplate::FormatUint(file_->size,numEnd);
+            buff.Append(d,numEnd - d);
+            buff.Append("\r\n",2);
+            AddErrorBody_(buff);
+            file_.reset();
+            return;
+        }
+        if(rangeCnt_ > 0){
+            code_ = 206;
+            AddStateLine_(buff);
+            AddHeader_(buff);
+            AddRangeContent_(buff);
+            return;
+        }
+    }
+    AddStateLine_(buff);
     AddHeader_(buff);
     AddContent_(buff);
 }
 
-char* HttpResponse::File(){
-    return mmFile_;
+const char* HttpResponse::File(){
+    return file_ ? file_->addr : nullptr;
 }
 
-size_t HttpResponse::FoleLen() const{
-    return mmFileStat_.st_size;
+size_t HttpResponse::FileLen() const{
+    return (file_ && file_->Ok()) ? file_->size : 0;
 }
 
 void HttpResponse::ErrorHtml_(){
     if(CODE_PATH.count(code_) == 1){
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(),&mmFileStat_);
+        file_ = FileCache::Instance()->Get(path_);
     }
 }
 
+// 状态行和Connection头是预先拼好的一整段
 void HttpResponse::AddStateLine_(Buffer& buff){
-    string status;
-    if(CODE_STATUS.count(code_) == 1){
-        status = CODE_STATUS.find(code_)->second;
-    }
-    else{
+    if(!TEMPLATE.Known(code_)){
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
     }
-    buff.Append("HTTP/1.1"+to_string(code_)+" "+status+"\r\n");
+    string_view prefix = TEMPLATE.Prefix(code_,isKeepAlive_);
+    buff.Append(prefix.data(),prefix.size());
 }
 
+void HttpResponse::AddHeader_(Buffer& buff){
+    // Date取缓存时钟每秒生成一次的字符串，不在每个请求上调用time()
+    CachedClock::Snapshot now;
+    CachedClock::Instance()->Now(&now);
+    buff.Append("Date: ",6);
+    buff.Append(now.httpDate, strlen(now.httpDate));
+    buff.Append("\r\n",2);
+    if(!allow_.empty()){
+        buff.Append("Allow: ",7);
+        buff.Append(allow_);
+        buff.Append("\r\n",2);
+    }
+}
+
+// 内置错误正文是 Content-type/Content-length 头加页面，HEAD时只要头部
+void HttpResponse::AddErrorBody_(Buffer& buff){
+    string_view body = TEMPLATE.ErrorBody(code_);
+    if(isHead_){
+        body = body.substr(0,body.find("\r\n\r\n") + 4);
+    }
+    buff.Append(body.data(),body.size());
+}
+
+// Content-type和Content-length在缓存条目里预先拼好；错误页文件缺失时用启动时生成的错误正文。
+// 小文件层的条目header和正文连在一起，由连接整段发送，这里不再追加
 void HttpResponse::AddContent_(Buffer& buff){
-    int srcFd =open((srcDir_ + path_).data(),O_RDONLY);
-    if(srcFd<0){
-        ErrorContent(buff,"File NotFound!");
+    if(!file_->Ok()){
+        AddErrorBody_(buff);
         return ;
     }
-
-    LOG_DEBUG("file path %s",(srcDir_ + path_).data());
-    // 将文件或设备映射到进程的地址空间中
-    int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mem_Ret == -1){
-        ErrorContent(buff,"File NotFound!");
-        return;
+    if(file_->blob){
+        AddPiece_(buff,0,isHead_ ? file_->header.size() : file_->blobLen,true);
+    }else{
+        buff.Append(file_->header);
+        AddPiece_(buff,0,file_->size,false);
     }
-    mmFile_ = (char*)mmRet;
-    close(srcFd);
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
 }
 
 void HttpResponse::UnmapFile(){
-    if(mmFile_){
-        munmap(mmFile_,mmFileStat_.st_size);
-        mmFile_ = nullptr;
-    }
+    file_.reset();
 }
 
+FileCache::FilePtr HttpResponse::DetachFile(){
+    FileCache::FilePtr file = std::move(file_);
+    file_.reset();
+    return file;
+}
 
 //判断文件类型
-string HttpResponse::GetFileType_(){
-    string::size_type idx=path_.find_last_of('.');
+string HttpResponse::FileType(const string& path){
+    string::size_type idx=path.find_last_of('.');
     if(idx == string::npos) {   //最大值 find函数在找不到指定值的情况下会返回 npos
         return "text/plain";
     }
-    string suffix = path_.substr(idx);
+    string suffix = path.substr(idx);
     if(SUFFIX_TYPE.count(suffix) == 1){
         return SUFFIX_TYPE.find(suffix) ->second;
     }
@@ -144,24 +493,27 @@ string HttpResponse::GetFileType_(){
 }
 
 
-void HttpResponse::ErrorContent(Buffer& buff,string message){
-    string body;
-    string status;
-    body+= "<html><title>Error</title>";
-    body+= "<body bgcolor=\"ffffff\">";
-    if(CODE_STATUS.count(code_) == 1){
-        status = CODE_STATUS.find(code_)->second;
-    }else{
-        status = "Bad Requset";
-    }
-
-    body += to_string(code_)+ " : " + status +"\n";
-    body += "<p>" + message + "</p>";
-    body += "<hr><em>TinyWebServer</em></body></html>";
+// 带自定义信息的错误正文，先算出长度再逐段追加，不拼接临时字符串
+void HttpResponse::ErrorContent(Buffer& buff,string_view message){
+    static const char HEAD[] = "<html><title>Error</title><body bgcolor=\"ffffff\">";
+    static const char TAIL[] = "</p><hr><em>TinyWebServer</em></body></html>";
+    string_view status = TEMPLATE.Known(code_) ? TEMPLATE.Status(code_) : string_view("Bad Request");
+    char codeBuf[24];
+    char* codeEnd = codeBuf + sizeof(codeBuf);
+    char* code = ResponseTemplate::FormatUint(code_ < 0 ? 0 : code_,codeEnd);
 
-    buff.Append("Content-lenth:"+ to_string(body.size())+"\r\n\r\n");
-    buff.Append(body); 
+    size_t len = (sizeof(HEAD) - 1) + (codeEnd - code) + 3 + status.size() + 1 +
+                 3 + message.size() + (sizeof(TAIL) - 1);
+    buff.Append("Content-type: text/html\r\n",25);
+    ResponseTemplate::AppendContentLength(buff,len);
+    if(isHead_){
+        return;
+    }
+    buff.Append(HEAD,sizeof(HEAD) - 1);
+    buff.Append(code,codeEnd - code);
+    buff.Append(" : ",3);
+    buff.Append(status.data(),status.size());
+    buff.Append("\n<p>",4);
+    buff.Append(message.data(),message.size());
+    buff.Append(TAIL,sizeof(TAIL) - 1);
 }
-
-
-#endif
\ No newline at end of file
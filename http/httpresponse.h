@@ -6,22 +6,58 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <time.h>
+#include <random>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "../time/cachedclock.h"
+#include "filecache.h"
+#include "responsetemplate.h"
+#include "httprequest.h"
 
 class HttpResponse{
 public:
+    static const int MAX_RANGES = 8;    // 区间更多的Range请求按整个文件响应，避免大量小区间放大开销
+
+    // 正文的一段：先发写缓冲区中到textEnd为止的文本，再发文件的[off, off+len)；
+    // withHeader表示从小文件层blob的开头发送（包含预先拼好的头部）
+    struct BodyPiece {
+        size_t textEnd;
+        off_t off;
+        size_t len;
+        bool withHeader;
+    };
+
     HttpResponse();
     ~HttpResponse();
 
-    void Init(const std:string& srcDir,std::string& path,bool isKeepAlive = false,int code =-1);
+    void Init(const char* srcDir,std::string& path,bool isKeepAlive = false,int code =-1,
+              int acceptEncoding = 0,bool isHead = false);  // srcDir用const char*，避免每个请求构造临时string；acceptEncoding见HttpRequest::ENCODING
+                                                            // isHead：HEAD请求，头部（含Content-length）照常生成，不发正文
+    // 条件请求头，视图需在MakeResponse之前保持有效；Init时清空
+    void SetConditional(std::string_view ifNoneMatch,std::string_view ifModifiedSince);
+    void SetRange(std::string_view range,std::string_view ifRange);
+    // 路由处理函数使用：改发另一个文件、改状态码，或直接给出正文（不经过文件缓存）
+    void SetPath(std::string_view path) {path_.assign(path.data(),path.size());}
+    void SetCode(int code) {code_ = code;}
+    void SetAllow(std::string_view allow) {allow_.assign(allow.data(),allow.size());}    // 405的Allow头
+    void SetContent(std::string_view contentType,std::string_view content);
+    // 处理函数执行之后、MakeResponse之前调用：响应能否不访问磁盘生成（直接给出的正文，
+    // 或文件——出错时是对应的错误页——已在缓存中且内容在内存里）。命中的文件留给MakeResponse使用
+    bool CacheHit();
     void MakeResponse(Buffer& buff);
-    void UnmapFile();
-    char* File();
+    void UnmapFile();       // 释放对缓存文件的引用
+    FileCache::FilePtr DetachFile();    // 把正文文件的引用交给连接，发送完之前文件不会被释放
+    const char* File();
     size_t FileLen() const;
-    void ErrorContent(Buffer& buff,std::string message);
+    void ErrorContent(Buffer& buff,std::string_view message);
     int Code() const {return code_;}
+    // MakeResponse之后由连接按顺序取出正文各段，和DetachFile得到的文件一起组成iovec链
+    int PieceCount() const {return pieceCnt_;}
+    const BodyPiece* Pieces() const {return pieces_;}
+
+    static std::string FileType(const std::string& path);  // 按后缀判断MIME类型
 
 private:
     void AddStateLine_(Buffer &buff);
@@ -29,20 +65,48 @@ private:
     void AddContent_(Buffer &buff);
 
     void ErrorHtml_();
-    std::string GetFileType_();
+    bool NotModified_() const;
+
+    struct Range {
+        off_t off;
+        size_t len;
+    };
+    int ParseRange_();              // -1: 忽略Range，按整个文件响应  0: 无法满足(416)  >0: 区间个数
+    bool IfRangeMatch_() const;
+    void AddRangeContent_(Buffer &buff);
+    void AddPiece_(Buffer &buff,off_t off,size_t len,bool withHeader);
+    void AddErrorBody_(Buffer &buff);
+    size_t FormatContentRange_(char* buf,const Range& r) const;
 
     int code_;
-    bool isKeepAliove_;
+    bool isKeepAlive_;
+    bool isHead_;
+    int acceptEncoding_;
+    std::string allow_;
+    std::string_view ifNoneMatch_;
+    std::string_view ifModifiedSince_;
+    std::string_view range_;
+    std::string_view ifRange_;
+
+    Range ranges_[MAX_RANGES];
+    int rangeCnt_;
+    BodyPiece pieces_[MAX_RANGES];
+    int pieceCnt_;
 
     std::string path_;
     std::string srcDir_;
 
-    char* mmFile_;
-    struct stat mmFileStat_;
+    bool hasContent_;
+    std::string contentType_;
+    std::string content_;
+
+    FileCache::FilePtr file_;   // 来自FileCache，stat/open/mmap都在缓存里完成
 
     static const std::unordered_map<std::string,std::string> SUFFIX_TYPE;
     static const std::unordered_map<int,std::string> CODE_STATUS;
     static const std::unordered_map<int,std::string> CODE_PATH;
+    static const ResponseTemplate TEMPLATE;    // 由CODE_STATUS在启动时生成
+    static const std::string BOUNDARY;          // multipart/byteranges分隔符，启动时随机生成
 };
 
 
@@ -0,0 +1,335 @@
+#include "multipart.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "../log/log.h"
+
+using namespace std;
+
+string MultipartParser::uploadDir;
+size_t MultipartParser::maxFileSize = MultipartParser::DEFAULT_MAX_FILE;
+
+MultipartParser::MultipartParser(){
+    fd_ = -1;
+    state_ = EPILOGUE;
+    parts_ = 0;
+    tooLarge_ = false;
+    isFile_ = false;
+}
+
+// Content-Type: multipart/form-data; boundary=----WebKitFormBoundaryxxxx
+bool MultipartParser::Init(string_view contentType){
+    Clear();
+    string_view boundary = Param_(contentType,"boundary");
+    if(boundary.empty() || boundary.size() > MAX_BOUNDARY){
+        LOG_ERROR("Bad multipart boundary");
+        return false;
+    }
+    delim_.assign("\r\n--",4);
+    delim_.append(boundary.data(),boundary.size());
+    size_t m = delim_.size();
+    for(size_t i = 0; i < 256; i++) skip_[i] = m;
+    for(size_t i = 0; i + 1 < m; i++) skip_[static_cast<unsigned char>(delim_[i])] = m - 1 - i;
+    // 第一个分隔符前面没有CRLF，预先放一个进carry_，和后面的分隔符统一处理
+    carry_.assign("\r\n",2);
+    state_ = PREAMBLE;
+    return true;
+}
+
+// 处理函数没有认领的文件随请求一起删除：没有完整收到的、路由处理函数不需要的，
+// 以及处理函数没有执行（如出错）时的全部文件
+void MultipartParser::Clear(){
+    if(fd_ >= 0){
+        close(fd_);
+        fd_ = -1;
+    }
+    for(const File& file : files_){
+        if(!file.claimed){
+            unlink(file.path.c_str());
+        }
+    }
+    state_ = EPILOGUE;
+    carry_.clear();
+    header_.clear();
+    name_.clear();
+    value_.clear();
+    parts_ = 0;
+    tooLarge_ = false;
+    isFile_ = false;
+    fields_.clear();
+    files_.clear();
+}
+
+void MultipartParser::Discard(){
+    for(const File& file : files_){
+        unlink(file.path.c_str());
+    }
+    files_.clear();
+}
+
+const string& MultipartParser::Claim(size_t i){
+    files_[i].claimed = true;
+    return files_[i].path;
+}
+
+bool MultipartParser::OnData(const char* data,size_t len){
+    const char* p = data;
+    const char* end = data + len;
+    while(p < end){
+        switch(state_){
+        case PREAMBLE:
+        case PART_DATA:
+            p = Body_(p,end);
+            if(!p) return false;
+            break;
+        case AFTER_BOUNDARY: {     // 分隔符后允许有空白，然后是CRLF或"--"
+            char ch = *p++;
+            if(ch == '-'){
+                state_ = AFTER_BOUNDARY_DASH;
+            }else if(ch == '\n'){
+                header_.clear();
+                state_ = PART_HEADER;
+            }else if(ch != '\r' && ch != ' ' && ch != '\t'){
+                return Fail_(false);
+            }
+            break;
+        }
+        case AFTER_BOUNDARY_DASH:
+            if(*p++ != '-') return Fail_(false);
+            state_ = EPILOGUE;
+            break;
+        case PART_HEADER: {         // 按行收集，遇到空行结束
+            const char* nl = static_cast<const char*>(memchr(p,'\n',end - p));
+            const char* lineEnd = nl ? nl + 1 : end;
+            header_.append(p,lineEnd);
+            p = lineEnd;
+            if(header_.size() > MAX_PART_HEADER){
+                return Fail_(false);
+            }
+            size_t n = header_.size();
+            if(nl && (header_ == "\r\n" || header_ == "\n" ||
+               (n >= 2 && header_[n - 2] == '\n') ||
+               (n >= 3 && header_[n - 3] == '\n' && header_[n - 2] == '\r'))){
+                if(!BeginPart_()) return false;
+                state_ = PART_DATA;
+            }
+            break;
+        }
+        case EPILOGUE:              // 结束分隔符之后的内容忽略
+            p = end;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MultipartParser::OnEnd(){
+    if(state_ != EPILOGUE){
+        LOG_ERROR("Multipart body truncated");
+        return Fail_(false);
+    }
+    return true;
+}
+
+// 在[p,end)中找分隔符，返回分隔符之后的位置；没找到时返回end，片尾可能的分隔符开头留在carry_里
+const char* MultipartParser::Body_(const char* p,const char* end){
+    size_t m = delim_.size();
+    size_t n = end - p;
+    if(!carry_.empty()){
+        // carry_后面接上新数据的前m-1个字节，只在这个小窗口里找从carry_开始的分隔符
+        size_t c = carry_.size();
+        size_t take = n < m - 1 ? n : m - 1;
+        carry_.append(p,take);
+        const char* w = carry_.data();
+        const char* hit = Search_(w,w + carry_.size());
+        if(hit && static_cast<size_t>(hit - w) < c){
+            size_t i = hit - w;
+            if(!Data_(w,i)) return nullptr;
+            carry_.clear();
+            if(state_ == PART_DATA && !EndPart_()) return nullptr;
+            state_ = AFTER_BOUNDARY;
+            return p + (i + m - c);
+        }
+        // 新数据太短，窗口末尾仍可能是分隔符的开头
+        for(size_t i = 0; i < c; i++){
+            size_t rest = carry_.size() - i;
+            if(rest < m && memcmp(w + i,delim_.data(),rest) == 0){
+                if(!Data_(w,i)) return nullptr;
+                carry_.erase(0,i);
+                return end;
+            }
+        }
+        if(!Data_(w,c)) return nullptr;
+        carry_.clear();
+    }
+    const char* hit = Search_(p,end);
+    if(hit){
+        if(!Data_(p,hit - p)) return nullptr;
+        if(state_ == PART_DATA && !EndPart_()) return nullptr;
+        state_ = AFTER_BOUNDARY;
+        return hit + m;
+    }
+    size_t k = n < m - 1 ? n : m - 1;
+    while(k > 0 && memcmp(end - k,delim_.data(),k) != 0){
+        k--;
+    }
+    if(!Data_(p,n - k)) return nullptr;
+    carry_.assign(end - k,k);
+    return end;
+}
+
+// Horspool：按窗口最后一个字节查表跳跃，分隔符越长跳得越远
+const char* MultipartParser::Search_(const char* begin,const char* end) const{
+    size_t m = delim_.size();
+    const char* p = begin;
+    while(static_cast<size_t>(end - p) >= m){
+        unsigned char last = static_cast<unsigned char>(p[m - 1]);
+        if(last == static_cast<unsigned char>(delim_[m - 1]) && memcmp(p,delim_.data(),m - 1) == 0){
+            return p;
+        }
+        p += skip_[last];
+    }
+    return nullptr;
+}
+
+bool MultipartParser::Data_(const char* data,size_t len){
+    if(state_ == PREAMBLE || len == 0){
+        return true;
+    }
+    if(!isFile_){
+        if(value_.size() + len > MAX_FIELD){
+            return Fail_(true);
+        }
+        value_.append(data,len);
+        return true;
+    }
+    if(fd_ < 0){
+        return true;        // 没有选择文件（filename为空）
+    }
+    File& file = files_.back();
+    if(file.size + len > maxFileSize){
+        return Fail_(true);
+    }
+    file.size += len;
+    while(len > 0){
+        ssize_t n = write(fd_,data,len);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            LOG_ERROR("Write upload %s failed, errno:%d",file.path.c_str(),errno);
+            return Fail_(false);
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 解析部分头：Content-Disposition: form-data; name="x"; filename="y" 和 Content-Type
+bool MultipartParser::BeginPart_(){
+    if(++parts_ > MAX_PARTS){
+        return Fail_(true);
+    }
+    string_view disposition, type;
+    string_view rest(header_);
+    while(!rest.empty()){
+        size_t nl = rest.find('\n');
+        string_view line = rest.substr(0,nl);
+        rest = (nl == string_view::npos) ? string_view() : rest.substr(nl + 1);
+        if(!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        size_t colon = line.find(':');
+        if(colon == string_view::npos) continue;
+        string_view name = line.substr(0,colon);
+        string_view value = line.substr(colon + 1);
+        while(!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        if(name.size() == 19 && strncasecmp(name.data(),"Content-Disposition",19) == 0){
+            disposition = value;
+        }else if(name.size() == 12 && strncasecmp(name.data(),"Content-Type",12) == 0){
+            type = value;
+        }
+    }
+    if(disposition.size() < 9 || strncasecmp(disposition.data(),"form-data",9) != 0){
+        LOG_ERROR("Bad multipart Content-Disposition");
+        return Fail_(false);
+    }
+    string_view name = Param_(disposition,"name");
+    name_.assign(name.data(),name.size());
+    value_.clear();
+    // 带filename参数的部分都当作文件，不管客户端声明的类型
+    isFile_ = disposition.find("filename=") != string_view::npos;
+    if(!isFile_){
+        return true;
+    }
+    string_view filename = Param_(disposition,"filename");
+    if(filename.empty()){
+        return true;
+    }
+    // 文件名由服务器生成，客户端给的文件名不进入路径
+    File file;
+    file.name = name_;
+    file.filename.assign(filename.data(),filename.size());
+    file.contentType.assign(type.data(),type.size());
+    file.path = uploadDir + "/upload-XXXXXX";
+    file.size = 0;
+    file.claimed = false;
+    fd_ = mkostemp(&file.path[0],O_CLOEXEC);
+    if(fd_ < 0){
+        LOG_ERROR("Create upload file in %s failed, errno:%d",uploadDir.c_str(),errno);
+        return Fail_(false);
+    }
+    files_.push_back(std::move(file));
+    return true;
+}
+
+bool MultipartParser::EndPart_(){
+    if(isFile_){
+        if(fd_ >= 0){
+            LOG_DEBUG("Upload %s -> %s, %zu bytes",files_.back().filename.c_str(),
+                      files_.back().path.c_str(),files_.back().size);
+            close(fd_);
+            fd_ = -1;
+        }
+    }else if(!name_.empty()){
+        fields_[name_] = std::move(value_);
+    }
+    value_.clear();
+    return true;
+}
+
+bool MultipartParser::Fail_(bool tooLarge){
+    tooLarge_ = tooLarge;
+    state_ = FAILED;
+    if(fd_ >= 0){
+        close(fd_);
+        fd_ = -1;
+    }
+    Discard();
+    return false;
+}
+
+// 取 key=value 或 key="value"，key前面必须是分号或空白，避免name匹配到filename
+string_view MultipartParser::Param_(string_view header,string_view key){
+    size_t pos = 0;
+    while((pos = header.find(key,pos)) != string_view::npos){
+        size_t eq = pos + key.size();
+        bool start = pos > 0 && (header[pos - 1] == ';' || header[pos - 1] == ' ' || header[pos - 1] == '\t');
+        if(start && eq < header.size() && header[eq] == '='){
+            string_view value = header.substr(eq + 1);
+            if(!value.empty() && value.front() == '"'){
+                size_t quote = value.find('"',1);
+                return quote == string_view::npos ? string_view() : value.substr(1,quote - 1);
+            }
+            value = value.substr(0,value.find(';'));
+            while(!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+        pos = eq;
+    }
+    return string_view();
+}
@@ -0,0 +1,91 @@
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+
+#include "bodyreader.h"
+
+// multipart/form-data的流式解析：请求体分片到达，用Boyer-Moore-Horspool在每片里找分隔符
+// "\r\n--boundary"，片尾可能是分隔符开头的几个字节先留下，和下一片一起判断。
+// 普通字段收进fields_；文件字段边到达边写进uploadDir下的新文件，不在内存里积累。
+// 每个字段、每个文件、字段个数都有上限，出错时删除已写的文件；
+// 请求结束时处理函数没有认领的文件也会删除，上传的文件不会在磁盘上累积
+class MultipartParser : public BodySink {
+public:
+    static const size_t MAX_BOUNDARY = 70;
+    static const size_t MAX_PART_HEADER = 8192;
+    static const size_t MAX_FIELD = 64 << 10;       // 普通字段值的上限
+    static const size_t MAX_PARTS = 64;
+    static const size_t DEFAULT_MAX_FILE = 512 << 20;
+
+    static std::string uploadDir;   // 为空时不接收multipart请求
+    static size_t maxFileSize;      // 单个文件的上限
+
+    struct File {
+        std::string name;           // 表单字段名
+        std::string filename;       // 客户端给的文件名，只供参考，不用来拼路径
+        std::string contentType;
+        std::string path;           // 保存的位置
+        size_t size;
+        bool claimed;               // 处理函数认领后，请求结束时不再删除
+    };
+
+    MultipartParser();
+    ~MultipartParser() override { Clear(); }
+    MultipartParser(const MultipartParser&) = delete;
+    MultipartParser& operator=(const MultipartParser&) = delete;
+
+    bool Init(std::string_view contentType);    // 取出boundary，没有或太长返回false
+    void Clear();               // 请求结束：删除没有被认领的文件（包括没收完整的）
+    void Discard();             // 删除这次请求写下的所有文件
+    const std::string& Claim(size_t i);     // 认领第i个文件，返回它的路径，之后由调用者负责移走或删除
+
+    bool OnData(const char* data, size_t len) override;
+    bool OnEnd() override;
+    bool TooLarge() const override { return tooLarge_; }
+
+    const std::unordered_map<std::string, std::string>& Fields() const { return fields_; }
+    const std::vector<File>& Files() const { return files_; }
+
+private:
+    enum STATE {
+        PREAMBLE,           // 第一个分隔符之前，内容丢弃
+        AFTER_BOUNDARY,     // 分隔符之后：CRLF开始下一部分，"--"表示结束
+        AFTER_BOUNDARY_DASH,
+        PART_HEADER,
+        PART_DATA,
+        EPILOGUE,
+        FAILED,
+    };
+
+    bool Data_(const char* data, size_t len);       // 当前部分的内容
+    const char* Body_(const char* p, const char* end); // PREAMBLE/PART_DATA里找分隔符
+    bool BeginPart_();
+    bool EndPart_();
+    bool Fail_(bool tooLarge);
+    const char* Search_(const char* begin, const char* end) const;
+    static std::string_view Param_(std::string_view header, std::string_view key);
+
+    STATE state_;
+    std::string delim_;         // "\r\n--boundary"
+    size_t skip_[256];          // Horspool坏字符表
+    std::string carry_;         // 上一片末尾可能是分隔符开头的字节
+    std::string header_;
+    size_t parts_;
+    bool tooLarge_;
+
+    // 当前部分
+    bool isFile_;
+    std::string name_;
+    std::string value_;
+    int fd_;
+
+    std::unordered_map<std::string, std::string> fields_;
+    std::vector<File> files_;
+};
+
+#endif //MULTIPART_H
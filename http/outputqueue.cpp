@@ -0,0 +1,124 @@
+#include "outputqueue.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+OutputQueue::OutputQueue(){
+    textQueued_ = idx_ = toWrite_ = 0;
+}
+
+void OutputQueue::Clear(){
+    text_.RetrieveAll();
+    textQueued_ = idx_ = toWrite_ = 0;
+    iov_.clear();
+    fd_.clear();
+    off_.clear();
+    owners_.clear();
+}
+
+void OutputQueue::Push_(const char* data,size_t len,int fd,off_t off){
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = len;
+    iov_.push_back(iov);
+    fd_.push_back(fd);
+    off_.push_back(off);
+    toWrite_ += len;
+}
+
+// 文本先记偏移，Seal时再换成指针
+void OutputQueue::AddText(size_t end){
+    if(end <= textQueued_){
+        return;
+    }
+    // 紧跟在上一段文本后面时直接合并
+    if(!iov_.empty() && fd_.back() < 0 && off_.back() == -1){
+        iov_.back().iov_len += end - textQueued_;
+        toWrite_ += end - textQueued_;
+    }else{
+        Push_(reinterpret_cast<const char*>(textQueued_),end - textQueued_,-1,-1);
+    }
+    textQueued_ = end;
+}
+
+// 前面的文本由调用者先AddText入队：一个响应的文本是一次生成的，
+// multipart各部分的分隔行和结尾都已经在缓冲区里，不能在这里全部排到正文前面
+void OutputQueue::AddMemory(const char* data,size_t len){
+    if(len > 0){
+        Push_(data,len,-1,0);
+    }
+}
+
+void OutputQueue::AddFile(int fd,off_t off,size_t len){
+    if(len > 0){
+        Push_(nullptr,len,fd,off);
+    }
+}
+
+void OutputQueue::AddOwner(FileCache::FilePtr owner){
+    if(owner){
+        owners_.push_back(std::move(owner));
+    }
+}
+
+void OutputQueue::Seal(){
+    AddText(text_.ReadableBytes());
+    const char* base = text_.Peek();
+    for(size_t i = 0; i < iov_.size(); i++){
+        if(fd_[i] < 0 && off_[i] == -1){
+            iov_[i].iov_base = const_cast<char*>(base + reinterpret_cast<uintptr_t>(iov_[i].iov_base));
+            off_[i] = 0;
+        }
+    }
+}
+
+ssize_t OutputQueue::Write(int fd,int* saveErrno){
+    ssize_t len;
+    if(fd_[idx_] < 0){
+        size_t end = idx_;
+        while(end < iov_.size() && fd_[end] < 0 && end - idx_ < IOV_MAX) end++;
+        // 用sendmsg而不是writev：对端已关闭时返回EPIPE，不产生SIGPIPE。
+        // 后面还有文件段或下一批内存段时加MSG_MORE，让内核先攒着，和后面的数据合成满的报文段
+        struct msghdr msg = {};
+        msg.msg_iov = &iov_[idx_];
+        msg.msg_iovlen = end - idx_;
+        len = sendmsg(fd,&msg,end == iov_.size() ? MSG_NOSIGNAL : MSG_MORE | MSG_NOSIGNAL);
+    }else{
+        off_t off = off_[idx_];
+        len = sendfile(fd,fd_[idx_],&off,iov_[idx_].iov_len);
+        if(len == 0){
+            errno = EIO;    // 文件在发送期间被截断，无法补足Content-length，只能断开
+            len = -1;
+        }
+    }
+    if(len < 0){
+        *saveErrno = errno;
+        return len;
+    }
+    Advance_(len);
+    return len;
+}
+
+// 跳过已写完的段，停在写了一半的段上
+void OutputQueue::Advance_(size_t len){
+    toWrite_ -= len;
+    while(idx_ < iov_.size() && len >= iov_[idx_].iov_len){
+        len -= iov_[idx_].iov_len;
+        idx_++;
+    }
+    if(len > 0){
+        if(fd_[idx_] >= 0){
+            off_[idx_] += len;
+        }else{
+            iov_[idx_].iov_base = (uint8_t*)iov_[idx_].iov_base + len;
+        }
+        iov_[idx_].iov_len -= len;
+    }
+}
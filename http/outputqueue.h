@@ -0,0 +1,49 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "../buffer/buffer.h"
+#include "filecache.h"
+
+// 连接的输出队列：任意多段按顺序发送，段的种类有
+//   文本：响应头、multipart分隔行等，都追加在自己的Text()缓冲区里
+//   内存：缓存的小文件blob、文件映射的某个区间，由AddOwner持有的引用保证有效
+//   文件：fd的某个区间，用sendfile发送
+// 先追加全部内容再Seal，Seal时才取文本缓冲区的指针（追加时可能换块）。
+// Write一次系统调用：连续的内存段合成一次sendmsg(MSG_NOSIGNAL)，最多IOV_MAX段，后面还有数据时加MSG_MORE；
+// 文件段用sendfile（没有MSG_NOSIGNAL，WebServer启动时忽略SIGPIPE）。部分发送后记录进度，下次从断点继续
+class OutputQueue {
+public:
+    OutputQueue();
+
+    Buffer& Text() { return text_; }
+    void AddText(size_t end);               // 文本缓冲区中到end为止、尚未入队的文本
+    void AddMemory(const char* data, size_t len);   // 排在已入队的文本之后
+    void AddFile(int fd, off_t off, size_t len);
+    void AddOwner(FileCache::FilePtr owner);
+    void Seal();
+
+    ssize_t Write(int fd, int* saveErrno);
+    size_t Bytes() const { return toWrite_; }
+    size_t SegmentCount() const { return iov_.size(); }
+    void Clear();                           // 释放文本和引用，保留vector容量
+
+private:
+    void Push_(const char* data, size_t len, int fd, off_t off);
+    void Advance_(size_t len);
+
+    Buffer text_;
+    size_t textQueued_;                     // 已入队的文本长度
+    // 三个数组按段一一对应；Seal之前文本段的iov_base存的是相对Text()的偏移
+    std::vector<struct iovec> iov_;
+    std::vector<int> fd_;                   // -1表示内存段
+    std::vector<off_t> off_;                // 文件段已发送到的偏移；Seal之前-1表示文本段
+    std::vector<FileCache::FilePtr> owners_;
+    size_t idx_;
+    size_t toWrite_;
+};
+
+#endif //OUTPUT_QUEUE_H
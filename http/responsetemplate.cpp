@@ -0,0 +1,76 @@
+#include "responsetemplate.h"
+
+using namespace std;
+
+ResponseTemplate::ResponseTemplate(const unordered_map<int, string>& codeStatus) {
+    for(int i = 0; i <= MAX_CODE - MIN_CODE; i++) index_[i] = -1;
+    entries_.reserve(codeStatus.size());
+    for(const auto& kv : codeStatus) {
+        int code = kv.first;
+        if(code < MIN_CODE || code > MAX_CODE) continue;
+        Entry entry;
+        entry.status = kv.second;
+        string statusLine = "HTTP/1.1 " + to_string(code) + " " + kv.second + "\r\n";
+        entry.prefix[0] = statusLine + "Connection: close\r\n";
+        entry.prefix[1] = statusLine + "Connection: keep-alive\r\n" +
+                          "keep-alive: max=6, timeout=120\r\n";
+        string body = "<html><title>Error</title><body bgcolor=\"ffffff\">" +
+                      to_string(code) + " : " + kv.second + "\n" +
+                      "<p>File NotFound!</p><hr><em>TinyWebServer</em></body></html>";
+        entry.errorBody = "Content-type: text/html\r\nContent-length: " +
+                          to_string(body.size()) + "\r\n\r\n" + body;
+        index_[code - MIN_CODE] = static_cast<int>(entries_.size());
+        entries_.push_back(std::move(entry));
+    }
+}
+
+string_view ResponseTemplate::Prefix(int code, bool keepAlive) const {
+    int i = Index_(code);
+    return i < 0 ? string_view() : string_view(entries_[i].prefix[keepAlive ? 1 : 0]);
+}
+
+string_view ResponseTemplate::ErrorBody(int code) const {
+    int i = Index_(code);
+    return i < 0 ? string_view() : string_view(entries_[i].errorBody);
+}
+
+string_view ResponseTemplate::Status(int code) const {
+    int i = Index_(code);
+    return i < 0 ? string_view() : string_view(entries_[i].status);
+}
+
+// 两位一组查表，除法次数减半
+char* ResponseTemplate::FormatUint(size_t n, char* end) {
+    static const char DIGITS[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char* p = end;
+    while(n >= 100) {
+        size_t r = (n % 100) * 2;
+        n /= 100;
+        *--p = DIGITS[r + 1];
+        *--p = DIGITS[r];
+    }
+    if(n >= 10) {
+        *--p = DIGITS[n * 2 + 1];
+        *--p = DIGITS[n * 2];
+    } else {
+        *--p = static_cast<char>('0' + n);
+    }
+    return p;
+}
+
+void ResponseTemplate::AppendContentLength(Buffer& buff, size_t len) {
+    static const char HEAD[] = "Content-length: ";
+    char buf[48];
+    char* end = buf + sizeof(buf);
+    *--end = '\n';
+    *--end = '\r';
+    *--end = '\n';
+    *--end = '\r';
+    char* p = FormatUint(len, end);
+    p -= sizeof(HEAD) - 1;
+    memcpy(p, HEAD, sizeof(HEAD) - 1);
+    buff.Append(p, buf + sizeof(buf) - p);
+}
@@ -0,0 +1,48 @@
+#ifndef RESPONSE_TEMPLATE_H
+#define RESPONSE_TEMPLATE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+
+#include "../buffer/buffer.h"
+
+// 响应模板：启动时按状态码表预先拼好固定的响应头片段，
+// 包括 状态行+Connection头 的两种变体，以及错误页文件缺失时使用的完整错误正文。
+// 每个请求只做片段拼接和Content-length的整数格式化，不构造std::string，不分配堆内存
+class ResponseTemplate {
+public:
+    static const int MIN_CODE = 100;
+    static const int MAX_CODE = 599;
+
+    ResponseTemplate(const std::unordered_map<int, std::string>& codeStatus);
+
+    bool Known(int code) const { return Index_(code) >= 0; }
+    // "HTTP/1.1 <code> <status>\r\n" + Connection头
+    std::string_view Prefix(int code, bool keepAlive) const;
+    // "Content-type/Content-length" + 内置的错误页正文
+    std::string_view ErrorBody(int code) const;
+    std::string_view Status(int code) const;
+
+    // 把n的十进制写到end之前，返回起始位置；buf至少要有20字节
+    static char* FormatUint(size_t n, char* end);
+    static void AppendContentLength(Buffer& buff, size_t len);   // "Content-length: n\r\n\r\n"
+
+private:
+    struct Entry {
+        std::string status;
+        std::string prefix[2];      // [0]: close  [1]: keep-alive
+        std::string errorBody;
+    };
+
+    int Index_(int code) const {
+        return (code < MIN_CODE || code > MAX_CODE) ? -1 : index_[code - MIN_CODE];
+    }
+
+    std::vector<Entry> entries_;
+    int index_[MAX_CODE - MIN_CODE + 1];
+};
+
+#endif //RESPONSE_TEMPLATE_H
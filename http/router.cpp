@@ -0,0 +1,287 @@
+#include "router.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "httprequest.h"
+#include "httpresponse.h"
+#include "../log/log.h"
+
+using namespace std;
+
+string_view RouteParams::Get(string_view name) const{
+    for(int i = 0; i < cnt_; i++){
+        if(names_[i] == name){
+            return values_[i];
+        }
+    }
+    return string_view();
+}
+
+Router::BuildNode::BuildNode(KIND k,string_view t) : kind(k), text(t){
+    for(int i = 0; i < METHOD_NUM; i++) handler[i] = -1;
+}
+
+Router::Router() : frozen_(false), root_(new BuildNode(STATIC,"")) {}
+
+Router::~Router() = default;
+
+Router* Router::Instance(){
+    static Router router;
+    return &router;
+}
+
+int Router::MethodIndex(string_view method){
+    switch(method.size()){
+    case 3:
+        if(method == "GET") return GET;
+        if(method == "PUT") return PUT;
+        break;
+    case 4:
+        if(method == "HEAD") return HEAD;
+        if(method == "POST") return POST;
+        break;
+    case 5:
+        if(method == "PATCH") return PATCH;
+        break;
+    case 6:
+        if(method == "DELETE") return DELETE;
+        break;
+    case 7:
+        if(method == "OPTIONS") return OPTIONS;
+        break;
+    default:
+        break;
+    }
+    return -1;
+}
+
+string Router::AllowList(uint32_t allow){
+    static const char* const NAME[METHOD_NUM] = {"GET","HEAD","POST","PUT","DELETE","PATCH","OPTIONS"};
+    string list;
+    for(int m = 0; m < METHOD_NUM; m++){
+        if(allow & (1u << m)){
+            if(!list.empty()) list += ", ";
+            list += NAME[m];
+        }
+    }
+    return list;
+}
+
+bool Router::Add(string_view method,string_view pattern,Handler handler,bool nonBlocking,bool upload){
+    int m = MethodIndex(method);
+    if(frozen_ || m < 0 || pattern.empty() || pattern[0] != '/' || !handler){
+        LOG_ERROR("Add route %.*s %.*s failed",(int)method.size(),method.data(),(int)pattern.size(),pattern.data());
+        return false;
+    }
+    if(!Insert_(root_.get(),pattern,m,static_cast<int>(handlers_.size()))){
+        LOG_ERROR("Bad or duplicate route %.*s %.*s",(int)method.size(),method.data(),(int)pattern.size(),pattern.data());
+        return false;
+    }
+    handlers_.push_back(std::move(handler));
+    nonBlocking_.push_back(nonBlocking);
+    upload_.push_back(upload);
+    return true;
+}
+
+// 标准的基数树插入：与已有子节点共享前缀时把子节点拆成两段
+bool Router::Insert_(BuildNode* node,string_view pattern,int method,int handler){
+    if(pattern.empty()){
+        if(node->handler[method] >= 0){
+            return false;
+        }
+        node->handler[method] = handler;
+        return true;
+    }
+    if(pattern[0] == ':' || pattern[0] == '*'){
+        KIND kind = pattern[0] == ':' ? PARAM : WILD;
+        size_t end = pattern.find('/');
+        string_view name = pattern.substr(1,end == string_view::npos ? string_view::npos : end - 1);
+        if(name.empty() || (kind == WILD && end != string_view::npos)){
+            return false;   // 参数要有名字，通配只能在最后
+        }
+        unique_ptr<BuildNode>& child = (kind == PARAM) ? node->param : node->wild;
+        if(!child){
+            child.reset(new BuildNode(kind,name));
+        }else if(child->text != name){
+            return false;   // 同一位置的参数名必须一致
+        }
+        return Insert_(child.get(),pattern.substr(1 + name.size()),method,handler);
+    }
+    size_t end = pattern.find_first_of(":*");
+    string_view text = pattern.substr(0,end);
+    for(auto& child : node->children){
+        if(child->text[0] != text[0]){
+            continue;
+        }
+        size_t common = 0;
+        while(common < text.size() && common < child->text.size() && text[common] == child->text[common]){
+            common++;
+        }
+        if(common < child->text.size()){
+            unique_ptr<BuildNode> split(new BuildNode(STATIC,string_view(child->text).substr(0,common)));
+            child->text.erase(0,common);
+            split->children.push_back(std::move(child));
+            child = std::move(split);
+        }
+        return Insert_(child.get(),pattern.substr(common),method,handler);
+    }
+    node->children.emplace_back(new BuildNode(STATIC,text));
+    return Insert_(node->children.back().get(),pattern.substr(text.size()),method,handler);
+}
+
+// 按层压平：一个节点的静态子节点排在一起，之后是参数和通配子节点
+void Router::Freeze(){
+    if(frozen_){
+        return;
+    }
+    vector<const BuildNode*> order;
+    order.push_back(root_.get());
+    nodes_.assign(1,Node());
+    pool_.clear();
+    for(size_t i = 0; i < order.size(); i++){
+        const BuildNode* b = order[i];
+        vector<const BuildNode*> kids;
+        for(auto& child : b->children){
+            kids.push_back(child.get());
+        }
+        sort(kids.begin(),kids.end(),[](const BuildNode* x,const BuildNode* y){ return x->text[0] < y->text[0]; });
+
+        Node node;
+        node.textOff = static_cast<uint32_t>(pool_.size());
+        node.textLen = static_cast<uint16_t>(b->text.size());
+        node.first = b->text.empty() ? '\0' : b->text[0];
+        node.kind = b->kind;
+        node.firstChild = static_cast<uint32_t>(order.size());
+        node.childCnt = static_cast<uint32_t>(kids.size());
+        for(const BuildNode* kid : kids){
+            order.push_back(kid);
+        }
+        node.param = b->param ? static_cast<int32_t>(order.size()) : -1;
+        if(b->param) order.push_back(b->param.get());
+        node.wild = b->wild ? static_cast<int32_t>(order.size()) : -1;
+        if(b->wild) order.push_back(b->wild.get());
+        for(int m = 0; m < METHOD_NUM; m++){
+            node.handler[m] = b->handler[m];
+        }
+        pool_.append(b->text);
+        nodes_.resize(order.size());
+        nodes_[i] = node;
+    }
+    root_.reset();
+    frozen_ = true;
+    LOG_INFO("Router frozen: %zu routes, %zu nodes",handlers_.size(),nodes_.size());
+}
+
+uint32_t Router::Mask_(const int32_t* handler){
+    uint32_t mask = 0;
+    for(int m = 0; m < METHOD_NUM; m++){
+        if(handler[m] >= 0) mask |= 1u << m;
+    }
+    return mask;
+}
+
+// 当前节点的文本已经匹配，path是剩余部分；静态子节点失败时回溯到参数、通配。
+// 走到的每个能匹配整条路径的节点都把它的方法并进allow，405时就是完整的Allow列表
+bool Router::Match_(uint32_t idx,string_view path,int method,RouteParams* params,
+                    uint32_t* allow,int* handler) const{
+    const Node& node = nodes_[idx];
+    if(path.empty()){
+        *allow |= Mask_(node.handler);
+        if(node.handler[method] >= 0){
+            *handler = node.handler[method];
+            return true;
+        }
+    }else{
+        // 静态子节点首字节各不相同，最多一个候选
+        for(uint32_t i = node.firstChild; i < node.firstChild + node.childCnt; i++){
+            const Node& child = nodes_[i];
+            if(child.first != path[0]){
+                continue;
+            }
+            if(path.size() >= child.textLen && memcmp(path.data(),pool_.data() + child.textOff,child.textLen) == 0 &&
+               Match_(i,path.substr(child.textLen),method,params,allow,handler)){
+                return true;
+            }
+            break;
+        }
+        if(node.param >= 0 && params->cnt_ < RouteParams::MAX_PARAMS){
+            string_view seg = path.substr(0,path.find('/'));
+            if(!seg.empty()){
+                const Node& child = nodes_[node.param];
+                int cnt = params->cnt_++;
+                params->names_[cnt] = string_view(pool_.data() + child.textOff,child.textLen);
+                params->values_[cnt] = seg;
+                if(Match_(node.param,path.substr(seg.size()),method,params,allow,handler)){
+                    return true;
+                }
+                params->cnt_--;
+            }
+        }
+    }
+    if(node.wild >= 0 && params->cnt_ < RouteParams::MAX_PARAMS){
+        const Node& child = nodes_[node.wild];
+        *allow |= Mask_(child.handler);
+        if(child.handler[method] >= 0){
+            int cnt = params->cnt_++;
+            params->names_[cnt] = string_view(pool_.data() + child.textOff,child.textLen);
+            params->values_[cnt] = path;
+            *handler = child.handler[method];
+            return true;
+        }
+    }
+    return false;
+}
+
+const Router::Handler* Router::Find(string_view method,string_view path,
+                                    RouteParams* params,uint32_t* allow) const{
+    *allow = 0;
+    params->cnt_ = 0;
+    int m = MethodIndex(method);
+    if(!frozen_ || nodes_.empty()){
+        return nullptr;
+    }
+    int handler = -1;
+    if(m >= 0 && Match_(0,path,m,params,allow,&handler)){
+        return &handlers_[handler];
+    }
+    if(m == HEAD || m < 0){
+        // HEAD退回到GET；不认识的方法只借GET走一遍，收集这个路径的Allow
+        params->cnt_ = 0;
+        if(Match_(0,path,GET,params,allow,&handler) && m == HEAD){
+            return &handlers_[handler];
+        }
+    }
+    if(*allow & (1u << GET)){
+        *allow |= 1u << HEAD;
+    }
+    return nullptr;
+}
+
+bool Router::Dispatch(HttpRequest& req,HttpResponse& resp,bool inlineOnly) const{
+    string_view path = req.path();
+    path = path.substr(0,path.find('?'));
+    RouteParams params;
+    uint32_t allow = 0;
+    const Handler* handler = Find(req.method(),path,&params,&allow);
+    if(handler){
+        if(inlineOnly && !nonBlocking_[handler - handlers_.data()]){
+            return false;
+        }
+        (*handler)(req,params,resp);
+    }else if(allow){
+        resp.SetCode(405);
+        resp.SetAllow(AllowList(allow));
+    }else{
+        resp.SetCode(404);
+    }
+    return true;
+}
+
+bool Router::AcceptsUpload(string_view method,string_view path) const{
+    path = path.substr(0,path.find('?'));
+    RouteParams params;
+    uint32_t allow = 0;
+    const Handler* handler = Find(method,path,&params,&allow);
+    return handler && upload_[handler - handlers_.data()];
+}
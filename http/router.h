@@ -0,0 +1,118 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+
+class HttpRequest;
+class HttpResponse;
+
+// 路由匹配出的参数，名字指向路由表，值指向请求路径，只在处理函数调用期间有效
+class RouteParams {
+public:
+    static const int MAX_PARAMS = 8;
+
+    RouteParams() : cnt_(0) {}
+    std::string_view Get(std::string_view name) const;
+    int Size() const { return cnt_; }
+    std::string_view Name(int i) const { return names_[i]; }
+    std::string_view Value(int i) const { return values_[i]; }
+
+private:
+    friend class Router;
+    std::string_view names_[MAX_PARAMS];
+    std::string_view values_[MAX_PARAMS];
+    int cnt_;
+};
+
+// 路由表：方法+路径模式 -> 处理函数。模式由静态文本、":name"（匹配一个路径段）、
+// "*name"（匹配剩余全部，只能在最后）组成，例如 "/user/:id/posts"、"/*path"。
+// 启动时注册到基数树，Freeze后压平成一个连续数组：同一节点的静态子节点相邻存放，
+// 文本都在一块字符池里，查找只做顺序比较，不分配内存。
+// 优先级：静态文本 > 参数 > 通配；路径匹配但方法不匹配时返回405并带上Allow头，HEAD没有注册时使用GET
+class Router {
+public:
+    typedef std::function<void(HttpRequest& req, const RouteParams& params, HttpResponse& resp)> Handler;
+
+    enum METHOD {
+        GET, HEAD, POST, PUT, DELETE, PATCH, OPTIONS,
+        METHOD_NUM,
+    };
+
+    Router();
+    ~Router();
+
+    static Router* Instance();
+
+    // 只能在Freeze之前调用，模式非法或重复注册时返回false。
+    // nonBlocking表示处理函数不会阻塞（不访问数据库、不做慢操作），可以在事件循环线程上直接执行；
+    // upload表示接收multipart/form-data上传，文件边到达边写进uploadDir，处理函数用ClaimUpload认领。
+    // 没有标记upload的路径（包括404/405）上的multipart请求体按普通请求体处理，不落盘
+    bool Add(std::string_view method, std::string_view pattern, Handler handler,
+             bool nonBlocking = false, bool upload = false);
+    void Freeze();
+    bool Frozen() const { return frozen_; }
+    size_t RouteCount() const { return handlers_.size(); }
+
+    // 找到处理函数返回它；否则allow是这个路径上注册过的方法（按METHOD的位掩码），非0为405，0为404
+    const Handler* Find(std::string_view method, std::string_view path,
+                        RouteParams* params, uint32_t* allow) const;
+    // 按请求的方法和路径（不含查询串）调用处理函数，找不到时给响应设置404/405。
+    // inlineOnly时处理函数可能阻塞就不调用，返回false，由调用方交给工作线程重新分发
+    bool Dispatch(HttpRequest& req, HttpResponse& resp, bool inlineOnly = false) const;
+    // 请求头结束时调用：这个请求匹配的路由是否接收multipart上传
+    bool AcceptsUpload(std::string_view method, std::string_view path) const;
+
+    static int MethodIndex(std::string_view method);
+    static std::string AllowList(uint32_t allow);   // "GET, HEAD, POST"，用于Allow头
+
+private:
+    enum KIND : uint8_t {
+        STATIC,
+        PARAM,
+        WILD,
+    };
+
+    // 注册期间使用的树
+    struct BuildNode {
+        BuildNode(KIND k, std::string_view t);
+        KIND kind;
+        std::string text;       // 静态节点是要匹配的文本，参数/通配节点是参数名
+        std::vector<std::unique_ptr<BuildNode>> children;
+        std::unique_ptr<BuildNode> param;
+        std::unique_ptr<BuildNode> wild;
+        int handler[METHOD_NUM];
+    };
+
+    // 压平后的节点
+    struct Node {
+        uint32_t textOff;       // 在pool_中的偏移
+        uint16_t textLen;
+        char first;             // 静态节点文本的首字节
+        KIND kind;
+        uint32_t firstChild;    // 静态子节点从这里开始连续存放，按首字节排序
+        uint32_t childCnt;
+        int32_t param;          // 参数子节点下标，-1表示没有
+        int32_t wild;
+        int32_t handler[METHOD_NUM];    // handlers_下标，-1表示没有
+    };
+
+    bool Insert_(BuildNode* node, std::string_view pattern, int method, int handler);
+    bool Match_(uint32_t idx, std::string_view path, int method, RouteParams* params,
+                uint32_t* allow, int* handler) const;
+    static uint32_t Mask_(const int32_t* handler);
+
+    bool frozen_;
+    std::unique_ptr<BuildNode> root_;
+    std::vector<Node> nodes_;
+    std::string pool_;
+    std::vector<Handler> handlers_;
+    std::vector<bool> nonBlocking_;     // 与handlers_一一对应
+    std::vector<bool> upload_;
+};
+
+#endif //ROUTER_H
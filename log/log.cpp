@@ -11,11 +11,13 @@ Log::Log() {
 }
 
 Log::~Log() {
-    while(!deque_->empty()) {
-        deque_->flush();    // 唤醒消费者，处理掉剩下的任务
+    if(writeThread_ && writeThread_->joinable()) {
+        while(!deque_->empty()) {
+            deque_->flush();    // 唤醒消费者，处理掉剩下的任务
+        }
+        deque_->Close();    // 关闭队列
+        writeThread_->join();   // 等待当前线程完成手中的任务
     }
-    deque_->Close();    // 关闭队列
-    writeThread_->join();   // 等待当前线程完成手中的任务
     if(fp_) {       // 冲洗文件缓冲区，关闭文件描述符
         lock_guard<mutex> locker(mtx_);
         flush();        // 清空缓冲区中的数据
@@ -97,11 +99,10 @@ void Log::init(int level, const char* path, const char* suffix, int maxQueCapaci
 }
 
 void Log::write(int level, const char *format, ...) {
-    struct timeval now = {0, 0};
-    gettimeofday(&now, nullptr);
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    // 时间取自事件循环刷新的缓存时钟，不再每行调用gettimeofday/localtime
+    CachedClock::Snapshot now;
+    CachedClock::Instance()->Now(&now);
+    const struct tm& t = now.localTm;
     va_list vaList;
 
     // 日志日期 日志行数  如果不是今天或行数超了
@@ -135,16 +136,26 @@ void Log::write(int level, const char *format, ...) {
     {
         unique_lock<mutex> locker(mtx_);
         lineCount_++;
-        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
+        buff_.EnsureWriteable(LINE_SIZE);     // 缓冲区清空后不持有内存，写之前先申请
+        int n = snprintf(buff_.BeginWrite(), 128, "%s.%06ld ",
+                    now.logTime, static_cast<long>(now.wallUs % 1000000));
                     
         buff_.HasWritten(n);
         AppendLogLevelTitle_(level);    
 
         va_start(vaList, format);
+        va_list retry;
+        va_copy(retry, vaList);
         int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
         va_end(vaList);
+        if(m < 0) {
+            m = 0;
+        } else if(static_cast<size_t>(m) >= buff_.WritableBytes()) {
+            // 超过预留空间的长行：vsnprintf只写了截断的内容，扩容后重新格式化
+            buff_.EnsureWriteable(m + 1);
+            vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, retry);
+        }
+        va_end(retry);
 
         buff_.HasWritten(m);
         buff_.Append("\n\0", 2);
@@ -11,6 +11,7 @@
 #include <sys/stat.h>         // mkdir
 #include "blockqueue.h"
 #include "../buffer/buffer.h"
+#include "../time/cachedclock.h"
 
 class Log {
 public:
@@ -39,6 +40,7 @@ private:
     static const int LOG_PATH_LEN = 256;    // 日志文件最长文件名
     static const int LOG_NAME_LEN = 256;    // 日志最长名字
     static const int MAX_LINES = 50000;     // 日志文件内的最长日志条数
+    static const int LINE_SIZE = 1024;      // 每条日志预先申请的缓冲区大小
 
     const char* path_;          //路径名
     const char* suffix_;        //后缀名
@@ -67,14 +69,14 @@ private:
             log->write(level, format, ##__VA_ARGS__); \
             log->flush();\
         }\
-    } while(0);
+    } while(0)
 
 // 四个宏定义，主要用于不同类型的日志输出，也是外部使用日志的接口
 // ...表示可变参数，__VA_ARGS__就是将...的值复制到这里
 // 前面加上##的作用是：当可变参数的个数为0时，这里的##可以把把前面多余的","去掉,否则会编译出错。
-#define LOG_DEBUG(format, ...) do {LOG_BASE(0, format, ##__VA_ARGS__)} while(0);    
-#define LOG_INFO(format, ...) do {LOG_BASE(1, format, ##__VA_ARGS__)} while(0);
-#define LOG_WARN(format, ...) do {LOG_BASE(2, format, ##__VA_ARGS__)} while(0);
-#define LOG_ERROR(format, ...) do {LOG_BASE(3, format, ##__VA_ARGS__)} while(0);
+#define LOG_DEBUG(format, ...) do {LOG_BASE(0, format, ##__VA_ARGS__);} while(0)
+#define LOG_INFO(format, ...) do {LOG_BASE(1, format, ##__VA_ARGS__);} while(0)
+#define LOG_WARN(format, ...) do {LOG_BASE(2, format, ##__VA_ARGS__);} while(0)
+#define LOG_ERROR(format, ...) do {LOG_BASE(3, format, ##__VA_ARGS__);} while(0)
 
 #endif //LOG_H
@@ -2,10 +2,19 @@
 #include "server/webserver.h"
 
 int main(){
+    // 接入参数需在创建服务器之前设置
+    Acceptor::backlog = 1024;       // listen队列长度，受net.core.somaxconn限制
+    Acceptor::deferAccept = 0;      // >0时客户端发来请求后才唤醒accept（秒）
+    Acceptor::maxPending = 1024;    // 线程池积压超过时新连接直接回503，0为不限
     WebServer server(
         1316,3,60000,false, //端口 ET模式 timeoutMs 优雅退出
         3306,"root","123456","webserver",   //mysql配置
-        12,6,true,1,1024    //连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量
+        12,6,true,1,1024,   //连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量
+        0,0,false,          //子Reactor数量(0为单Reactor+线程池模式) I/O后端(0:epoll 1:io_uring) 工作窃取线程池
+        false,false         //零拷贝发送文件(sendfile) 静态缓存命中的请求在事件循环线程上直接处理
     ); 
+    // 按路径前缀配置Cache-Control（最长前缀优先），未匹配的路径不发送
+    FileCache::Instance()->AddCacheControl("/images/","public, max-age=86400");
+    FileCache::Instance()->AddCacheControl("/","no-cache");
     server.Start();
 }
\ No newline at end of file
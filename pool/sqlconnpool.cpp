@@ -1,13 +1,15 @@
 #include "sqlconnpool.h"
 
+using namespace std;
+
 SqlConnPool* SqlConnPool::Instance(){
     static SqlConnPool pool;
     return &pool;
 }
 
 void SqlConnPool::Init(const char* host,int port,
-                    const char* user,sont char* pwd,
-                    const char* dbName,int connSize =10){
+                    const char* user,const char* pwd,
+                    const char* dbName,int connSize){
     assert(connSize > 0);
     for(int i=0;i < connSize; i++){
         MYSQL* conn = nullptr;
@@ -19,11 +21,13 @@ void SqlConnPool::Init(const char* host,int port,
         conn = mysql_real_connect(conn , host , user ,pwd,dbName,port,nullptr,0);
         if(!conn){
             LOG_ERROR("MySql Connect error!");
-            connQue_.emplace(conn);
+            continue;
         }
-        MAX_CONN_ = connSize;
-        // 信号量（信号量指针，线程间同步，信号量初始值）
-        sem_init(&semId_,0,MAX_CONN_);
+        connQue_.emplace(conn);
+    }
+    MAX_CONN_ = connQue_.size();
+    // 信号量（信号量指针，线程间同步，信号量初始值）
+    sem_init(&semId_,0,MAX_CONN_);
 }
 
 MYSQL* SqlConnPool::GetConn(){
@@ -61,6 +65,3 @@ int SqlConnPool::GetFreeConnCount(){
     lock_guard<mutex> locker(mtx_);
     return connQue_.size();
 }
-
-
-};
\ No newline at end of file
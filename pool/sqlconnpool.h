@@ -7,6 +7,7 @@
 #include <mutex>
 #include <semaphore.h>
 #include <thread>
+#include <assert.h>
 #include "../log/log.h"
 
 class SqlConnPool
@@ -16,11 +17,11 @@ public:
 
     MYSQL *GetConn();
     void FreeConn(MYSQL *conn);
-    int GetFreeConnCountr();
+    int GetFreeConnCount();
 
     void Init(const char *host, int port,
               const char *user, const char *pwd,
-              const char *dbName, int connSize);
+              const char *dbName, int connSize = 10);
     void ClosePool();
 
 private:
@@ -34,10 +35,10 @@ private:
     sem_t semId_;
 };
 
-Class SqlConnRAII
+class SqlConnRAII
 {
 public:
-    SqlConnRAII(MYSQL * *sql, sqlConnPool * connpool)
+    SqlConnRAII(MYSQL * *sql, SqlConnPool * connpool)
     {
         assert(connpool);
         *sql = connpool->GetConn();
@@ -49,7 +50,7 @@ public:
     {
         if (sql_)
         {
-            connpoll_->FreeConn(sql_);
+            connpool_->FreeConn(sql_);
         }
     }
 
@@ -0,0 +1,92 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stddef.h>
+#include <assert.h>
+
+// 线程池任务类型：固定容量的小对象优化、只可移动的 void() 可调用对象。
+// 可调用对象总是原地构造在内部存储里，从不申请堆内存；放不下时编译期报错，而不是悄悄退化成堆分配。
+// 容量正好容纳 std::bind(&Class::Func, this, arg)：一个成员函数指针 + 两个指针
+class Task {
+public:
+    static const size_t CAPACITY = sizeof(void (Task::*)()) + 2 * sizeof(void*);
+    static const size_t ALIGN = alignof(void*) > alignof(void (Task::*)()) ?
+                                alignof(void*) : alignof(void (Task::*)());
+
+    Task() noexcept : ops_(nullptr) {}
+
+    template<typename F,
+             typename Fn = typename std::decay<F>::type,
+             typename = typename std::enable_if<!std::is_same<Fn, Task>::value>::type>
+    Task(F&& func) : ops_(&OpsFor<Fn>::ops) {
+        static_assert(sizeof(Fn) <= CAPACITY, "Task: callable too large for inline storage");
+        static_assert(alignof(Fn) <= ALIGN, "Task: callable over-aligned for inline storage");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value,
+                      "Task: callable must be nothrow move constructible");
+        new (storage_) Fn(std::forward<F>(func));
+    }
+
+    Task(Task&& other) noexcept : ops_(other.ops_) {
+        if(ops_) {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if(this != &other) {
+            Reset();
+            ops_ = other.ops_;
+            if(ops_) {
+                ops_->move(storage_, other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { Reset(); }
+
+    void operator()() {
+        assert(ops_);
+        ops_->invoke(storage_);
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    void Reset() noexcept {
+        if(ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);     // 移动构造到dst并析构src
+        void (*destroy)(void*);
+    };
+
+    template<typename Fn>
+    struct OpsFor {
+        static void Invoke(void* p) { (*static_cast<Fn*>(p))(); }
+        static void Move(void* dst, void* src) {
+            new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        }
+        static void Destroy(void* p) { static_cast<Fn*>(p)->~Fn(); }
+        static constexpr Ops ops = { &Invoke, &Move, &Destroy };
+    };
+
+    alignas(ALIGN) unsigned char storage_[CAPACITY];
+    const Ops* ops_;
+};
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
-#include <queue>
+#include <vector>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <thread>
 #include <assert.h>
+#include "task.h"
 
 class ThreadPool {
 public:
@@ -16,19 +18,19 @@ public:
     explicit ThreadPool(int threadCount = 8) : pool_(std::make_shared<Pool>()){
         assert( threadCount >0 );
         for (int i = 0; i < threadCount; i++){
-            std::thread([this](){
-                std::unique_lock<std::mutex> locker(pool_->mtx_);
+            // 线程分离运行，持有Pool的shared_ptr，ThreadPool析构后仍能安全退出
+            std::thread([pool = pool_](){
+                std::unique_lock<std::mutex> locker(pool->mtx_);
                 while(true){
-                    if(!pool_->tasks.empty()){
-                        auto task =std ::move(pool_->tasks.front()); //左值变右值,资产转移
-                        pool_->tasks.pop();
+                    if(!pool->Empty()){
+                        Task task = pool->Pop();    //左值变右值,资产转移
                         locker.unlock();    // 因为已经把任务取出来了，所以可以提前解锁了
                         task();
                         locker.lock();
-                    }else if(pool_-> isClosed){
+                    }else if(pool->isClosed){
                         break;
                     }else {
-                        pool_->cond_.wait(locker);  // 等待,如果任务来了就notify的
+                        pool->cond_.wait(locker);  // 等待,如果任务来了就notify的
                     }
                 }
             }).detach();
@@ -37,28 +39,60 @@ public:
 
     ~ThreadPool(){
         if(pool_) {
-            std::unique_lock<std::mutex> locker(pool_->mtx_);
-            pool_->isClosed =true;
+            {
+                std::unique_lock<std::mutex> locker(pool_->mtx_);
+                pool_->isClosed =true;
+            }
+            pool_->cond_.notify_all();
         }
-        pool_->cond_.notify_all();
     }
 
     template<typename T>
     void AddTask(T&& task){
         std::unique_lock<std::mutex> locker(pool_->mtx_);
-        pool_->tasks.emplace(std::forward<T>(task));
+        pool_->Push(Task(std::forward<T>(task)));
         pool_->cond_.notify_one();
     }
 
+    // 还没被取走的任务数，供准入控制判断积压
+    size_t Pending(){
+        std::lock_guard<std::mutex> locker(pool_->mtx_);
+        return pool_->count;
+    }
+
 private:
     struct Pool{
         std::mutex mtx_;
         std::condition_variable cond_;
-        bool isClosed;
-        //过 std::forward 转发的 task 可以是左值或右值，emplace 会根据其值类别进行相应的构造：
-        //如果 task 是左值，emplace 会调用拷贝构造函数。
-        //如果 task 是右值，emplace 会调用移动构造函数。
-        std::queue<std::function<void()>> tasks;
+        bool isClosed = false;
+        //任务队列是Task组成的环形数组：Task内联存放可调用对象，数组只在积压超过容量时倍增，
+        //稳定运行时入队出队都不申请堆内存（std::queue/std::deque会不断分配释放节点）
+        std::vector<Task> tasks = std::vector<Task>(1024);
+        size_t head = 0;
+        size_t count = 0;
+
+        bool Empty() const { return count == 0; }
+
+        void Push(Task&& task){
+            if(count == tasks.size()){
+                std::vector<Task> bigger(tasks.size() * 2);
+                for(size_t i = 0; i < count; i++){
+                    bigger[i] = std::move(tasks[(head + i) % tasks.size()]);
+                }
+                tasks.swap(bigger);
+                head = 0;
+            }
+            tasks[(head + count) % tasks.size()] = std::move(task);
+            count++;
+        }
+
+        Task Pop(){
+            assert(count > 0);
+            Task task = std::move(tasks[head]);
+            head = (head + 1) % tasks.size();
+            count--;
+            return task;
+        }
     };
     std::shared_ptr<Pool> pool_;
 };
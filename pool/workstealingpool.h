@@ -0,0 +1,318 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <random>
+#include <assert.h>
+#include <stdint.h>
+#include "task.h"
+
+// Chase-Lev 工作窃取双端队列：只有所属线程在bottom端Push/Pop，其他线程在top端Steal。
+// 元素必须是指针一类可以原子读写的小对象；扩容后旧数组留到析构时再释放，避免窃取者读到已释放内存
+template<typename T>
+class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(int64_t capacity = 256) : top_(0), bottom_(0) {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+        array_.store(new Array(capacity), std::memory_order_relaxed);
+    }
+
+    ~ChaseLevDeque() {
+        delete array_.load(std::memory_order_relaxed);
+        for(auto a : garbage_) delete a;
+    }
+
+    // 仅所属线程调用
+    void Push(T x) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if(b - t > a->cap - 1) {
+            a = Grow_(a, b, t);
+        }
+        a->Put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 仅所属线程调用，LIFO取最近放入的任务，缓存更热
+    bool Pop(T& x) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if(t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        x = a->Get(b);
+        if(t == b) {
+            // 只剩最后一个元素，和窃取者竞争
+            bool won = top_.compare_exchange_strong(t, t + 1,
+                            std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // 任意线程调用，FIFO从top端窃取
+    bool Steal(T& x) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if(t >= b) return false;
+        Array* a = array_.load(std::memory_order_acquire);
+        x = a->Get(t);
+        return top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    bool Empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        int64_t cap;
+        std::unique_ptr<std::atomic<T>[]> buf;
+        explicit Array(int64_t c) : cap(c), buf(new std::atomic<T>[c]) {}
+        T Get(int64_t i) const { return buf[i & (cap - 1)].load(std::memory_order_relaxed); }
+        void Put(int64_t i, T x) { buf[i & (cap - 1)].store(x, std::memory_order_relaxed); }
+    };
+
+    Array* Grow_(Array* a, int64_t b, int64_t t) {
+        Array* na = new Array(a->cap * 2);
+        for(int64_t i = t; i < b; i++) na->Put(i, a->Get(i));
+        garbage_.push_back(a);
+        array_.store(na, std::memory_order_release);
+        return na;
+    }
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Array*> array_;
+    std::vector<Array*> garbage_;   // 只有所属线程会扩容
+};
+
+// 有界无锁多生产者多消费者队列（Vyukov），作为外部线程（如epoll主线程）提交任务的注入队列。
+// 元素按值存放在预分配的槽里，Task可以直接放入，不需要额外的堆分配
+template<typename T>
+class InjectQueue {
+public:
+    explicit InjectQueue(size_t capacity = 4096) : mask_(capacity - 1), cells_(new Cell[capacity]) {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for(size_t i = 0; i < capacity; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    // 满时返回false且不移动x，调用者可以重试
+    bool Push(T&& x) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0) {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if(diff < 0) {
+                return false;   // 满
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(x);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& x) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0) {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if(diff < 0) {
+                return false;   // 空
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        x = std::move(cell->data);
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const {
+        return enqueuePos_.load(std::memory_order_seq_cst) == dequeuePos_.load(std::memory_order_seq_cst);
+    }
+
+    // 近似值，只用于统计和准入判断
+    size_t Size() const {
+        size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+// 工作窃取线程池：接口与ThreadPool相同。
+// 工作线程内部提交的任务进自己的Chase-Lev队列，外部线程提交的任务进无锁注入队列；
+// 空闲线程依次尝试 本地队列 -> 注入队列 -> 随机窃取其他线程，仍然没有任务时先自旋一段时间再挂起。
+// 外部提交（I/O事件分发）的Task按值进注入队列，不分配内存；只有工作线程内部的嵌套提交需要new一个节点
+// （服务器的I/O事件都从loop线程提交，不走这条路径；test/test_task.cpp核对了这两种情况的分配次数）
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threadCount = 8) : isClosed_(false), sleeping_(0) {
+        assert(threadCount > 0);
+        for(int i = 0; i < threadCount; i++) {
+            workers_.emplace_back(new Worker());
+        }
+        for(int i = 0; i < threadCount; i++) {
+            threads_.emplace_back(&WorkStealingPool::Run_, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            isClosed_ = true;
+        }
+        cond_.notify_all();
+        for(auto& t : threads_) t.join();
+        Task* task;
+        for(auto& w : workers_) {
+            while(w->deque.Pop(task)) delete task;
+        }
+    }
+
+    template<typename T>
+    void AddTask(T&& task) {
+        if(current_.pool == this) {
+            workers_[current_.index]->deque.Push(new Task(std::forward<T>(task)));
+        } else {
+            Task t(std::forward<T>(task));
+            while(!inject_.Push(std::move(t))) {
+                std::this_thread::yield();  // 注入队列满，等工作线程消化
+            }
+        }
+        // 与Park_中的 sleeping_++ / 重新检查 构成Dekker式配对，不会丢失唤醒
+        if(sleeping_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> locker(mtx_);
+            cond_.notify_one();
+        }
+    }
+
+    // 外部提交（I/O事件）还没被取走的任务数，供准入控制判断积压
+    size_t Pending() const {
+        return inject_.Size();
+    }
+
+private:
+    static const int SPIN_COUNT = 64;
+
+    struct Worker {
+        ChaseLevDeque<Task*> deque;
+    };
+
+    struct Current {        // 线程局部，零初始化即“非工作线程”
+        WorkStealingPool* pool;
+        int index;
+    };
+    static inline thread_local Current current_;
+
+    bool FindTask_(int index, std::minstd_rand& rng, Task& task) {
+        Task* node = nullptr;
+        if(workers_[index]->deque.Pop(node)) {
+            task = std::move(*node);
+            delete node;
+            return true;
+        }
+        if(inject_.Pop(task)) return true;
+        int n = static_cast<int>(workers_.size());
+        int start = static_cast<int>(rng() % n);
+        for(int i = 0; i < n; i++) {
+            int victim = (start + i) % n;
+            if(victim != index && workers_[victim]->deque.Steal(node)) {
+                task = std::move(*node);
+                delete node;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool HasWork_() const {
+        if(!inject_.Empty()) return true;
+        for(auto& w : workers_) {
+            if(!w->deque.Empty()) return true;
+        }
+        return false;
+    }
+
+    void Park_() {
+        std::unique_lock<std::mutex> locker(mtx_);
+        sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        while(!isClosed_ && !HasWork_()) {
+            cond_.wait(locker);
+        }
+        sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void Run_(int index) {
+        current_.pool = this;
+        current_.index = index;
+        std::minstd_rand rng(index + 1);
+        int idle = 0;
+        Task task;
+        while(true) {
+            if(FindTask_(index, rng, task)) {
+                idle = 0;
+                task();
+                task.Reset();
+                continue;
+            }
+            if(isClosed_) break;
+            if(++idle < SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+            idle = 0;
+            Park_();
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    InjectQueue<Task> inject_;
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::atomic<bool> isClosed_;
+    std::atomic<int> sleeping_;
+};
+
+#endif
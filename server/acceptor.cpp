@@ -0,0 +1,141 @@
+#include "acceptor.h"
+
+int Acceptor::backlog = 1024;
+int Acceptor::deferAccept = 0;
+int Acceptor::batch = 64;
+size_t Acceptor::maxPending = 1024;
+
+// 超载时的响应在编译期拼好，拒绝一个连接只需要一次send
+static const char BUSY_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 1\r\n"
+    "Content-type: text/plain\r\n"
+    "Content-length: 12\r\n"
+    "\r\n"
+    "Server busy!";
+
+Acceptor::Acceptor() : listenFd_(-1), drain_(false), accepted_(0), shed_(0) {
+    idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+Acceptor::~Acceptor() {
+    if(listenFd_ >= 0) close(listenFd_);
+    if(idleFd_ >= 0) close(idleFd_);
+}
+
+bool Acceptor::Listen(int port, bool optLinger, bool reusePort) {
+    int ret;
+    struct sockaddr_in addr;
+    if(port > 65535 || port < 1024) {
+        LOG_ERROR("Port:%d error!", port);
+        return false;
+    }
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    // 优雅关闭：直到所剩数据发送完毕或者超时
+    struct linger linger = {};
+    if(optLinger) {
+        linger.l_onoff = 1;
+        linger.l_linger = 1;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(listenFd_ < 0) {
+        LOG_ERROR("Create socket error!");
+        return false;
+    }
+
+    int optval = 1;
+    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    if(ret == 0) {
+        ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(int));
+    }
+    if(ret == 0 && reusePort) {
+        ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(int));
+    }
+    if(ret < 0) {
+        LOG_ERROR("set socket setsockopt error !");
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    // 不支持时只是少了这项优化，不影响监听
+    if(deferAccept > 0 &&
+       setsockopt(listenFd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAccept, sizeof(int)) < 0) {
+        LOG_WARN("TCP_DEFER_ACCEPT not supported");
+    }
+
+    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
+    if(ret < 0) {
+        LOG_ERROR("Bind Port:%d error!", port);
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    ret = listen(listenFd_, backlog);
+    if(ret < 0) {
+        LOG_ERROR("Listen port:%d error!", port);
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+int Acceptor::Accept(const ConnHandler& onConn, const ShedPolicy& shed) {
+    int cnt = 0;
+    for(int i = 0; drain_ || i < batch; i++) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept4(listenFd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            if((errno == EMFILE || errno == ENFILE) && idleFd_ >= 0) {
+                close(idleFd_);
+                fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if(fd >= 0) {
+                    SendBusy(fd);
+                    shed_++;
+                }
+                idleFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                LOG_WARN("Fd exhausted!");
+                continue;
+            }
+            break;      // EAGAIN：队列已取空
+        }
+        if(shed && shed(fd)) {
+            SendBusy(fd);
+            shed_++;
+            continue;
+        }
+        onConn(fd, addr);
+        accepted_++;
+        cnt++;
+    }
+    return cnt;
+}
+
+int Acceptor::MaxConn(int capacity) {
+    long limit = capacity;
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+       static_cast<long>(rl.rlim_cur) - RESERVED_FD < limit) {
+        limit = static_cast<long>(rl.rlim_cur) - RESERVED_FD;
+    }
+    return limit > 0 ? static_cast<int>(limit) : 1;
+}
+
+// 先读掉已经到达的请求再关：接收队列里有未读数据时close会发RST，客户端可能收不到503
+void Acceptor::SendBusy(int fd) {
+    ssize_t ret = send(fd, BUSY_RESPONSE, sizeof(BUSY_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(ret < 0) {
+        LOG_WARN("send error to client[%d] error!", fd);
+    }
+    char buf[4096];
+    for(int i = 0; i < 4 && recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0; i++) {}
+    close(fd);
+}
@@ -0,0 +1,64 @@
+#ifndef ACCEPTOR_H
+#define ACCEPTOR_H
+
+#include <functional>
+#include <fcntl.h>       // open()
+#include <unistd.h>      // close()
+#include <errno.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "../log/log.h"
+
+// 监听套接字和新连接的准入控制：
+//   accept4直接得到非阻塞、CLOEXEC的fd，不再逐个fcntl；
+//   每次可读事件最多accept batch个连接，监听套接字用水平触发，剩下的留到下一轮epoll_wait，
+//   连接风暴时loop线程不会一直卡在accept上，已有连接的读写照常推进；
+//   io_uring后端的常驻poll是multishot，只在有新连接到达时才再报一次（相当于边沿触发），
+//   这时要SetDrain(true)一直accept到EAGAIN，否则队列里剩下的连接要等下一个新连接才被取走；
+//   超载（连接数接近fd上限、线程池积压过多）时新连接直接回预先拼好的503并关闭，
+//   已接纳连接的排队时间不会随过载继续增长；
+//   fd耗尽(EMFILE)时先关掉预留的fd，接下这个连接回503，避免它一直留在队列里让loop空转
+class Acceptor {
+public:
+    static const int RESERVED_FD = 64;  // 留给文件缓存、日志、数据库连接等的fd
+
+    // 启动参数，需在创建服务器之前设置
+    static int backlog;         // listen的backlog，实际值还受net.core.somaxconn限制
+    static int deferAccept;     // >0时设置TCP_DEFER_ACCEPT（秒）：客户端发来请求后才完成accept
+    static int batch;           // 每次可读事件最多accept的连接数
+    static size_t maxPending;   // 线程池积压的任务数超过时拒绝新连接，0表示不限
+
+    typedef std::function<void(int fd, const sockaddr_in& addr)> ConnHandler;
+    typedef std::function<bool(int fd)> ShedPolicy;    // 返回true表示拒绝这个连接
+
+    Acceptor();
+    ~Acceptor();
+
+    // reusePort：多个子Reactor各自bind同一端口，由内核分发新连接
+    bool Listen(int port, bool optLinger, bool reusePort);
+    int Fd() const { return listenFd_; }
+    // 监听套接字可读时调用，返回本次接纳的连接数
+    int Accept(const ConnHandler& onConn, const ShedPolicy& shed);
+    void SetDrain(bool drain) { drain_ = drain; }   // true：不受batch限制，取到队列为空
+
+    uint64_t AcceptedCount() const { return accepted_; }
+    uint64_t ShedCount() const { return shed_; }
+
+    // 进程fd上限减去保留部分，且不超过连接表容量
+    static int MaxConn(int capacity);
+    // 回503并关闭连接
+    static void SendBusy(int fd);
+
+private:
+    int listenFd_;
+    int idleFd_;            // 预留的fd，EMFILE时让出来
+    bool drain_;
+    uint64_t accepted_;
+    uint64_t shed_;
+};
+
+#endif //ACCEPTOR_H
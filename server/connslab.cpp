@@ -0,0 +1,40 @@
+#include "connslab.h"
+
+ConnSlab::ConnSlab(int maxFd) : maxFd_(maxFd), slots_(new Slot[maxFd]) {
+    assert(maxFd > 0);
+}
+
+// 只在loop线程调用
+HttpConn* ConnSlab::Acquire(int fd) {
+    assert(fd >= 0 && fd < maxFd_);
+    Slot& slot = slots_[fd];
+    assert(!slot.inUse);
+    if(!slot.conn) {
+        slot.conn.reset(new HttpConn());
+    }
+    slot.inUse = true;
+    return slot.conn.get();
+}
+
+// 可能在工作线程调用（读写出错时关闭连接）
+void ConnSlab::Release(int fd) {
+    assert(fd >= 0 && fd < maxFd_);
+    Slot& slot = slots_[fd];
+    slot.gen.fetch_add(1, std::memory_order_release);
+    slot.inUse = false;
+}
+
+HttpConn* ConnSlab::Get(uint64_t key) const {
+    int fd = FdOf(key);
+    if(fd < 0 || fd >= maxFd_) return nullptr;
+    const Slot& slot = slots_[fd];
+    uint32_t gen = static_cast<uint32_t>(key >> 32);
+    if(!slot.inUse || slot.gen.load(std::memory_order_acquire) != gen) return nullptr;
+    return slot.conn.get();
+}
+
+uint64_t ConnSlab::Key(int fd) const {
+    assert(fd >= 0 && fd < maxFd_);
+    uint64_t gen = slots_[fd].gen.load(std::memory_order_acquire);
+    return (gen << 32) | static_cast<uint32_t>(fd);
+}
@@ -0,0 +1,46 @@
+#ifndef CONNSLAB_H
+#define CONNSLAB_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <assert.h>
+
+#include "../http/httpconn.h"
+
+// 以fd为下标的连接槽表，替代unordered_map<int,HttpConn>：
+// 槽位数组一次性预分配，查找O(1)且无哈希；HttpConn首次使用时创建，之后随fd复用，不再析构重建。
+// 每个槽带代数(generation)，连接关闭时加一，epoll的data.u64和定时器回调携带 fd|代数<<32，
+// 这样fd被回收复用后，旧连接遗留的事件和超时回调不会误操作新连接
+class ConnSlab {
+public:
+    explicit ConnSlab(int maxFd);
+    ~ConnSlab() = default;
+
+    HttpConn* Acquire(int fd);          // 新连接占用槽位
+    void Release(int fd);               // 代数加一使旧key失效，须在close(fd)之前调用
+    HttpConn* Get(uint64_t key) const;  // key过期返回nullptr
+    uint64_t Key(int fd) const;
+    int Capacity() const { return maxFd_; }
+
+    template<typename F>
+    void ForEach(F&& func) {            // 遍历所有在用连接
+        for(int fd = 0; fd < maxFd_; fd++) {
+            if(slots_[fd].inUse) func(slots_[fd].conn.get());
+        }
+    }
+
+    static int FdOf(uint64_t key) { return static_cast<int>(key & 0xffffffff); }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> gen{0};
+        std::atomic<bool> inUse{false};
+        std::unique_ptr<HttpConn> conn;
+    };
+
+    int maxFd_;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+#endif
@@ -1,44 +1,177 @@
 #include "epoller.h"
 
-Epoller::Epoller(int maxEvent):epollFd_(epoll_create(512)),events_(maxEvent){
-    assert(epollFd_ >=0 && events_.size() >0);
+Epoller::Epoller(int maxEvent,BACKEND backend):epollFd_(-1),backend_(backend),events_(maxEvent),
+    waiting_(false),batch_(0),waits_(0),ctls_(0),elided_(0),batched_(0){
+    assert(events_.size() > 0);
+    if(backend_ == IO_URING){
+        uring_.reset(new IoUringPoller());
+        if(!uring_->Init(maxEvent)){
+            uring_.reset();
+            backend_ = EPOLL;   // 内核不支持io_uring，回退到epoll
+        }
+    }
+    if(backend_ == EPOLL){
+        epollFd_ = epoll_create(512);
+        assert(epollFd_ >= 0);
+    }
 }
 
 Epoller::~Epoller(){
-    close(epollFd_);
+    if(epollFd_ >= 0) close(epollFd_);
 }
 
 bool Epoller::AddFd(int fd,uint32_t events){
-    if(fd < 0) return false;
-    epoll_event ev ={0};
-    ev.data.fd = fd;
-    ev.events =events;
-    return 0 == epoll_ctl(epollFd_,EPOLL_CTL_ADD,fd,&ev);
+    return AddFd(fd,events,static_cast<uint32_t>(fd));
 }
 
 bool Epoller::ModFd(int fd,uint32_t events){
-    if(fd < 0) return false;
-    epoll_event ev ={0};
-    ev.data.fd = fd;
+    return ModFd(fd,events,static_cast<uint32_t>(fd));
+}
+
+bool Epoller::Ctl_(int op,int fd,uint32_t events,uint64_t data){
+    epoll_event ev{};
+    ev.data.u64 = data;
     ev.events =events;
-    return 0 == epoll_ctl(epollFd_,EPOLL_CTL_MOD,fd,&ev);
+    ctls_.fetch_add(1,std::memory_order_relaxed);
+    return 0 == epoll_ctl(epollFd_,op,fd,&ev);
+}
+
+Epoller::Interest& Epoller::InterestOf_(int fd){
+    if(static_cast<size_t>(fd) >= interest_.size()) interest_.resize(fd + 1);
+    return interest_[fd];
+}
+
+bool Epoller::AddFd(int fd,uint32_t events,uint64_t data){
+    if(fd < 0) return false;
+    assert(static_cast<int>(data & 0xffffffff) == fd);
+    if(uring_) return uring_->AddFd(fd,events,data);
+    if(!Ctl_(EPOLL_CTL_ADD,fd,events,data)) return false;
+    Interest& in = InterestOf_(fd);
+    in.events = events;
+    in.data = data;
+    in.armed = true;
+    return true;
+}
+
+bool Epoller::ModFd(int fd,uint32_t events,uint64_t data){
+    if(fd < 0) return false;
+    assert(static_cast<int>(data & 0xffffffff) == fd);
+    if(uring_) return uring_->ModFd(fd,events,data);
+    Interest& in = InterestOf_(fd);
+    if(in.armed && in.events == events && in.data == data){
+        elided_.fetch_add(1,std::memory_order_relaxed);
+        return true;
+    }
+    if(!Ctl_(EPOLL_CTL_MOD,fd,events,data)) return false;
+    in.events = events;
+    in.data = data;
+    in.armed = true;
+    return true;
+}
+
+void Epoller::QueueModFd(int fd,uint32_t events,uint64_t data){
+    if(fd < 0) return;
+    if(uring_){
+        uring_->ModFd(fd,events,data);  // 其他线程的修改由IoUringPoller排队，随下一次Wait一起提交
+        return;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(!waiting_){
+        queued_.push_back({fd,events,data});
+        return;
+    }
+    // loop线程阻塞期间不碰interest_，持锁执行并更新记录；它醒来后要先拿这把锁清掉waiting_才会再访问
+    if(static_cast<size_t>(fd) >= interest_.size() || interest_[fd].data != data){
+        return;     // 连接已关闭，fd已被新连接复用
+    }
+    Interest& in = interest_[fd];
+    if(in.armed && in.events == events){
+        elided_.fetch_add(1,std::memory_order_relaxed);
+        return;
+    }
+    if(Ctl_(EPOLL_CTL_MOD,fd,events,data)){
+        in.events = events;
+        in.armed = true;
+    }
 }
 
+// 连接关闭后fd会被复用，记录的兴趣集留给下一次AddFd覆盖；不修改interest_，其他线程也能调用
 bool Epoller::DelFd(int fd){
     if(fd < 0) return false;
+    if(uring_) return uring_->DelFd(fd);
+    ctls_.fetch_add(1,std::memory_order_relaxed);
     return 0 == epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, 0);
 }
 
+// 从后往前执行，同一fd只执行最后一次修改；data和当前注册的对不上，
+// 说明是已关闭连接留下的修改（fd已被新连接复用），直接丢弃
+// 执行期间waiting_仍为false，新来的修改继续排队，interest_只有loop线程在访问；
+// 队列取空后才在锁内置waiting_，之后到达的修改由调用线程直接执行
+void Epoller::ApplyQueued_(){
+    while(true){
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            if(queued_.empty()){
+                waiting_ = true;
+                return;
+            }
+            applying_.swap(queued_);
+        }
+        batch_++;
+        for(auto it = applying_.rbegin(); it != applying_.rend(); ++it){
+            Interest& in = InterestOf_(it->fd);
+            if(in.data != it->data) continue;
+            if(in.batch == batch_){
+                elided_.fetch_add(1,std::memory_order_relaxed);
+                continue;
+            }
+            in.batch = batch_;
+            batched_.fetch_add(1,std::memory_order_relaxed);
+            ModFd(it->fd,it->events,it->data);
+        }
+        applying_.clear();
+    }
+}
+
 int Epoller::Wait(int timeoutMs){
-    return epoll_wait(epollFd_,&events_[0],static<int>(events_.size()),timeoutMs);
+    if(uring_) return uring_->Wait(timeoutMs,&events_[0],static_cast<int>(events_.size()));
+    ApplyQueued_();
+    int cnt = epoll_wait(epollFd_,&events_[0],static_cast<int>(events_.size()),timeoutMs);
+    waits_.fetch_add(1,std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        waiting_ = false;
+    }
+    for(int i = 0; i < cnt; i++){
+        // ONESHOT触发后内核已经停止监听，下一次相同的MOD不能省
+        size_t fd = events_[i].data.u64 & 0xffffffff;
+        if(fd < interest_.size() && (interest_[fd].events & EPOLLONESHOT)){
+            interest_[fd].armed = false;
+        }
+    }
+    return cnt;
 }
 
 int Epoller::GetEventFd(size_t i) const{
-    assert(i < events_.size() && i >=0);
-    return events_[i].data.fd;
+    assert(i < events_.size());
+    return static_cast<int>(events_[i].data.u64 & 0xffffffff);
+}
+
+uint64_t Epoller::GetEventData(size_t i) const{
+    assert(i < events_.size());
+    return events_[i].data.u64;
 }
 
 uint32_t Epoller::GetEvents(size_t i) const{
-    assert(i < events_.size() && i>=0);
+    assert(i < events_.size());
     return events_[i].events;
-}
\ No newline at end of file
+}
+
+Epoller::Stats Epoller::GetStats() const{
+    Stats stats;
+    stats.waits = waits_.load(std::memory_order_relaxed);
+    stats.ctls = ctls_.load(std::memory_order_relaxed);
+    stats.elided = elided_.load(std::memory_order_relaxed);
+    stats.batched = batched_.load(std::memory_order_relaxed);
+    return stats;
+}
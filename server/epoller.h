@@ -5,23 +5,83 @@
 #include <unistd.h>
 #include <assert.h>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <errno.h>
 
+#include "iouring.h"
+
 class  Epoller{
 public:
-    explicit Epoller(int maxEvent = 1024);
+    // 启动时选择的I/O后端，io_uring不可用时自动回退到epoll
+    enum BACKEND{
+        EPOLL,
+        IO_URING,
+    };
+
+    // 系统调用计数，用来衡量省掉了多少epoll_ctl
+    struct Stats {
+        uint64_t waits;     // epoll_wait
+        uint64_t ctls;      // 实际执行的epoll_ctl
+        uint64_t elided;    // 兴趣集没变而省掉的MOD（含队列里被同一fd后续修改覆盖的）
+        uint64_t batched;   // 由loop线程从队列里批量执行的修改
+    };
+
+    explicit Epoller(int maxEvent = 1024, BACKEND backend = EPOLL);
     ~Epoller();
 
+    // Add/Mod只能在loop线程（调用Wait的线程）调用：每个fd当前注册的事件记在interest_里，
+    // 和上次相同且仍处于激活状态（非ONESHOT，或ONESHOT还没触发）时不再执行epoll_ctl
     bool AddFd(int fd,uint32_t events);
     bool ModFd(int fd,uint32_t events);
-    bool DelFd(int fd);
+    // data低32位必须是fd，高32位由调用者自定义（如连接槽的代数）
+    bool AddFd(int fd,uint32_t events,uint64_t data);
+    bool ModFd(int fd,uint32_t events,uint64_t data);
+    // 其他线程修改兴趣集：loop线程醒着时放进队列，在下一次Wait前统一执行，同一fd只执行最后一次；
+    // loop线程正阻塞在epoll_wait里时持mtx_直接epoll_ctl并更新interest_（唤醒它反而多一次系统调用和线程切换）
+    void QueueModFd(int fd,uint32_t events,uint64_t data);
+    bool DelFd(int fd);     // 任何线程都可以调用
     int Wait(int timeoutMs =-1);
     int GetEventFd(size_t i) const;
-    uint32_t GetEvents*(size_t i) cosnt;
+    uint64_t GetEventData(size_t i) const;
+    uint32_t GetEvents(size_t i) const;
+    BACKEND Backend() const { return backend_; }
+    Stats GetStats() const;
 
 private:
+    struct Interest {
+        uint32_t events = 0;
+        uint64_t data = 0;
+        bool armed = false;     // ONESHOT触发后为false，需要MOD重新激活
+        uint64_t batch = 0;     // 最近一次在哪一批队列修改里执行过，用于同一fd去重
+    };
+    struct Change {
+        int fd;
+        uint32_t events;
+        uint64_t data;
+    };
+
+    bool Ctl_(int op,int fd,uint32_t events,uint64_t data);
+    Interest& InterestOf_(int fd);
+    void ApplyQueued_();
+
     int epollFd_;
+    BACKEND backend_;
+    std::unique_ptr<IoUringPoller> uring_;
     std::vector<struct epoll_event> events_;
-}
+    std::vector<Interest> interest_;    // 按fd下标；waiting_为false时只由loop线程访问，为true时持mtx_访问
+
+    std::mutex mtx_;            // 保护queued_、waiting_，以及waiting_期间的interest_
+    std::vector<Change> queued_;
+    bool waiting_;              // loop线程已取走队列，即将或正在阻塞在epoll_wait里
+    std::vector<Change> applying_;
+    uint64_t batch_;
+
+    std::atomic<uint64_t> waits_;
+    std::atomic<uint64_t> ctls_;
+    std::atomic<uint64_t> elided_;
+    std::atomic<uint64_t> batched_;
+};
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,292 @@
+#include "iouring.h"
+
+using namespace std;
+
+IoUringPoller::IoUringPoller():
+    ringFd_(-1), sqEntries_(0), sqPtr_(MAP_FAILED), cqPtr_(MAP_FAILED),
+    sqSize_(0), cqSize_(0), sqes_(nullptr), localTail_(0), toSubmit_(0),
+    ts_({0, 0}), hasLoop_(false), wakeFd_(-1), waiting_(false), woken_(false) {
+}
+
+IoUringPoller::~IoUringPoller() {
+    if(sqes_) munmap(sqes_, sqEntries_ * sizeof(struct io_uring_sqe));
+    if(cqPtr_ != MAP_FAILED && cqPtr_ != sqPtr_) munmap(cqPtr_, cqSize_);
+    if(sqPtr_ != MAP_FAILED) munmap(sqPtr_, sqSize_);
+    if(ringFd_ >= 0) close(ringFd_);
+    if(wakeFd_ >= 0) close(wakeFd_);
+}
+
+// 建立SQ/CQ环并映射到用户态，内核不支持时返回false由Epoller回退到epoll
+bool IoUringPoller::Init(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ringFd_ = syscall(__NR_io_uring_setup, entries, &p);
+    if(ringFd_ < 0) return false;
+
+    sqEntries_ = p.sq_entries;
+    sqSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqSize_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMmap) {
+        sqSize_ = cqSize_ = max(sqSize_, cqSize_);
+    }
+
+    sqPtr_ = mmap(0, sqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ringFd_, IORING_OFF_SQ_RING);
+    if(sqPtr_ == MAP_FAILED) return false;
+    if(singleMmap) {
+        cqPtr_ = sqPtr_;
+    } else {
+        cqPtr_ = mmap(0, cqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd_, IORING_OFF_CQ_RING);
+        if(cqPtr_ == MAP_FAILED) return false;
+    }
+    void* sqes = mmap(0, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) return false;
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqPtr_);
+    char* cq = static_cast<char*>(cqPtr_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+    localTail_ = *sqTail_;
+
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(wakeFd_ < 0) return false;
+    ArmWake_();
+    return true;
+}
+
+int IoUringPoller::Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, nullptr, 0);
+    } while(ret < 0 && errno == EINTR && minComplete == 0);
+    return ret;
+}
+
+// 把已填写的SQE发布给内核，返回待提交数量
+int IoUringPoller::Flush_() {
+    if(localTail_ != *sqTail_) {
+        toSubmit_ += localTail_ - *sqTail_;
+        __atomic_store_n(sqTail_, localTail_, __ATOMIC_RELEASE);
+    }
+    return toSubmit_;
+}
+
+// 取一个空闲SQE，SQ满时先提交一次腾出空间
+struct io_uring_sqe* IoUringPoller::GetSqe_() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if(localTail_ - head >= sqEntries_) {
+        unsigned n = Flush_();
+        if(Enter_(n, 0, 0) < 0) return nullptr;
+        toSubmit_ = 0;
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if(localTail_ - head >= sqEntries_) return nullptr;
+    }
+    unsigned idx = localTail_ & *sqMask_;
+    struct io_uring_sqe* sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[idx] = idx;
+    localTail_++;
+    return sqe;
+}
+
+bool IoUringPoller::InLoopThread_() const {
+    return hasLoop_ && loopId_ == this_thread::get_id();
+}
+
+bool IoUringPoller::Arm_(int fd, uint32_t events, uint64_t data) {
+    if(static_cast<size_t>(fd) >= fds_.size()) fds_.resize(fd + 1);
+    FdState& st = fds_[fd];
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return false;
+    st.seq++;
+    st.events = events;
+    st.data = data;
+    st.armed = true;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // poll掩码与epoll的低位事件位一致，ET/ONESHOT标志由单次/multishot表达
+    sqe->poll32_events = events & ~(EPOLLET | EPOLLONESHOT);
+    if(!(events & EPOLLONESHOT)) sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = MakeUserData_(fd, st.seq);
+    return true;
+}
+
+void IoUringPoller::Disarm_(int fd) {
+    if(static_cast<size_t>(fd) >= fds_.size() || !fds_[fd].armed) return;
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return;
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = MakeUserData_(fd, fds_[fd].seq);
+    sqe->user_data = REMOVE_DATA;
+    fds_[fd].armed = false;
+}
+
+void IoUringPoller::ArmWake_() {
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wakeFd_;
+    sqe->poll32_events = EPOLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = WAKE_DATA;
+}
+
+bool IoUringPoller::Apply_(const Change& change) {
+    int fd = change.fd;
+    switch(change.op) {
+    case ADD:
+        return Arm_(fd, change.events, change.data);
+    case MOD:
+        Disarm_(fd);
+        return Arm_(fd, change.events, change.data);
+    default:
+        Disarm_(fd);
+        if(static_cast<size_t>(fd) < fds_.size()) fds_[fd].seq++;
+        return true;
+    }
+}
+
+// loop线程直接填写SQE，但要先把其他线程更早排进来的修改做完，保持先后顺序
+// （工作线程DelFd后关闭fd，loop线程随即accept到同一个fd号并AddFd）。
+// 其他线程只排队，loop线程阻塞着时写一次eventfd，同一轮等待里不重复唤醒
+bool IoUringPoller::Submit_(const Change& change) {
+    if(!hasLoop_ || InLoopThread_()) {
+        ApplyQueued_();
+        return Apply_(change);
+    }
+    bool wake = false;
+    {
+        lock_guard<mutex> locker(mtx_);
+        queued_.push_back(change);
+        if(waiting_ && !woken_) {
+            woken_ = true;
+            wake = true;
+        }
+    }
+    if(wake) {
+        uint64_t one = 1;
+        ssize_t ret = write(wakeFd_, &one, sizeof(one));
+        (void)ret;  // 计数器满时返回EAGAIN，此时eventfd本来就可读
+    }
+    return true;
+}
+
+void IoUringPoller::ApplyQueued_() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(queued_.empty()) return;
+        applying_.swap(queued_);
+    }
+    for(const Change& change : applying_) {
+        Apply_(change);
+    }
+    applying_.clear();
+}
+
+bool IoUringPoller::AddFd(int fd, uint32_t events, uint64_t data) {
+    if(fd < 0) return false;
+    return Submit_({ADD, fd, events, data});
+}
+
+bool IoUringPoller::ModFd(int fd, uint32_t events, uint64_t data) {
+    if(fd < 0) return false;
+    return Submit_({MOD, fd, events, data});
+}
+
+bool IoUringPoller::DelFd(int fd) {
+    if(fd < 0) return false;
+    return Submit_({DEL, fd, 0, 0});
+}
+
+// 一次io_uring_enter完成：提交本轮积攒的SQE（含其他线程排队的修改）+ 等待至少一个完成事件
+int IoUringPoller::Wait(int timeoutMs, struct epoll_event* events, int maxEvents) {
+    if(!hasLoop_) {
+        loopId_ = this_thread::get_id();
+        hasLoop_ = true;
+    }
+    {
+        lock_guard<mutex> locker(mtx_);
+        applying_.swap(queued_);
+        waiting_ = true;
+    }
+    for(const Change& change : applying_) {
+        Apply_(change);
+    }
+    applying_.clear();
+    if(timeoutMs >= 0) {
+        // off=1：有任何其他完成事件就提前结束，避免超时SQE堆积
+        struct io_uring_sqe* sqe = GetSqe_();
+        if(sqe) {
+            ts_.tv_sec = timeoutMs / 1000;
+            ts_.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&ts_);
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = TIMEOUT_DATA;
+        }
+    }
+    unsigned toSubmit = Flush_();
+    toSubmit_ = 0;
+
+    unsigned head = *cqHead_;
+    if(head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+        int ret = Enter_(toSubmit, timeoutMs == 0 ? 0 : 1, IORING_ENTER_GETEVENTS);
+        if(ret < 0 && errno != EINTR && errno != ETIME) return -1;
+    } else if(toSubmit > 0) {
+        Enter_(toSubmit, 0, 0);
+    }
+    {
+        lock_guard<mutex> locker(mtx_);
+        waiting_ = false;
+        woken_ = false;
+    }
+
+    int cnt = 0;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    while(head != tail && cnt < maxEvents) {
+        struct io_uring_cqe* cqe = &cqes_[head & *cqMask_];
+        head++;
+        uint64_t data = cqe->user_data;
+        if(data == TIMEOUT_DATA || data == REMOVE_DATA) continue;
+        if(data == WAKE_DATA) {
+            uint64_t val;
+            ssize_t ret = read(wakeFd_, &val, sizeof(val));
+            (void)ret;
+            if(!(cqe->flags & IORING_CQE_F_MORE)) ArmWake_();
+            continue;
+        }
+
+        int fd = static_cast<int>(data & 0xffffffff);
+        uint32_t seq = static_cast<uint32_t>(data >> 32);
+        if(static_cast<size_t>(fd) >= fds_.size() || fds_[fd].seq != seq) continue; // 已被Mod/Del替换
+
+        FdState& st = fds_[fd];
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        if(!more) st.armed = false;
+        if(cqe->res == -ECANCELED) continue;
+
+        events[cnt].data.u64 = st.data;
+        events[cnt].events = cqe->res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe->res);
+        cnt++;
+
+        // multishot被内核终止（如CQ溢出）时自动重新注册，保持epoll常驻语义
+        if(!more && !(st.events & EPOLLONESHOT) && cqe->res >= 0) {
+            Arm_(fd, st.events, st.data);
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return cnt;
+}
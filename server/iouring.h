@@ -0,0 +1,104 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+// 不依赖liburing，直接用io_uring_setup/io_uring_enter系统调用实现的就绪通知后端。
+// 对外保持Epoller的语义：Add/Mod/Del只往SQ里放POLL_ADD/POLL_REMOVE，
+// 真正的提交和收割合并在Wait的一次io_uring_enter里完成。
+// SQ只由loop线程（调用Wait的线程）填写：其他线程的修改先放进队列，loop线程在下一次
+// 填写SQE或提交之前按顺序取出；loop线程正阻塞在io_uring_enter里时写eventfd唤醒它。
+// EPOLLONESHOT映射为单次poll，其余映射为multishot poll（监听套接字一次注册持续触发）
+class IoUringPoller {
+public:
+    IoUringPoller();
+    ~IoUringPoller();
+
+    bool Init(unsigned entries);
+    bool AddFd(int fd, uint32_t events, uint64_t data);
+    bool ModFd(int fd, uint32_t events, uint64_t data);
+    bool DelFd(int fd);
+    int Wait(int timeoutMs, struct epoll_event* events, int maxEvents);
+
+private:
+    struct FdState {
+        uint32_t seq = 0;       // 每次重新注册加一，用来丢弃旧poll的完成事件
+        uint32_t events = 0;
+        uint64_t data = 0;      // 原样回填到epoll_event.data.u64
+        bool armed = false;
+    };
+
+    enum OP { ADD, MOD, DEL };
+    struct Change {
+        OP op;
+        int fd;
+        uint32_t events;
+        uint64_t data;
+    };
+
+    struct io_uring_sqe* GetSqe_();
+    bool Arm_(int fd, uint32_t events, uint64_t data);
+    void Disarm_(int fd);
+    bool Apply_(const Change& change);
+    bool Submit_(const Change& change);
+    void ApplyQueued_();
+    void ArmWake_();
+    int Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags);
+    int Flush_();
+    bool InLoopThread_() const;
+
+    static uint64_t MakeUserData_(int fd, uint32_t seq) {
+        return (static_cast<uint64_t>(seq) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    static const uint64_t TIMEOUT_DATA = ~0ULL;
+    static const uint64_t REMOVE_DATA = ~0ULL - 1;
+    static const uint64_t WAKE_DATA = ~0ULL - 2;
+
+    int ringFd_;
+    unsigned sqEntries_;
+
+    void* sqPtr_;
+    void* cqPtr_;
+    size_t sqSize_;
+    size_t cqSize_;
+    struct io_uring_sqe* sqes_;
+
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqMask_;
+    unsigned* sqArray_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned* cqMask_;
+    struct io_uring_cqe* cqes_;
+
+    unsigned localTail_;    // 已填写但尚未发布给内核的SQE尾
+    unsigned toSubmit_;     // 已发布但尚未提交的SQE数
+
+    struct __kernel_timespec ts_;
+    std::vector<FdState> fds_;      // 只由loop线程访问
+    std::thread::id loopId_;
+    std::atomic<bool> hasLoop_;
+
+    int wakeFd_;            // eventfd，multishot poll常驻在环上
+    std::mutex mtx_;        // 保护queued_、waiting_和woken_
+    std::vector<Change> queued_;
+    std::vector<Change> applying_;
+    bool waiting_;          // loop线程已取走队列，即将或正在阻塞在io_uring_enter里
+    bool woken_;            // 本轮等待已经写过eventfd
+};
+
+#endif
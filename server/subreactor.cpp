@@ -0,0 +1,265 @@
+#include "subreactor.h"
+
+using namespace std;
+
+SubReactor::SubReactor(int id, int port, int timeoutMS, bool optLinger,
+                       uint32_t listenEvent, uint32_t connEvent,
+                       Epoller::BACKEND backend, const Offload& offload):
+    id_(id), port_(port), timeoutMS_(timeoutMS), openLinger_(optLinger),
+    maxConn_(Acceptor::MaxConn(MAX_FD)), isClose_(false), listenEvent_(listenEvent), connEvent_(connEvent),
+    timer_(new TimeWheel(MAX_FD)), epoller_(new Epoller(1024, backend)), users_(MAX_FD),
+    offload_(offload), blocked_(MAX_FD, 0), blocking_(0), wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    assert(offload_);
+    // 连接只在本线程处理，ONESHOT防止多线程同时处理的作用用不上
+    persistent_ = (connEvent_ & EPOLLET) && epoller_->Backend() == Epoller::EPOLL;
+    if(persistent_) {
+        connEvent_ &= ~EPOLLONESHOT;
+    }
+}
+
+// 常驻模式下兴趣集固定为读写都监听，ModFd与上次相同而被省掉；否则按需要切换
+uint32_t SubReactor::Interest_(uint32_t want) const {
+    return connEvent_ | (persistent_ ? (EPOLLIN | EPOLLOUT) : want);
+}
+
+SubReactor::~SubReactor() {
+    Stop();
+    Join();
+    while(blocking_ > 0) {
+        std::this_thread::yield();  // 工作线程还在用连接和done_
+    }
+    users_.ForEach([](HttpConn* client) { client->Close(); });
+    if(wakeFd_ >= 0) close(wakeFd_);
+}
+
+// 每个子Reactor各自bind同一端口，由内核按四元组哈希把新连接分给不同线程；
+// 监听套接字固定水平触发，每轮只取一批连接；io_uring后端没有水平触发，每次都取到队列为空
+bool SubReactor::Init() {
+    if(!acceptor_.Listen(port_, openLinger_, true)) {
+        return false;
+    }
+    acceptor_.SetDrain(epoller_->Backend() == Epoller::IO_URING);
+    if(!epoller_->AddFd(acceptor_.Fd(), (listenEvent_ & ~EPOLLET) | EPOLLIN)) {
+        LOG_ERROR("Add listen error!");
+        return false;
+    }
+    if(wakeFd_ < 0 || !epoller_->AddFd(wakeFd_, EPOLLIN)) {
+        LOG_ERROR("Add eventfd error!");
+        return false;
+    }
+    return true;
+}
+
+void SubReactor::Start() {
+    assert(!thread_.joinable());
+    thread_ = std::thread(&SubReactor::Loop_, this);
+}
+
+void SubReactor::Stop() {
+    isClose_ = true;
+}
+
+void SubReactor::Join() {
+    if(thread_.joinable()) thread_.join();
+}
+
+void SubReactor::Loop_() {
+    CachedClock::Bind(&clock_);     // 本线程的定时器、日志和响应头都读自己的时钟
+    clock_.Update();
+    LOG_INFO("SubReactor[%d] start, listenFd:%d", id_, acceptor_.Fd());
+    while(!isClose_) {
+        // 没有定时器时也要定期醒来检查isClose_
+        int timeMS = 1000;
+        if(timeoutMS_ > 0) {
+            int next = timer_->GetNextTick();
+            if(next >= 0 && next < timeMS) timeMS = next;
+        }
+        int eventCnt = epoller_->Wait(timeMS);
+        clock_.Update();
+        for(int i = 0; i < eventCnt; i++) {
+            int fd = epoller_->GetEventFd(i);
+            uint32_t events = epoller_->GetEvents(i);
+            if(fd == acceptor_.Fd()) {
+                DealListen_();
+                continue;
+            }
+            if(fd == wakeFd_) {
+                DealBlockingDone_();
+                continue;
+            }
+            HttpConn* client = users_.Get(epoller_->GetEventData(i));
+            if(!client || blocked_[fd]) {
+                continue;   // 在工作线程上的连接，回来后由DealBlockingDone_补读
+            }
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                CloseConn_(client);
+            }
+            else if(events & (EPOLLIN | EPOLLOUT)) {
+                // 常驻模式下一次事件可能同时带IN和OUT，OUT只在有待发数据时处理
+                if((events & EPOLLOUT) && client->ToWriteBytes() > 0) {
+                    DealWrite_(client);
+                    client = users_.Get(epoller_->GetEventData(i));
+                }
+                if(client && !blocked_[fd] && (events & EPOLLIN)) {
+                    DealRead_(client);
+                }
+            } else {
+                LOG_ERROR("Unexpected event");
+            }
+        }
+    }
+    Epoller::Stats stats = epoller_->GetStats();
+    LOG_INFO("SubReactor[%d] quit, epoll_wait:%llu epoll_ctl:%llu elided:%llu accepted:%llu shed:%llu", id_,
+             (unsigned long long)stats.waits, (unsigned long long)stats.ctls,
+             (unsigned long long)stats.elided, (unsigned long long)acceptor_.AcceptedCount(),
+             (unsigned long long)acceptor_.ShedCount());
+}
+
+// 连接数接近fd上限时新连接直接回503；只有可能阻塞的请求才进线程池，不看积压
+void SubReactor::DealListen_() {
+    acceptor_.Accept([this](int fd, const sockaddr_in& addr) { AddClient_(fd, addr); },
+                     [this](int fd) { return fd >= users_.Capacity() || HttpConn::userCount >= maxConn_; });
+}
+
+void SubReactor::AddClient_(int fd, sockaddr_in addr) {
+    assert(fd > 0);
+    HttpConn* client = users_.Acquire(fd);
+    client->init(fd, addr);
+    uint64_t key = users_.Key(fd);
+    if(timeoutMS_ > 0) {
+        timer_->add(fd, timeoutMS_, std::bind(&SubReactor::OnTimeout_, this, key));
+    }
+    epoller_->AddFd(fd, Interest_(EPOLLIN), key);
+    LOG_INFO("SubReactor[%d] Client[%d] in!", id_, fd);
+}
+
+// 连接只属于本线程，读写直接在loop线程完成
+void SubReactor::DealRead_(HttpConn* client) {
+    assert(client);
+    ExtentTime_(client);
+    int readErrno = 0;
+    ssize_t ret = client->read(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client);
+        return;
+    }
+    if(client->ToWriteBytes() > 0) {
+        // 常驻模式下上一轮响应还没发完：ET的读事件只来一次，先把数据读进缓冲区，发完再处理
+        epoller_->ModFd(client->GetFd(), Interest_(EPOLLOUT), users_.Key(client->GetFd()));
+        return;
+    }
+    OnProcess_(client);
+}
+
+void SubReactor::DealWrite_(HttpConn* client) {
+    assert(client);
+    ExtentTime_(client);
+    int writeErrno = 0;
+    ssize_t ret = client->write(&writeErrno);
+    if(client->ToWriteBytes() == 0) {
+        if(client->IsKeepAlive()) {
+            OnProcess_(client);
+            return;
+        }
+    }
+    else if(ret >= 0 || writeErrno == EAGAIN) {
+        // LT模式下write发完一段就返回，没遇到EAGAIN也可能没写完
+        epoller_->ModFd(client->GetFd(), Interest_(EPOLLOUT), users_.Key(client->GetFd()));
+        return;
+    }
+    CloseConn_(client);
+}
+
+// 响应生成后直接写，socket写得下就不用先注册EPOLLOUT再等一轮事件；
+// 写完后继续处理缓冲区里剩下的流水线请求，写不完才等EPOLLOUT；遇到可能阻塞的请求交给工作线程
+void SubReactor::OnProcess_(HttpConn* client) {
+    int fd = client->GetFd();
+    while(client->process(true)) {
+        int writeErrno = 0;
+        ssize_t ret = client->write(&writeErrno);
+        if(client->ToWriteBytes() > 0) {
+            if(ret < 0 && writeErrno != EAGAIN) {
+                CloseConn_(client);
+                return;
+            }
+            epoller_->ModFd(fd, Interest_(EPOLLOUT), users_.Key(fd));
+            return;
+        }
+        if(!client->IsKeepAlive()) {
+            CloseConn_(client);
+            return;
+        }
+    }
+    if(client->Deferred()) {
+        blocked_[fd] = 1;
+        blocking_++;
+        offload_(Task(std::bind(&SubReactor::OnBlocking_, this, client)));
+        return;
+    }
+    epoller_->ModFd(fd, Interest_(EPOLLIN), users_.Key(fd));
+}
+
+// 接着循环线程停下的地方处理完，响应留在输出链里，由本线程发送
+void SubReactor::OnBlocking_(HttpConn* client) {
+    client->process();
+    {
+        std::lock_guard<std::mutex> locker(doneMtx_);
+        done_.push_back(client);
+    }
+    uint64_t one = 1;
+    ssize_t ret = ::write(wakeFd_, &one, sizeof(one));
+    (void)ret;  // 计数器溢出才会失败，此时本线程必然还有未读的通知
+    blocking_--;
+}
+
+// 等待期间的事件都被忽略了：先补读一次（常驻ET模式下错过的EPOLLIN、对端关闭），再发送
+void SubReactor::DealBlockingDone_() {
+    uint64_t cnt;
+    ssize_t ret = ::read(wakeFd_, &cnt, sizeof(cnt));
+    (void)ret;
+    {
+        std::lock_guard<std::mutex> locker(doneMtx_);
+        doneLocal_.swap(done_);
+    }
+    for(HttpConn* client : doneLocal_) {
+        blocked_[client->GetFd()] = 0;
+        ExtentTime_(client);
+        int readErrno = 0;
+        ssize_t len = client->read(&readErrno);
+        if(len <= 0 && readErrno != EAGAIN) {
+            CloseConn_(client);
+        } else if(client->ToWriteBytes() > 0) {
+            DealWrite_(client);
+        } else {
+            OnProcess_(client);
+        }
+    }
+    doneLocal_.clear();
+}
+
+void SubReactor::ExtentTime_(HttpConn* client) {
+    assert(client);
+    if(timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
+}
+
+void SubReactor::CloseConn_(HttpConn* client) {
+    assert(client);
+    int fd = client->GetFd();
+    LOG_INFO("SubReactor[%d] Client[%d] quit!", id_, fd);
+    epoller_->DelFd(fd);
+    users_.Release(fd);     // 先让旧key失效，fd关闭后这个号随时可能被新连接复用
+    client->Close();
+}
+
+// 连接在工作线程上时不能关闭，超时顺延，回来后照常计时
+void SubReactor::OnTimeout_(uint64_t key) {
+    HttpConn* client = users_.Get(key);
+    if(!client) {
+        return;
+    }
+    if(blocked_[client->GetFd()]) {
+        timer_->add(client->GetFd(), timeoutMS_, std::bind(&SubReactor::OnTimeout_, this, key));
+        return;
+    }
+    CloseConn_(client);
+}
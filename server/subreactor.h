@@ -0,0 +1,94 @@
+#ifndef SUBREACTOR_H
+#define SUBREACTOR_H
+
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <fcntl.h>       // fcntl()
+#include <unistd.h>      // close()
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "epoller.h"
+#include "acceptor.h"
+#include "connslab.h"
+#include "../time/timewheel.h"
+#include "../log/log.h"
+#include "../pool/task.h"
+#include "../http/httpconn.h"
+
+// one loop per thread：每个子Reactor独占一个线程，拥有自己的监听套接字(SO_REUSEPORT)、
+// Epoller、定时器和连接表。连接从accept起就固定在所属线程上，读写直接在本线程完成，
+// 热路径上不需要跨线程加锁，也不经过线程池。
+// ET模式下连接不用EPOLLONESHOT：accept时一次注册EPOLLIN|EPOLLOUT，之后兴趣集不再变化，
+// 每次"重新激活"的MOD都被Epoller省掉；LT模式（或io_uring后端）仍按ONESHOT在读写之间切换。
+// 可能阻塞的请求（路由没有标记nonBlocking，如登录/注册查数据库；文件不在缓存内存里）
+// 经offload交给线程池，处理完由eventfd通知回本线程发送。期间连接归工作线程所有，
+// 本线程忽略它的事件、推迟它的超时，回来后先补读一次，常驻ET模式下错过的边沿不会丢
+class SubReactor {
+public:
+    typedef std::function<void(Task&& task)> Offload;
+
+    SubReactor(int id, int port, int timeoutMS, bool optLinger,
+               uint32_t listenEvent, uint32_t connEvent,
+               Epoller::BACKEND backend, const Offload& offload);
+    ~SubReactor();
+
+    bool Init();    // 创建本线程的监听套接字并加入epoller
+    void Start();   // 启动线程运行Loop_
+    void Stop();
+    void Join();
+
+private:
+    void Loop_();
+    void AddClient_(int fd, sockaddr_in addr);
+
+    void DealListen_();
+    void DealRead_(HttpConn* client);
+    void DealWrite_(HttpConn* client);
+
+    void ExtentTime_(HttpConn* client);
+    void CloseConn_(HttpConn* client);
+    void OnProcess_(HttpConn* client);
+    uint32_t Interest_(uint32_t want) const;
+    void OnTimeout_(uint64_t key);
+    void OnBlocking_(HttpConn* client);     // 工作线程上执行
+    void DealBlockingDone_();
+
+    static const int MAX_FD = 65536;
+
+    int id_;
+    int port_;
+    int timeoutMS_;
+    bool openLinger_;
+    int maxConn_;
+    std::atomic<bool> isClose_;
+
+    uint32_t listenEvent_;
+    uint32_t connEvent_;
+    bool persistent_;       // 常驻ET，不使用ONESHOT
+
+    CachedClock clock_;
+    std::unique_ptr<TimeWheel> timer_;
+    std::unique_ptr<Epoller> epoller_;
+    Acceptor acceptor_;
+    ConnSlab users_;
+    std::thread thread_;
+
+    Offload offload_;
+    std::vector<char> blocked_;         // 按fd下标，交给工作线程的连接，只由本线程访问
+    std::atomic<int> blocking_;         // 还在工作线程上的连接数，析构时等它归零
+    int wakeFd_;                        // eventfd，工作线程处理完后唤醒本线程
+    std::mutex doneMtx_;
+    std::vector<HttpConn*> done_;
+    std::vector<HttpConn*> doneLocal_;
+};
+
+#endif
@@ -6,21 +6,35 @@ WebServer::WebServer(
     int port,int trigMode,int timeoutMS,bool OptLinger,
     int sqlPort, const char* sqlUser,const char* sqlPwd,
     const char* dbName,int connPoolNum,int threadNum,
-    bool openLog,int logLevel,int logQueSize):
-    port_(port).openLinger_(OptLinger),timeoutMS_(timeoutMS),isClose_(false),
-    timer_(new HeapTimer()),threadpool_(new ThreadPool(threadNum)),epoller_(new Epoller())
+    bool openLog,int logLevel,int logQueSize,
+    int loopNum,int ioBackend,bool workStealing,bool zeroCopy,bool inlineFast):
+    port_(port),openLinger_(OptLinger),timeoutMS_(timeoutMS),isClose_(false),inlineFast_(inlineFast),maxConn_(Acceptor::MaxConn(MAX_FD)),
+    timer_(new TimeWheel(MAX_FD)),users_(MAX_FD),threadpool_(workStealing ? nullptr : new ThreadPool(threadNum)),
+    stealPool_(workStealing ? new WorkStealingPool(threadNum) : nullptr),epoller_(new Epoller(1024,static_cast<Epoller::BACKEND>(ioBackend)))
     {
+    // 对端关闭后sendfile/write会触发SIGPIPE，默认动作是结束进程；忽略后只返回EPIPE，照常关闭连接
+    signal(SIGPIPE,SIG_IGN);
     srcDir_ = getcwd(nullptr,256);
     assert(srcDir_);
+    // 上传的文件放在资源目录之外，不会被当作静态资源访问
+    MultipartParser::uploadDir = string(srcDir_) + "/upload";
+    mkdir(MultipartParser::uploadDir.c_str(),0700);
     strcat(srcDir_,"/resources/");
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    HttpConn::zeroCopy = zeroCopy;
+    FileCache::Instance()->Init(srcDir_);
+    InitRoutes_();
 
     //  初始化操作
     SqlConnPool::Instance()->Init("localhost",sqlPort,sqlUser,sqlPwd,dbName,connPoolNum);
     //  初始化事件和初始化socket（监听）
     InitEventMode_(trigMode);
-    if(!InitSocket_())  isClose_ =true;
+    if(loopNum > 0){
+        // 多Reactor模式：每个子Reactor用SO_REUSEPORT各自监听，不再创建主监听套接字
+        if(!InitSubReactors_(loopNum)) isClose_ = true;
+    }
+    else if(!InitSocket_())  isClose_ =true;
 
     // 是否打开日志标志
     if(openLog) {
@@ -30,20 +44,71 @@ WebServer::WebServer(
             LOG_INFO("========== Server init ==========");
             LOG_INFO("Port:%d,OpenLinger: %s",port_,OptLinger? "true" : "false");
             LOG_INFO("Listen Mode:%s,openConn Mode:%s",
-                        (listenEvent_ & EPOLLET ? "ET":"LT"),
+                        (listenEven_ & EPOLLET ? "ET":"LT"),
                         (connEvent_ & EPOLLET ? "ET": "LT"));
             LOG_INFO("LogSys level:%d",logLevel);
             LOG_INFO("srcDir:%s",HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num:%d, ThreadPool num: %d",connPoolNum,threadNum);
+            LOG_INFO("uploadDir:%s",MultipartParser::uploadDir.c_str());
+            LOG_INFO("SqlConnPool num:%d, ThreadPool num: %d, WorkStealing: %s",
+                        connPoolNum,threadNum,workStealing ? "true" : "false");
+            LOG_INFO("Reactor Mode:%s, SubReactor num:%d",
+                        (loopNum > 0 ? "one loop per thread" : "single reactor"),loopNum);
+            LOG_INFO("IO Backend:%s",
+                        (epoller_->Backend() == Epoller::IO_URING ? "io_uring" : "epoll"));
+            LOG_INFO("File Send:%s",(zeroCopy ? "sendfile" : "mmap+writev"));
+            LOG_INFO("Inline fast path:%s",(inlineFast ? "true" : "false"));
+            LOG_INFO("Backlog:%d, DeferAccept:%ds, AcceptBatch:%d, MaxConn:%d, MaxPending:%zu",
+                        Acceptor::backlog,Acceptor::deferAccept,Acceptor::batch,maxConn_,Acceptor::maxPending);
         }
     }
 }
 
 WebServer::~WebServer(){
-    close(listenFd_);
+    Epoller::Stats stats = epoller_->GetStats();
+    LOG_INFO("epoll_wait:%llu epoll_ctl:%llu elided:%llu batched:%llu",
+             (unsigned long long)stats.waits,(unsigned long long)stats.ctls,
+             (unsigned long long)stats.elided,(unsigned long long)stats.batched);
+    for(auto& sub : subReactors_){
+        sub->Stop();
+    }
+    subReactors_.clear();   // 析构时join子线程
+    LOG_INFO("accepted:%llu shed:%llu",(unsigned long long)acceptor_.AcceptedCount(),
+             (unsigned long long)acceptor_.ShedCount());
     isClose_ = true;
     free(srcDir_);
     SqlConnPool::Instance()->ClosePool();
+    FileCache::Instance()->Close();
+}
+
+// 内置路由：页面别名、登录/注册、其余GET按静态文件处理（HEAD没有单独注册时走GET的路由）。
+// 其他路由可以在Start之前用Router::Instance()->Add注册。登录/注册要查数据库，不标记nonBlocking
+void WebServer::InitRoutes_(){
+    Router* router = Router::Instance();
+    auto page = [](const string& path){
+        return [path](HttpRequest&,const RouteParams&,HttpResponse& resp){ resp.SetPath(path); };
+    };
+    router->Add("GET","/",page("/index.html"),true);
+    for(const char* name : {"index","register","login","welcome","video","picture"}){
+        string path = string("/") + name;
+        router->Add("GET",path,page(path + ".html"),true);
+    }
+    auto verify = [](bool isLogin){
+        return [isLogin](HttpRequest& req,const RouteParams&,HttpResponse& resp){
+            bool ok = HttpRequest::UserVerify(req.GetPost("username"),req.GetPost("password"),isLogin);
+            resp.SetPath(ok ? "/welcome.html" : "/error.html");
+        };
+    };
+    router->Add("POST","/register.html",verify(false));
+    router->Add("POST","/login.html",verify(true));
+    // 静态文件：路径已经由HttpResponse::Init设置，只去掉查询串
+    auto file = [](HttpRequest& req,const RouteParams&,HttpResponse& resp){
+        const string& path = req.path();
+        size_t query = path.find('?');
+        if(query != string::npos){
+            resp.SetPath(string_view(path).substr(0,query));
+        }
+    };
+    router->Add("GET","/*path",file,true);
 }
 
 void WebServer::InitEventMode_(int trigMode){
@@ -55,11 +120,14 @@ void WebServer::InitEventMode_(int trigMode){
         break;
     case 1:
         connEvent_ |= EPOLLET;
+        break;
     case 2:
         listenEven_ |= EPOLLET;
+        break;
     case 3:
         connEvent_ |= EPOLLET;
         listenEven_ |= EPOLLET;
+        break;
     default:
         listenEven_ |= EPOLLET;
         connEvent_ |= EPOLLET;
@@ -70,30 +138,44 @@ void WebServer::InitEventMode_(int trigMode){
 
 void WebServer::Start(){
     int timeMS = -1;
+    Router::Instance()->Freeze();   // 之后不能再注册路由
     if(!isClose_) LOG_INFO("========== Server start ==========");
+    if(!isClose_ && !subReactors_.empty()){
+        for(auto& sub : subReactors_){
+            sub->Start();
+        }
+        for(auto& sub : subReactors_){
+            sub->Join();
+        }
+        return;
+    }
     while(!isClose_){
         if(timeoutMS_ > 0){
             timeMS = timer_ -> GetNextTick();
         }
         int eventCnt = epoller_->Wait(timeMS);
-        for (i = 0; i < eventCnt; i++)
+        CachedClock::Instance()->Update();  // 每轮只取一次时间，供定时器/日志/响应头使用
+        for (int i = 0; i < eventCnt; i++)
         {
             int fd = epoller_->GetEventFd(i);
-            uint32_t events = epoller_->GetEventFd(i);
-            if(fd == listenFd_){
+            uint32_t events = epoller_->GetEvents(i);
+            if(fd == acceptor_.Fd()){
                 DealListen_();
+                continue;
+            }
+            // 代数不匹配说明fd已被回收复用，丢弃旧连接的残留事件
+            HttpConn* client = users_.Get(epoller_->GetEventData(i));
+            if(!client){
+                continue;
             }
-            else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)){
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)){
+                CloseConn_(client);
             }
             else if(events & EPOLLIN){
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                DealRead_(client);
             }
             else if(events & EPOLLOUT){
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                DealWrite_(client);
             } else {
                 LOG_ERROR("Unexpected event");
             }
@@ -101,32 +183,67 @@ void WebServer::Start(){
     }
 }
 
-// 处理监听套接字
+// 处理监听套接字：一次最多取Acceptor::batch个连接，超载的直接回503
 void WebServer::DealListen_(){
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-    do{
-        int fd = accept(listenFd_,(struct sockaddr *)&addr,&len);
-        if(fd <= 0) return;
-        else if(HttpConn::userCount >= MAX_FD){
-            SendError_(fd,"Server busy!");
-            LOG_WARN("Clients is full!");
-            return;
-        }
-        AddClient_(fd,addr);
-    }while(listenEven_ & EPOLLET);
+    acceptor_.Accept([this](int fd,const sockaddr_in& addr){ AddClient_(fd,addr); },
+                     [this](int fd){ return Overloaded_(fd); });
+}
+
+// 连接数接近fd上限，或线程池积压过多（新连接进来也只能排在后面，还会拖慢已接纳的连接）
+bool WebServer::Overloaded_(int fd){
+    if(fd >= users_.Capacity() || HttpConn::userCount >= maxConn_){
+        return true;
+    }
+    return Acceptor::maxPending > 0 && PendingTasks_() > Acceptor::maxPending;
+}
+
+size_t WebServer::PendingTasks_(){
+    return stealPool_ ? stealPool_->Pending() : threadpool_->Pending();
+}
+
+void WebServer::AddClient_(int fd,sockaddr_in addr){
+    assert(fd > 0);
+    HttpConn* client = users_.Acquire(fd);
+    client->init(fd,addr);
+    uint64_t key = users_.Key(fd);
+    if(timeoutMS_ > 0){
+        timer_->add(fd,timeoutMS_,std::bind(&WebServer::OnTimeout_,this,key));
+    }
+    epoller_->AddFd(fd,EPOLLIN | connEvent_,key);
+    LOG_INFO("Client[%d] in!",client->GetFd());
+}
+
+void WebServer::CloseConn_(HttpConn* client){
+    assert(client);
+    int fd = client->GetFd();
+    LOG_INFO("Client[%d] quit!",fd);
+    epoller_->DelFd(fd);
+    users_.Release(fd);     // 先让旧key失效，fd关闭后这个号随时可能被新连接复用
+    client->Close();
+}
+
+// 超时回调只携带key，连接已关闭或fd已被复用时什么都不做
+void WebServer::OnTimeout_(uint64_t key){
+    HttpConn* client = users_.Get(key);
+    if(client){
+        CloseConn_(client);
+    }
 }
 
 void WebServer::DealRead_(HttpConn* client){
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_,this,client));
+    if(inlineFast_){
+        OnReadInline_(client);
+        return;
+    }
+    AddTask_(std::bind(&WebServer::OnRead_,this,client));
 }
 
 void WebServer::DealWrite_(HttpConn* client){
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_,this,client));
+    AddTask_(std::bind(&WebServer::OnWrite_,this,client));
 }
 
 void WebServer::ExtentTime_(HttpConn* client){
@@ -139,18 +256,60 @@ void WebServer::OnRead_(HttpConn* client){
     int ret =-1;
     int readErrno = 0;
     ret = client->read(&readErrno);
-    if(ret <= 0 && readError != EAGAIN){
+    if(ret <= 0 && readErrno != EAGAIN){
         CloseConn_(client);
         return;
     }
     OnProcess(client);
 }
 
+// 快速路径：在事件循环线程上读、解析，响应全部来自缓存内存时直接写出，省去线程池的
+// 加锁、唤醒和线程切换。遇到可能阻塞的请求（查数据库、缓存未命中）时剩下的交给工作线程；
+// socket一次写不完时注册EPOLLOUT，后续发送照常由工作线程完成
+void WebServer::OnReadInline_(HttpConn* client){
+    int readErrno = 0;
+    ssize_t ret = client->read(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN){
+        CloseConn_(client);
+        return;
+    }
+    OnProcessInline_(client);
+}
+
+// 写完一轮后读缓冲区里可能还有超出MAX_PIPELINE的请求，接着处理，直到缓冲区空或需要等待
+void WebServer::OnProcessInline_(HttpConn* client){
+    int fd = client->GetFd();
+    while(client->process(true)){
+        int writeErrno = 0;
+        ssize_t ret = client->write(&writeErrno);
+        if(client->ToWriteBytes() > 0){
+            if(ret < 0 && writeErrno != EAGAIN){
+                CloseConn_(client);
+                return;
+            }
+            epoller_->QueueModFd(fd,connEvent_ | EPOLLOUT,users_.Key(fd));
+            return;
+        }
+        if(!client->IsKeepAlive()){
+            CloseConn_(client);
+            return;
+        }
+    }
+    if(client->Deferred()){
+        AddTask_(std::bind(&WebServer::OnProcess,this,client));
+    }else{
+        epoller_->QueueModFd(fd,connEvent_ | EPOLLIN,users_.Key(fd));
+    }
+}
+
+// 以下在工作线程上执行（快速路径时在loop线程上）。兴趣集的修改经QueueModFd：
+// loop线程忙着处理事件时排进队列，由它在下一次Wait前批量执行；它空闲阻塞时直接生效
 void WebServer::OnProcess(HttpConn* client){
+    int fd = client->GetFd();
     if(client->process()){
-        epoller_->ModFd(client->GetFd(),connEvent_ | EPOLLOUT);
+        epoller_->QueueModFd(fd,connEvent_ | EPOLLOUT,users_.Key(fd));
     }else{
-        epoller_->ModFd(client->GetFd(),connEvent_ | EPOLLIN);
+        epoller_->QueueModFd(fd,connEvent_ | EPOLLIN,users_.Key(fd));
     }
 }
 
@@ -159,81 +318,56 @@ void WebServer::OnWrite_(HttpConn* client){
     int ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);
+    int fd = client->GetFd();
     if(client->ToWriteBytes() == 0){
-        epoller_->ModFd(client->GetFd(),connEvent_ | EPOLLIN);
+        if(!client->IsKeepAlive()){
+            CloseConn_(client);     // Connection: close，或出错后的响应
+        }else if(client->HasPending()){
+            OnProcess(client);      // 缓冲区里剩下的流水线请求不会再触发EPOLLIN
+        }else{
+            epoller_->QueueModFd(fd,connEvent_ | EPOLLIN,users_.Key(fd));
+        }
         return;
     }else if(ret < 0){
         if(writeErrno == EAGAIN){
-            epoller_->ModFd(client->GetFd(),connEvent_ | EPOLLOUT);
+            epoller_->QueueModFd(fd,connEvent_ | EPOLLOUT,users_.Key(fd));
             return;
         }
     }
     CloseConn_(client);
 }
 
-bool  WebServer::InitSocket_(){
-    int ret;
-    struct sockaddr_in addr;
-    if(port_ > 65535 || port_ <1024) {
-        LOG_ERROR("Port:%d error!", port_);
-        return false;
-    }
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port_);
-
-    //  优雅关闭
-    {
-    struct linger optLinger ={ 0 };
-    if(openLinger_){
-        // 优雅关闭：直到所剩数据发送完毕或者超时
-        optLinger.l_onoff =1;
-        optLinger.l_linger =1;
-    }
-
-    listenFd_ = socket(AF_INET,SOCK_STREAM, 0);
-    if(listenFd_ < 0){
-        LOG_ERROR("Create socket error!",port_);
-        return false;
-    }
-
-    ret =setsockopt(listenFd_,SOL_SOCKET,SO_LINGER,&optLinger,sizeof(optLinger));
-    if(ret<0){
-        close(listenFd_);
-        LOG_ERROR("Init linger error!",port_);
-        return false;
-    }
-
-    //绑定
-    ret = bind(listenFd_,(struct sockaddr *)&addr,sizeof(addr));
-    if(ret < 0){
-        LOG_ERROR("Bind Port:%d error!",port_);
-        close(listenFd_);
+// 监听套接字固定水平触发：每轮只取一批连接，剩下的要在下一轮epoll_wait再报出来；
+// io_uring后端没有水平触发，每次都取到队列为空
+bool WebServer::InitSocket_(){
+    if(!acceptor_.Listen(port_,openLinger_,false)){
         return false;
-    };
-
-    //监听
-    ret = listen(listenFd_,6);
-    if(ret < 0){
-        LOH_ERROR("Listen port:%d error!",port_);
-        close(listenFd_);
-        return fasle;
     }
-    //将监听套接字加入epoller
-    ret = epoller_->AddFd(listenFd_,listenEven_ | EPOLLIN);
-    if(ret == 0){
+    acceptor_.SetDrain(epoller_->Backend() == Epoller::IO_URING);
+    if(!epoller_->AddFd(acceptor_.Fd(),(listenEven_ & ~EPOLLET) | EPOLLIN)){
         LOG_ERROR("Add listen error!");
-        clsoe(listenFd_);
         return false;
     }
-    SetFdNonblock(listenFd_);
     LOG_INFO("Server port:%d",port_);
     return true;
 }
 
-//设置非阻塞
-int WebServer::SetFdNonblock(int fd){
-    assert(fd > 0);
-    return fcntl(fd,F_SETFL,fctnl(fd,F_GETFD,0) | O_NONBLOCK);
+// 创建loopNum个子Reactor，每个持有一个SO_REUSEPORT监听套接字；
+// 可能阻塞的请求（登录/注册查数据库等）由子Reactor交给线程池，不卡住它上面的其他连接
+bool WebServer::InitSubReactors_(int loopNum){
+    assert(loopNum > 0);
+    SubReactor::Offload offload = [this](Task&& task){ AddTask_(std::move(task)); };
+    for(int i = 0; i < loopNum; i++){
+        std::unique_ptr<SubReactor> sub(new SubReactor(i, port_, timeoutMS_, openLinger_,
+                                                        listenEven_, connEvent_,
+                                                        epoller_->Backend(), offload));
+        if(!sub->Init()){
+            LOG_ERROR("SubReactor[%d] init error!", i);
+            subReactors_.clear();
+            return false;
+        }
+        subReactors_.push_back(std::move(sub));
+    }
+    LOG_INFO("Server port:%d",port_);
+    return true;
 }
-}
\ No newline at end of file
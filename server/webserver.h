@@ -1,23 +1,31 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
+#include <vector>
+#include <memory>
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
+#include <sys/stat.h>    // mkdir()
 #include <assert.h>
 #include <errno.h>
+#include <signal.h>      // signal()
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include "epoller.h"
-#include "../timer/heaptimer.h"
+#include "acceptor.h"
+#include "subreactor.h"
+#include "connslab.h"
+#include "../time/timewheel.h"
 
 #include "../log/log.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
+#include "../pool/workstealingpool.h"
 
 #include "../http/httpconn.h"
+#include "../http/filecache.h"
 
 class WebServer {
 public:
@@ -25,44 +33,64 @@ public:
         int port,int trigMode, int timeoutMS,bool OptLinger,
         int sqlPort, const char* sqlUser,const char* sqlPwd,
         const char* dbName, int connPoolNum,int threadNum,
-        bool openLog,int logLevel,int logQueSize);
+        bool openLog,int logLevel,int logQueSize,
+        int loopNum = 0, int ioBackend = 0, bool workStealing = false,
+        bool zeroCopy = false, bool inlineFast = false);
 
         ~WebServer();
         void Start();
 private:
     bool InitSocket_();
+    bool InitSubReactors_(int loopNum);
     void InitEventMode_(int trigMode);
+    void InitRoutes_();
     void AddClient_(int fd,sockaddr_in addr);
 
     void DealListen_();
     void DealWrite_(HttpConn* client);
     void DealRead_(HttpConn* client);
 
-    void SendError_(int fd,const char* info);
+    bool Overloaded_(int fd);
+    size_t PendingTasks_();
     void ExtentTime_(HttpConn* client);
     void CloseConn_(HttpConn* client);
 
     void OnRead_(HttpConn* client);
+    void OnReadInline_(HttpConn* client);
+    void OnProcessInline_(HttpConn* client);
     void OnWrite_(HttpConn* client);
     void OnProcess(HttpConn* client);
+    void OnTimeout_(uint64_t key);
+
+    // 按启动参数把任务交给普通线程池或工作窃取线程池
+    template<typename T>
+    void AddTask_(T&& task){
+        if(stealPool_) stealPool_->AddTask(std::forward<T>(task));
+        else threadpool_->AddTask(std::forward<T>(task));
+    }
 
     static const int MAX_FD = 65536;
-    static int SetFdNonblock(int fd);
 
     int port_;
     bool openLinger_;
     int timeoutMS_;
     bool isClose_;
-    int listenFd_;
+    bool inlineFast_;   // 静态缓存命中的请求在事件循环线程上直接处理，不经过线程池
+    int maxConn_;
     char* srcDir_;
 
     uint32_t listenEven_;
     uint32_t connEvent_;
 
-    std::unique_ptr<HeapTimer> timer;
+    std::unique_ptr<TimeWheel> timer_;
+    ConnSlab users_;
     std::unique_ptr<ThreadPool> threadpool_;
+    std::unique_ptr<WorkStealingPool> stealPool_;
     std::unique_ptr<Epoller> epoller_;
-    std::unordered_map<int,HttpConn> users_;
-}
+    Acceptor acceptor_;
+
+    // loopNum > 0 时启用 one loop per thread 模式，主线程只负责等待子Reactor
+    std::vector<std::unique_ptr<SubReactor>> subReactors_;
+};
 
 #endif
\ No newline at end of file
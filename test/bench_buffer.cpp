@@ -0,0 +1,184 @@
+// 每个连接的缓冲区内存：池化的Buffer vs 原来std::vector<char>实现的Buffer。
+// 每个连接一个读缓冲、一个写缓冲（与HttpConn相同），依次经历三个阶段：
+//   idle    ：刚建立，还没有数据
+//   busy    ：读缓冲里有一个完整请求、写缓冲里有响应头（1%的连接是60KB的上传）
+//   drained ：请求处理完、响应发完，回到keep-alive空闲
+// 请求都经ReadFd从管道读进来：池化版直接读进池里的块，原实现读进vector，多出的部分经64KB栈上数组再Append。
+// 每种实现在单独的子进程里跑，除了按容量统计的字节数，也给出RSS的增量。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. bench_buffer.cpp ../buffer/*.cpp -o bench_buffer -lpthread
+// 运行：./bench_buffer [连接数...]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+#include "../buffer/buffer.h"
+
+using namespace std;
+
+// 原实现：vector初始1024字节，只增不减，RetrieveAll时bzero整个vector
+class VectorBuffer {
+public:
+    VectorBuffer() : buffer_(1024), readPos_(0), writePos_(0) {}
+    size_t Capacity() const { return buffer_.capacity(); }
+    void Append(const char* str, size_t len) {
+        if(buffer_.size() - writePos_ < len) MakeSpace_(len);
+        copy(str, str + len, buffer_.begin() + writePos_);
+        writePos_ += len;
+    }
+    void RetrieveAll() {
+        bzero(&buffer_[0], buffer_.size());
+        readPos_ = writePos_ = 0;
+    }
+    ssize_t ReadFd(int fd) {
+        char buff[65535];
+        struct iovec iov[2];
+        size_t writable = buffer_.size() - writePos_;
+        iov[0].iov_base = &buffer_[0] + writePos_;
+        iov[0].iov_len = writable;
+        iov[1].iov_base = buff;
+        iov[1].iov_len = sizeof(buff);
+        ssize_t len = readv(fd, iov, 2);
+        if(len <= 0) return len;
+        if(static_cast<size_t>(len) <= writable) {
+            writePos_ += len;
+        } else {
+            writePos_ = buffer_.size();
+            Append(buff, len - writable);
+        }
+        return len;
+    }
+
+private:
+    void MakeSpace_(size_t len) {
+        if(buffer_.size() - writePos_ + readPos_ < len) {
+            buffer_.resize(writePos_ + len + 1);
+        } else {
+            size_t readable = writePos_ - readPos_;
+            copy(buffer_.begin() + readPos_, buffer_.begin() + writePos_, buffer_.begin());
+            readPos_ = 0;
+            writePos_ = readable;
+        }
+    }
+    vector<char> buffer_;
+    size_t readPos_;
+    size_t writePos_;
+};
+
+struct PooledConn {
+    Buffer read;
+    Buffer write;
+    size_t Bytes() const { return read.Capacity() + write.Capacity(); }
+    void Read(int fd) { int err = 0; read.ReadFd(fd, &err); }
+    void Respond(const string& header) { write.Append(header); }
+    void Drain() { read.RetrieveAll(); write.RetrieveAll(); }
+};
+
+struct VectorConn {
+    VectorBuffer read;
+    VectorBuffer write;
+    size_t Bytes() const { return read.Capacity() + write.Capacity(); }
+    void Read(int fd) { read.ReadFd(fd); }
+    void Respond(const string& header) { write.Append(header.data(), header.size()); }
+    void Drain() { read.RetrieveAll(); write.RetrieveAll(); }
+};
+
+static long RssBytes() {
+    long pages = 0, rss = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if(fp) {
+        if(fscanf(fp, "%ld %ld", &pages, &rss) != 2) rss = 0;
+        fclose(fp);
+    }
+    return rss * sysconf(_SC_PAGESIZE);
+}
+
+struct Phase {
+    double bytes;   // 缓冲区容量之和 / 连接数
+    double rss;     // RSS增量 / 连接数
+};
+
+static string MakeRequest(size_t body) {
+    string req = "POST /upload HTTP/1.1\r\nHost: www.example.com\r\nConnection: keep-alive\r\n"
+                 "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+                 "Chrome/124.0.0.0 Safari/537.36\r\nAccept: text/html,application/xhtml+xml,*/*;q=0.8\r\n"
+                 "Accept-Encoding: gzip, deflate, br\r\nAccept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+                 "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n";
+    req += "Content-Length: " + to_string(body) + "\r\n\r\n" + string(body, 'b');
+    return req;
+}
+
+template<typename Conn>
+static void Run(int n, Phase out[3]) {
+    int pfd[2];
+    if(pipe(pfd) < 0) abort();
+    fcntl(pfd[0], F_SETPIPE_SZ, 1 << 20);
+    string small = MakeRequest(0);
+    string upload = MakeRequest(60 << 10);
+    string header = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nContent-type: text/html\r\n"
+                    "ETag: \"5f2c1a-3e8\"\r\nContent-length: 1000\r\n\r\n";
+
+    long rss0 = RssBytes();
+    vector<Conn> conns(n);
+    auto measure = [&](Phase& p) {
+        size_t bytes = 0;
+        for(auto& c : conns) bytes += c.Bytes();
+        p.bytes = static_cast<double>(bytes) / n;
+        p.rss = static_cast<double>(RssBytes() - rss0) / n;
+    };
+    measure(out[0]);
+    for(int i = 0; i < n; i++) {
+        const string& req = (i % 100 == 0) ? upload : small;
+        if(write(pfd[1], req.data(), req.size()) != static_cast<ssize_t>(req.size())) abort();
+        conns[i].Read(pfd[0]);
+        conns[i].Respond(header);
+    }
+    measure(out[1]);
+    for(auto& c : conns) c.Drain();
+    measure(out[2]);
+    close(pfd[0]);
+    close(pfd[1]);
+}
+
+// 在子进程里跑，RSS不受前一次运行留下的堆影响
+template<typename Conn>
+static void RunIsolated(int n, Phase out[3]) {
+    int pfd[2];
+    if(pipe(pfd) < 0) abort();
+    pid_t pid = fork();
+    if(pid == 0) {
+        Phase r[3];
+        Run<Conn>(n, r);
+        if(write(pfd[1], r, sizeof(r)) != sizeof(r)) _exit(1);
+        _exit(0);
+    }
+    if(read(pfd[0], out, sizeof(Phase) * 3) != sizeof(Phase) * 3) abort();
+    waitpid(pid, nullptr, 0);
+    close(pfd[0]);
+    close(pfd[1]);
+}
+
+int main(int argc, char** argv) {
+    vector<int> sizes;
+    for(int i = 1; i < argc; i++) sizes.push_back(atoi(argv[i]));
+    if(sizes.empty()) sizes = {1000, 10000, 50000};
+
+    static const char* const PHASE[] = {"idle", "busy", "drained"};
+    printf("%7s %-8s | %12s %12s | %12s %12s   (bytes/conn)\n", "conns", "phase",
+           "vector buf", "vector rss", "pooled buf", "pooled rss");
+    for(int n : sizes) {
+        Phase vec[3], pooled[3];
+        RunIsolated<VectorConn>(n, vec);
+        RunIsolated<PooledConn>(n, pooled);
+        for(int p = 0; p < 3; p++) {
+            printf("%7d %-8s | %12.0f %12.0f | %12.0f %12.0f\n", n, PHASE[p],
+                   vec[p].bytes, vec[p].rss, pooled[p].bytes, pooled[p].rss);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// 快速路径的延迟分布：同一个2KB的缓存文件，WebServer分别以inlineFast=false（读/写都经线程池）
+// 和inlineFast=true（循环线程上直接读、解析、写）运行，单Reactor + 4个工作线程，ET模式。
+// 客户端是另一个进程里的若干线程，每个线程一条keep-alive连接，发一个请求收一个响应（闭环），
+// 记录每个请求的往返时间，输出吞吐和p50/p90/p99/p99.9。
+// Router是单例，每种模式的服务器在单独的子进程里启动。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. bench_inline.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o bench_inline -lpthread -lz -lmysqlclient
+// 运行：./bench_inline [每种并发下的总请求数]
+#include <signal.h>
+#include <sys/wait.h>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18340;
+static const char REQUEST[] = "GET /index.html HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n";
+
+static pid_t StartServer(int port, bool inlineFast) {
+    pid_t pid = fork();
+    if(pid == 0) {
+        WebServer server(port, 3, 60000, false,
+                         3306, "root", "root", "webserver",
+                         1, 4, false, 1, 0,
+                         0, Epoller::EPOLL, false, false, inlineFast);
+        server.Start();
+        _exit(0);
+    }
+    return pid;
+}
+
+struct Result {
+    double qps;
+    double p[4];    // 微秒
+};
+
+static Result RunClients(int port, int conns, int reqs, size_t bodyLen) {
+    vector<vector<double>> lat(conns);
+    vector<thread> threads;
+    auto t0 = chrono::steady_clock::now();
+    for(int c = 0; c < conns; c++) {
+        threads.emplace_back([&, c] {
+            int fd = TestConnect(port);
+            CHECK(fd >= 0);
+            lat[c].reserve(reqs);
+            for(int i = 0; i < reqs; i++) {
+                auto s = chrono::steady_clock::now();
+                TestResponse resp = TestGet(fd, REQUEST);
+                lat[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - s).count());
+                CHECK(resp.code == 200 && resp.body.size() == bodyLen);
+            }
+            close(fd);
+        });
+    }
+    for(auto& t : threads) t.join();
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    vector<double> all;
+    for(auto& v : lat) all.insert(all.end(), v.begin(), v.end());
+    sort(all.begin(), all.end());
+    Result r;
+    r.qps = all.size() / sec;
+    const double PCT[4] = {0.50, 0.90, 0.99, 0.999};
+    for(int i = 0; i < 4; i++) {
+        r.p[i] = all[min(all.size() - 1, static_cast<size_t>(PCT[i] * all.size()))];
+    }
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int reqs = argc > 1 ? atoi(argv[1]) : 20000;
+    string root = TestMakeRoot();
+    string body(2048, 'i');
+    TestWriteFile(root + "/resources/index.html", body);
+    CHECK(chdir(root.c_str()) == 0);
+
+    printf("%-10s %5s | %9s | %9s %9s %9s %9s   (us)\n", "mode", "conns", "req/s", "p50", "p90", "p99", "p99.9");
+    for(int mode = 0; mode < 2; mode++) {
+        bool inlineFast = mode == 1;
+        int port = PORT + mode;
+        pid_t server = StartServer(port, inlineFast);
+        RunClients(port, 4, 200, body.size());      // 预热：文件进入缓存的小文件层
+        for(int conns : {1, 16, 64}) {
+            Result r = RunClients(port, conns, max(200, reqs / conns), body.size());
+            printf("%-10s %5d | %9.0f | %9.1f %9.1f %9.1f %9.1f\n", inlineFast ? "inline" : "threadpool",
+                   conns, r.qps, r.p[0], r.p[1], r.p[2], r.p[3]);
+        }
+        kill(server, SIGKILL);
+        waitpid(server, nullptr, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+// 路由查找耗时：压平后的基数树(Router::Find)，10/100/1000条路由。
+// 路由表仿照常见API：约3/4是静态路径（/api/v1/orders7/list），1/4带参数（/api/v1/users7/:id/posts）。
+//   static：命中静态路由      param：命中参数路由，要回溯比较
+//   miss  ：路径不存在(404)   405  ：路径存在但方法不对，要收集Allow
+// 对照列linear是原来ParsePath_的做法：在路径表里逐个比较，只能处理静态路径。
+// 结果是每次查找的平均纳秒数。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. bench_router.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o bench_router -lpthread -lz -lmysqlclient
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../http/router.h"
+
+using namespace std;
+
+static const char* const RESOURCES[] = {"users", "orders", "items", "carts", "posts", "tags", "files", "stats"};
+
+static size_t sink;
+
+template<typename F>
+static double NsPerLookup(const vector<string>& paths, int rounds, F&& find) {
+    auto t0 = chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        for(const string& p : paths) find(p);
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / (rounds * paths.size());
+}
+
+int main(int argc, char** argv) {
+    int lookups = argc > 1 ? atoi(argv[1]) : 2000000;
+    printf("%6s | %10s %10s %10s %10s | %10s   (ns/lookup)\n", "routes",
+           "static", "param", "miss", "405", "linear");
+    for(int n : {10, 100, 1000}) {
+        Router router;
+        auto handler = [](HttpRequest&, const RouteParams&, HttpResponse&) {};
+        vector<string> statics, params, misses, wrongMethod, table;
+        for(int i = 0; i < n; i++) {
+            string base = string("/api/v1/") + RESOURCES[i % 8] + to_string(i / 8);
+            if(i % 4 == 3) {
+                router.Add("GET", base + "/:id/posts", handler);
+                params.push_back(base + "/" + to_string(1000 + i) + "/posts");
+            } else {
+                router.Add("GET", base + "/list", handler);
+                statics.push_back(base + "/list");
+                table.push_back(base + "/list");
+                wrongMethod.push_back(base + "/list");
+            }
+            misses.push_back(base + "/missing");
+        }
+        router.Freeze();
+        mt19937 rng(n);
+        for(auto* v : {&statics, &params, &misses, &wrongMethod}) shuffle(v->begin(), v->end(), rng);
+
+        RouteParams rp;
+        uint32_t allow;
+        auto get = [&](const string& p) { sink += router.Find("GET", p, &rp, &allow) != nullptr; };
+        auto post = [&](const string& p) { sink += router.Find("POST", p, &rp, &allow) == nullptr ? allow : 0; };
+        double s = NsPerLookup(statics, lookups / statics.size(), get);
+        double p = NsPerLookup(params, lookups / params.size(), [&](const string& path) {
+            get(path);
+            sink += rp.Size();
+        });
+        double m = NsPerLookup(misses, lookups / misses.size(), get);
+        double w = NsPerLookup(wrongMethod, lookups / wrongMethod.size(), post);
+        double l = NsPerLookup(statics, max<size_t>(1, lookups / statics.size() / 10), [&](const string& path) {
+            sink += find(table.begin(), table.end(), path) - table.begin();
+        });
+        printf("%6zu | %10.1f %10.1f %10.1f %10.1f | %10.1f\n", router.RouteCount(), s, p, m, w, l);
+    }
+    return sink == 0;
+}
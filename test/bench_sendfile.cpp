@@ -0,0 +1,193 @@
+// 静态文件发送对比：sendfile(zeroCopy) vs 每个响应open+mmap+writev+munmap（原来的做法）。
+// 两种都经过OutputQueue，与HttpConn发送响应时相同：响应头一段文本，正文一段文件或内存。
+// 对端是回环TCP上的另一个线程，只管recv丢弃。
+//   小文件：4KB/64KB/1MB，反复发送，看每个响应的耗时和发送线程CPU时间
+//   大文件：默认2GB/4GB的稀疏文件（不占磁盘，页缓存里是零页），各发一次，看吞吐
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. bench_sendfile.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o bench_sendfile -lpthread -lz -lmysqlclient
+// 运行：./bench_sendfile [大文件GB数，0跳过大文件]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string>
+#include "../http/outputqueue.h"
+
+using namespace std;
+
+static const char HEADER[] = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nContent-type: text/html\r\n";
+
+struct Result {
+    double usPerResp;   // 墙钟时间
+    double cpuPerResp;  // 发送线程CPU时间（用户+内核）
+    double mbps;
+};
+
+static double ThreadCpuUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 回环上的一对连接，接收线程把收到的数据全部丢弃
+struct Link {
+    int send = -1;
+    int recv = -1;
+    atomic<size_t> received{0};
+    thread reader;
+
+    Link() {
+        int lfd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if(bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0) abort();
+        getsockname(lfd, (struct sockaddr*)&addr, &len);
+        send = socket(AF_INET, SOCK_STREAM, 0);
+        if(connect(send, (struct sockaddr*)&addr, sizeof(addr)) < 0) abort();
+        recv = accept(lfd, nullptr, nullptr);
+        close(lfd);
+        reader = thread([this] {
+            static char buf[1 << 20];
+            ssize_t n;
+            while((n = ::recv(recv, buf, sizeof(buf), 0)) > 0) received += n;
+        });
+    }
+    ~Link() {
+        shutdown(send, SHUT_WR);
+        reader.join();
+        close(send);
+        close(recv);
+    }
+    void WaitFor(size_t bytes) {
+        while(received.load() < bytes) this_thread::yield();
+    }
+};
+
+static size_t Header(OutputQueue& out, size_t len) {
+    Buffer& text = out.Text();
+    text.Append(HEADER, sizeof(HEADER) - 1);
+    text.Append("Content-length: " + to_string(len) + "\r\n\r\n");
+    out.AddText(text.ReadableBytes());
+    return text.ReadableBytes();
+}
+
+static void Flush(OutputQueue& out, int fd) {
+    out.Seal();
+    while(out.Bytes() > 0) {
+        int err = 0;
+        if(out.Write(fd, &err) < 0) {
+            fprintf(stderr, "write: %s\n", strerror(err));
+            exit(1);
+        }
+    }
+    out.Clear();
+}
+
+// 一个响应：zeroCopy时正文交给sendfile，否则映射后writev；返回发送的字节数
+static size_t SendOne(OutputQueue& out, int sock, const char* path, bool zeroCopy) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) abort();
+    struct stat st;
+    fstat(fd, &st);
+    size_t len = st.st_size;
+    size_t bytes = Header(out, len) + len;
+    if(zeroCopy) {
+        out.AddFile(fd, 0, len);
+        Flush(out, sock);
+    } else {
+        void* mm = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mm == MAP_FAILED) abort();
+        out.AddMemory(static_cast<const char*>(mm), len);
+        Flush(out, sock);
+        munmap(mm, len);
+    }
+    close(fd);
+    return bytes;
+}
+
+static Result Run(const char* path, int times, bool zeroCopy) {
+    Link link;
+    OutputQueue out;
+    link.WaitFor(SendOne(out, link.send, path, zeroCopy));     // 预热页缓存
+
+    size_t start = link.received.load();
+    size_t total = start;
+    double cpu0 = ThreadCpuUs();
+    auto t0 = chrono::steady_clock::now();
+    for(int i = 0; i < times; i++) {
+        total += SendOne(out, link.send, path, zeroCopy);
+    }
+    double cpu = ThreadCpuUs() - cpu0;
+    link.WaitFor(total);
+    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+    Result r;
+    r.usPerResp = us / times;
+    r.cpuPerResp = cpu / times;
+    r.mbps = (total - start) / us;
+    return r;
+}
+
+static string MakeFile(const string& dir, const string& name, off_t size, bool sparse) {
+    string path = dir + "/" + name;
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if(fd < 0) abort();
+    if(sparse) {
+        if(ftruncate(fd, size) < 0) abort();
+    } else {
+        string data(size, 'x');
+        if(write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) abort();
+    }
+    close(fd);
+    return path;
+}
+
+static void Print(const char* name, int times, const Result& mm, const Result& sf) {
+    printf("%-8s %6d | %10.1f %10.1f %9.0f | %10.1f %10.1f %9.0f | %6.2fx\n", name, times,
+           mm.usPerResp, mm.cpuPerResp, mm.mbps, sf.usPerResp, sf.cpuPerResp, sf.mbps,
+           mm.usPerResp / sf.usPerResp);
+}
+
+int main(int argc, char** argv) {
+    int bigGB = argc > 1 ? atoi(argv[1]) : 2;
+    char tmpl[] = "/tmp/bench-sendfile-XXXXXX";
+    if(!mkdtemp(tmpl)) abort();
+    string dir = tmpl;
+
+    printf("%-8s %6s | %10s %10s %9s | %10s %10s %9s | %7s\n", "file", "resps",
+           "mmap us", "mmap cpu", "MB/s", "sendf us", "sendf cpu", "MB/s", "speedup");
+    const struct { const char* name; off_t size; int times; } SMALL[] = {
+        { "4KB", 4 << 10, 20000 },
+        { "64KB", 64 << 10, 5000 },
+        { "1MB", 1 << 20, 500 },
+    };
+    for(auto& f : SMALL) {
+        string path = MakeFile(dir, f.name, f.size, false);
+        Result mm = Run(path.c_str(), f.times, false);
+        Result sf = Run(path.c_str(), f.times, true);
+        Print(f.name, f.times, mm, sf);
+        unlink(path.c_str());
+    }
+    for(int gb = bigGB; gb > 0 && gb <= 2 * bigGB; gb *= 2) {
+        string name = to_string(gb) + "GB";
+        string path = MakeFile(dir, name, static_cast<off_t>(gb) << 30, true);
+        Result mm = Run(path.c_str(), 1, false);
+        Result sf = Run(path.c_str(), 1, true);
+        Print(name.c_str(), 1, mm, sf);
+        unlink(path.c_str());
+    }
+    rmdir(dir.c_str());
+    return 0;
+}
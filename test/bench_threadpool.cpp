@@ -0,0 +1,85 @@
+// 线程池吞吐对比：ThreadPool（单队列+互斥锁+条件变量） vs WorkStealingPool，1~64个工作线程。
+//   external：一个外部线程连续提交，模拟epoll主线程分发I/O事件
+//   nested  ：外部只提交根任务，每个任务在工作线程里再提交子任务，体现本地队列和窃取
+// 每个任务做一小段计算（约几百纳秒），接近解析一个小请求的开销。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. bench_threadpool.cpp -o bench_threadpool -lpthread
+// 运行：./bench_threadpool [任务数，默认200000]
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "../pool/threadpool.h"
+#include "../pool/workstealingpool.h"
+
+using namespace std;
+
+static const int FANOUT = 4;
+static atomic<long> done;
+static atomic<unsigned> sink;
+
+static void Work() {
+    unsigned x = 1;
+    for(int i = 0; i < 200; i++) x = x * 1103515245 + 12345;
+    sink.fetch_add(x, memory_order_relaxed);
+    done.fetch_add(1, memory_order_release);
+}
+
+template<typename Pool>
+struct Nested {
+    Pool* pool;
+    int depth;
+    void operator()() {
+        Work();
+        if(depth > 0) {
+            for(int i = 0; i < FANOUT; i++) pool->AddTask(Nested{pool, depth - 1});
+        }
+    }
+};
+
+static void WaitDone(long total) {
+    while(done.load(memory_order_acquire) < total) this_thread::yield();
+}
+
+// 返回每秒完成的任务数
+template<typename Pool>
+static double External(int workers, long tasks) {
+    Pool pool(workers);
+    done = 0;
+    auto t0 = chrono::steady_clock::now();
+    for(long i = 0; i < tasks; i++) pool.AddTask([] { Work(); });
+    WaitDone(tasks);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return tasks / secs;
+}
+
+template<typename Pool>
+static double NestedRun(int workers, long tasks) {
+    // 深度3、扇出4的树每棵85个任务
+    const int depth = 3;
+    long perTree = 1 + FANOUT + FANOUT * FANOUT + FANOUT * FANOUT * FANOUT;
+    long trees = tasks / perTree + 1;
+    Pool pool(workers);
+    done = 0;
+    auto t0 = chrono::steady_clock::now();
+    for(long i = 0; i < trees; i++) pool.AddTask(Nested<Pool>{&pool, depth});
+    WaitDone(trees * perTree);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return trees * perTree / secs;
+}
+
+int main(int argc, char** argv) {
+    long tasks = argc > 1 ? atol(argv[1]) : 200000;
+    printf("tasks=%ld hardware_concurrency=%u\n", tasks, thread::hardware_concurrency());
+    printf("%8s %16s %16s %16s %16s\n", "workers", "mutex/external", "steal/external",
+           "mutex/nested", "steal/nested");
+    for(int workers : {1, 2, 4, 8, 16, 32, 64}) {
+        double a = External<ThreadPool>(workers, tasks);
+        double b = External<WorkStealingPool>(workers, tasks);
+        double c = NestedRun<ThreadPool>(workers, tasks);
+        double d = NestedRun<WorkStealingPool>(workers, tasks);
+        printf("%8d %14.0f/s %14.0f/s %14.0f/s %14.0f/s\n", workers, a, b, c, d);
+    }
+    return 0;
+}
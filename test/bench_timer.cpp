@@ -0,0 +1,91 @@
+// 定时器对比：TimeWheel vs 原来的HeapTimer，10k/100k/1M个定时器。
+//   add   ：每个连接注册一个超时
+//   adjust：每次读写事件刷新一次超时（随机顺序，模拟keep-alive连接各自活跃）
+//   expire：全部到期后一次tick处理完
+// 结果是每个操作的平均纳秒数。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. bench_timer.cpp ../time/heaptimer.cpp ../time/timewheel.cpp
+//       ../time/cachedclock.cpp ../log/log.cpp ../buffer/*.cpp -o bench_timer -lpthread
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "../time/heaptimer.h"
+#include "../time/timewheel.h"
+
+using namespace std;
+
+static const int TIMEOUT_MS = 60000;
+static const int EXPIRE_MS = 50;
+
+struct Result {
+    double add;
+    double adjust;
+    double expire;
+};
+
+static double NsPerOp(chrono::steady_clock::time_point t0, size_t ops) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / ops;
+}
+
+// 轮子读CachedClock，堆每次调用都取一次系统时间；这里保证两者看到的时间同样在前进
+template<typename Timer>
+static Result Run(Timer& timer, const vector<int>& order) {
+    size_t n = order.size();
+    long fired = 0;
+    Result r;
+    CachedClock::Instance()->Update();
+
+    auto t0 = chrono::steady_clock::now();
+    for(size_t i = 0; i < n; i++) {
+        timer.add(static_cast<int>(i), TIMEOUT_MS + static_cast<int>(i % 1000), [&fired] { fired++; });
+    }
+    r.add = NsPerOp(t0, n);
+
+    usleep(2000);
+    CachedClock::Instance()->Update();
+    t0 = chrono::steady_clock::now();
+    for(int id : order) {
+        timer.adjust(id, TIMEOUT_MS);
+    }
+    r.adjust = NsPerOp(t0, n);
+
+    // 全部改成很快到期，等它们过期后由一次tick处理
+    for(int id : order) {
+        timer.adjust(id, 1 + id % EXPIRE_MS);
+    }
+    usleep((EXPIRE_MS + 20) * 1000);
+    CachedClock::Instance()->Update();
+    t0 = chrono::steady_clock::now();
+    timer.tick();
+    r.expire = NsPerOp(t0, n);
+    if(fired != static_cast<long>(n)) {
+        fprintf(stderr, "expired %ld of %zu timers\n", fired, n);
+    }
+    return r;
+}
+
+int main() {
+    printf("%8s | %12s %12s %12s | %12s %12s %12s   (ns/op)\n", "timers",
+           "heap add", "heap adjust", "heap expire", "wheel add", "wheel adjust", "wheel expire");
+    for(int n : {10000, 100000, 1000000}) {
+        vector<int> order(n);
+        for(int i = 0; i < n; i++) order[i] = i;
+        shuffle(order.begin(), order.end(), mt19937(n));
+
+        Result heap, wheel;
+        {
+            HeapTimer timer;
+            heap = Run(timer, order);
+        }
+        {
+            TimeWheel timer(n);
+            wheel = Run(timer, order);
+        }
+        printf("%8d | %12.1f %12.1f %12.1f | %12.1f %12.1f %12.1f\n", n,
+               heap.add, heap.adjust, heap.expire, wheel.add, wheel.adjust, wheel.expire);
+    }
+    return 0;
+}
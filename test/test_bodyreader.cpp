@@ -0,0 +1,195 @@
+// 请求体分帧（BodyReader）和默认存储（BodyStore），数据按各种长度切片逐段到达：
+//   1. chunked：大小行、扩展、分隔CRLF、trailer在任意位置被切开；裸LF行尾；解码后的正文一致
+//   2. chunk大小溢出、非十六进制、空大小行、缺少数据后的CRLF、过长的扩展和trailer：400
+//   3. Content-Length分帧，后面流水线里的下一个请求留在读缓冲区，照常解析
+//   4. Transfer-Encoding和Content-Length同时出现、不支持的Transfer-Encoding、非法Content-Length：400
+//   5. 超过maxBody：Content-Length在请求头结束时直接413，chunked在累计超过时413
+//   6. 超过SPILL_SIZE的请求体转存到临时文件，内容一致；刚好不到阈值的留在内存
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_bodyreader.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o test_bodyreader -lpthread -lz -lmysqlclient
+#include <stdint.h>
+#include "testclient.h"
+#include "../http/httprequest.h"
+
+using namespace std;
+
+static const size_t RANDOM = 0;
+static const size_t WHOLE = SIZE_MAX;
+static const size_t SLICES[] = {1, 2, 3, 7, 64, 1000, RANDOM, WHOLE};
+
+struct Result {
+    bool ok = true;
+    int code = 0;
+};
+
+// 每次追加slice字节（RANDOM时1~64随机）后parse一次，模拟数据分多次ReadFd到达；
+// 请求完成后剩下的数据一次追加，留给下一个请求
+static Result Run(HttpRequest& req, Buffer& buff, const string& data, size_t slice) {
+    Result res;
+    unsigned seed = 12345;
+    size_t pos = 0;
+    while(pos < data.size()) {
+        size_t n = slice == RANDOM ? 1 + rand_r(&seed) % 64 : min(slice, data.size() - pos);
+        n = min(n, data.size() - pos);
+        buff.Append(data.data() + pos, n);
+        pos += n;
+        if(!req.parse(buff)) {
+            res.ok = false;
+            res.code = req.ErrorCode();
+            return res;
+        }
+        if(req.IsFinish()) break;
+    }
+    buff.Append(data.data() + pos, data.size() - pos);
+    return res;
+}
+
+static string BodyOf(const HttpRequest& req) {
+    const BodyStore& body = req.Body();
+    if(!body.Spilled()) return string(body.Data());
+    string s(body.Size(), '\0');
+    CHECK(pread(body.Fd(), &s[0], s.size(), 0) == static_cast<ssize_t>(s.size()));
+    return s;
+}
+
+static string Post(const string& headers, const string& body) {
+    return "POST /upload HTTP/1.1\r\nHost: t\r\n" + headers + "\r\n" + body;
+}
+
+static string Chunked(const string& body) {
+    return Post("Transfer-Encoding: chunked\r\n", body);
+}
+
+// 完整解析一个带请求体的请求，核对正文，并确认后面的请求照常解析
+static void Expect(const string& data, const string& body, bool spilled = false) {
+    const string next = "GET /next HTTP/1.1\r\nHost: t\r\n\r\n";
+    for(size_t slice : SLICES) {
+        HttpRequest req;
+        Buffer buff;
+        Result res = Run(req, buff, data + next, slice);
+        CHECK(res.ok && req.IsFinish());
+        CHECK(req.Body().Size() == body.size());
+        CHECK(req.Body().Spilled() == spilled);
+        CHECK(BodyOf(req) == body);
+        buff.Retrieve(req.Consumed());
+        CHECK(string(buff.Peek(), buff.ReadableBytes()) == next);
+
+        req.Init();
+        CHECK(req.parse(buff) && req.IsFinish());
+        CHECK(req.path() == "/next" && req.Body().Size() == 0);
+    }
+}
+
+static void ExpectError(const string& data, int code) {
+    for(size_t slice : SLICES) {
+        HttpRequest req;
+        Buffer buff;
+        Result res = Run(req, buff, data, slice);
+        CHECK(!res.ok && res.code == code);
+    }
+}
+
+static void TestChunked() {
+    string alpha = "abcdefghijklmnopqrstuvwxyz";
+    string body = "hello" + alpha + "!";
+    Expect(Chunked("5\r\nhello\r\n1a\r\n" + alpha + "\r\n1\r\n!\r\n0\r\n\r\n"), body);
+    // 扩展和trailer
+    Expect(Chunked("5;name=value\r\nhello\r\n1A ; a=b;c\r\n" + alpha + "\r\n1\t;x\r\n!\r\n"
+                   "0;last\r\nX-Checksum: 123\r\nX-Other: a\r\n\r\n"), body);
+    // 裸LF行尾
+    Expect(Chunked("5\nhello\n1a\n" + alpha + "\n1\n!\n0\n\n"), body);
+    // 大小有前导零，只有结尾块
+    Expect(Chunked("0005\r\nhello\r\n0\r\n\r\n"), "hello");
+    Expect(Chunked("0\r\n\r\n"), "");
+
+    ExpectError(Chunked("FFFFFFFFFFFFFFFFF\r\n"), 400);             // 17位十六进制，溢出
+    ExpectError(Chunked("10000000000000000\r\n"), 400);
+    ExpectError(Chunked("5x\r\nhello\r\n0\r\n\r\n"), 400);
+    ExpectError(Chunked("\r\nhello\r\n0\r\n\r\n"), 400);            // 空大小行
+    ExpectError(Chunked(";ext\r\nhello\r\n0\r\n\r\n"), 400);
+    ExpectError(Chunked("5\rhello\r\n0\r\n\r\n"), 400);              // CR后面不是LF
+    ExpectError(Chunked("5\r\nhelloX\r\n0\r\n\r\n"), 400);           // 数据后面没有CRLF
+    ExpectError(Chunked("5\r\nhello\rX0\r\n\r\n"), 400);
+    ExpectError(Chunked("5;" + string(BodyReader::MAX_CHUNK_LINE, 'e') + "\r\nhello\r\n0\r\n\r\n"), 400);
+    ExpectError(Chunked("0\r\nX: " + string(BodyReader::MAX_TRAILER, 't') + "\r\n\r\n"), 400);
+}
+
+static void TestLength() {
+    Expect(Post("Content-Length: 11\r\n", "hello world"), "hello world");
+    Expect(Post("Content-Length: 1\r\n", "\n"), "\n");
+    // 请求体里出现的CRLF和请求行不影响分帧
+    string inner = "GET /fake HTTP/1.1\r\n\r\n";
+    Expect(Post("Content-Length: " + to_string(inner.size()) + "\r\n", inner), inner);
+
+    // 没有请求体：不进入BODY状态
+    HttpRequest req;
+    Buffer buff;
+    CHECK(Run(req, buff, Post("Content-Length: 0\r\n", ""), 1).ok && req.IsFinish());
+
+    ExpectError(Post("Transfer-Encoding: chunked\r\nContent-Length: 5\r\n", "0\r\n\r\n"), 400);
+    ExpectError(Post("Content-Length: 5\r\nTransfer-Encoding: chunked\r\n", "hello"), 400);
+    ExpectError(Post("Transfer-Encoding: gzip, chunked\r\n", "0\r\n\r\n"), 400);
+    ExpectError(Post("Transfer-Encoding: identity\r\n", ""), 400);
+    ExpectError(Post("Content-Length: 5a\r\n", "hello"), 400);
+    ExpectError(Post("Content-Length: -1\r\n", "hello"), 400);
+    ExpectError(Post("Content-Length: 1 1\r\n", "hello"), 400);
+}
+
+static void TestLimit() {
+    size_t saved = HttpRequest::maxBody;
+    HttpRequest::maxBody = 1000;
+    Expect(Post("Content-Length: 1000\r\n", string(1000, 'x')), string(1000, 'x'));
+    // Content-Length：请求头一结束就拒绝，不等请求体
+    for(size_t slice : SLICES) {
+        HttpRequest req;
+        Buffer buff;
+        Result res = Run(req, buff, Post("Content-Length: 1001\r\n", ""), slice);
+        CHECK(!res.ok && res.code == 413);
+    }
+    ExpectError(Post("Content-Length: 99999999999999999999999999\r\n", ""), 413);   // 位数再多也不溢出
+    // chunked：单个块超过，或者累计超过
+    ExpectError(Chunked("3E9\r\n"), 413);
+    string chunk = "1F4\r\n" + string(500, 'y') + "\r\n";
+    Expect(Chunked(chunk + chunk + "0\r\n\r\n"), string(1000, 'y'));
+    ExpectError(Chunked(chunk + chunk + "1\r\nz\r\n0\r\n\r\n"), 413);
+    HttpRequest::maxBody = saved;
+}
+
+static void TestSpill() {
+    string big(BodyStore::SPILL_SIZE * 3 + 12345, 0);
+    for(size_t i = 0; i < big.size(); i++) big[i] = static_cast<char>(i * 31 + (i >> 9));
+    Expect(Post("Content-Length: " + to_string(big.size()) + "\r\n", big), big, true);
+
+    // chunked，每块8KB，块边界和转存阈值错开
+    string data;
+    for(size_t off = 0; off < big.size(); off += 8000) {
+        size_t len = min<size_t>(8000, big.size() - off);
+        char size[16];
+        snprintf(size, sizeof(size), "%zx\r\n", len);
+        data += size + big.substr(off, len) + "\r\n";
+    }
+    Expect(Chunked(data + "0\r\n\r\n"), big, true);
+
+    // 刚好不到阈值：留在内存
+    string small = big.substr(0, BodyStore::SPILL_SIZE - 1);
+    Expect(Post("Content-Length: " + to_string(small.size()) + "\r\n", small), small, false);
+
+    // BodyStore单独使用：Clear之后回到内存状态
+    BodyStore store;
+    CHECK(store.OnData(big.data(), BodyStore::SPILL_SIZE) && store.Spilled());
+    CHECK(store.OnData(big.data() + BodyStore::SPILL_SIZE, 10) && store.OnEnd());
+    CHECK(store.Size() == BodyStore::SPILL_SIZE + 10);
+    store.Clear();
+    CHECK(!store.Spilled() && store.Size() == 0 && store.Data().empty());
+    CHECK(store.OnData("abc", 3) && store.OnEnd() && store.Data() == "abc");
+}
+
+int main() {
+    TestChunked();
+    TestLength();
+    TestLimit();
+    TestSpill();
+    printf("test_bodyreader: ok\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+// HttpResponse::CacheHit：事件循环线程据此判断能否直接生成响应，返回true时MakeResponse不能访问磁盘。
+//   1. 普通文件：在缓存中且内容在内存里才命中
+//   2. 出错（请求错误、文件不存在/无权限）时要用的错误页不在缓存里时不命中，交给工作线程；
+//      错误页加载过（或确认不存在）之后命中
+//   3. 处理函数直接给出正文时总是命中
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_cachehit.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o test_cachehit -lpthread -lz -lmysqlclient
+#include "testclient.h"
+#include "../http/httpresponse.h"
+
+using namespace std;
+
+static string srcDir_;
+
+// 按请求生成一个响应，返回CacheHit的结果
+static bool Hit(const string& reqPath, int code = -1) {
+    HttpResponse resp;
+    string path = reqPath;
+    resp.Init(srcDir_.c_str(), path, true, code);
+    return resp.CacheHit();
+}
+
+static string Make(const string& reqPath, int code = -1, int* outCode = nullptr) {
+    HttpResponse resp;
+    string path = reqPath;
+    resp.Init(srcDir_.c_str(), path, true, code);
+    Buffer buff;
+    resp.MakeResponse(buff);
+    if(outCode) *outCode = resp.Code();
+    // 头部和内置错误正文在缓冲区里，文件（错误页）的内容在缓存条目里
+    string text(buff.Peek(), buff.ReadableBytes());
+    FileCache::FilePtr file = resp.DetachFile();
+    if(file && file->Ok()) {
+        text += file->blob ? string(file->blob, file->blobLen) : string(file->addr, file->size);
+    }
+    return text;
+}
+
+int main() {
+    string root = TestMakeRoot();
+    srcDir_ = root + "/resources/";
+    TestWriteFile(srcDir_ + "a.txt", "hello");
+    TestWriteFile(srcDir_ + "secret.txt", "secret");
+    CHECK(chmod((srcDir_ + "secret.txt").c_str(), 0600) == 0);
+    TestWriteFile(srcDir_ + "400.html", "bad request page");
+    TestWriteFile(srcDir_ + "403.html", "forbidden page");
+    TestWriteFile(srcDir_ + "404.html", "not found page");
+    FileCache* cache = FileCache::Instance();
+    cache->Init(srcDir_);
+
+    // 普通文件
+    CHECK(!Hit("/a.txt"));
+    Make("/a.txt");
+    CHECK(Hit("/a.txt"));
+
+    // 文件不存在：不存在这件事已经缓存，但404页还没加载
+    cache->Get("/missing.html");
+    CHECK(!Hit("/missing.html"));
+    int code = 0;
+    CHECK(Make("/missing.html", -1, &code).find("not found page") != string::npos && code == 404);
+    CHECK(Hit("/missing.html"));
+    // 404页已在缓存里，另一个路径还要等确认不存在
+    CHECK(!Hit("/other-missing.html"));
+    cache->Get("/other-missing.html");
+    CHECK(Hit("/other-missing.html"));
+
+    // 无权限：用403页
+    cache->Get("/secret.txt");
+    CHECK(!Hit("/secret.txt"));
+    CHECK(Make("/secret.txt", -1, &code).find("forbidden page") != string::npos && code == 403);
+    CHECK(Hit("/secret.txt"));
+
+    // 请求错误：400页没有加载过
+    CHECK(!Hit("/a.txt", 400));
+    CHECK(Make("/a.txt", 400, &code).find("bad request page") != string::npos && code == 400);
+    CHECK(Hit("/a.txt", 400));
+
+    // 405页文件不存在：确认不存在之后用内置的错误正文
+    CHECK(!Hit("/a.txt", 405));
+    CHECK(Make("/a.txt", 405, &code).find("TinyWebServer") != string::npos && code == 405);
+    CHECK(Hit("/a.txt", 405));
+
+    // 没有对应错误页的状态码
+    CHECK(Hit("/a.txt", 416));
+
+    // 处理函数给出的正文
+    HttpResponse resp;
+    string path = "/never-loaded.txt";
+    resp.Init(srcDir_.c_str(), path, true, -1);
+    resp.SetContent("text/plain", "generated");
+    CHECK(resp.CacheHit());
+
+    cache->Close();
+    printf("test_cachehit: ok\n");
+    return 0;
+}
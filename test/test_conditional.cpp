@@ -0,0 +1,125 @@
+// 条件请求：
+//   1. If-None-Match命中（原样、W/前缀、列表中的一项、*）回304：只有头部，没有Content-length和正文，
+//      和后面流水线里的请求一起发出时，下一个响应照常解析
+//   2. If-None-Match不匹配时回200，即使If-Modified-Since满足（If-None-Match优先）
+//   3. If-Modified-Since等于Last-Modified或晚于文件修改时间时回304，早于或无法解析时回200
+//   4. 压缩变体有自己的ETag，304带Vary: Accept-Encoding
+//   5. 文件改动后旧ETag不再命中
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_conditional.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o test_conditional -lpthread -lz -lmysqlclient
+#include <thread>
+#include <time.h>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18371;
+
+static string Req(const string& path, const string& extra, const char* method = "GET") {
+    return string(method) + " " + path + " HTTP/1.1\r\nHost: t\r\nConnection: keep-alive\r\n" + extra + "\r\n";
+}
+
+static string Line(const char* name, const string& value) {
+    return string(name) + ": " + value + "\r\n";
+}
+
+// 条件请求和一个普通请求一起发出：304后面紧跟着下一个响应，中间没有正文
+static TestResponse Conditional(int fd, const string& path, const string& extra, const string& body) {
+    string pending;
+    vector<TestResponse> resps;
+    CHECK(TestSend(fd, Req(path, extra) + Req(path, "")));
+    CHECK(TestRecv(fd, pending, resps, 2));
+    CHECK(pending.empty());
+    CHECK(resps[1].code == 200 && resps[1].body == body);
+    return resps[0];
+}
+
+static void CheckNotModified(const TestResponse& r, const string& etag, const string& lastModified) {
+    CHECK(r.code == 304);
+    CHECK(r.body.empty());
+    CHECK(TestHeader(r, "Content-length").empty() && TestHeader(r, "Content-type").empty());
+    CHECK(TestHeader(r, "ETag") == etag);
+    CHECK(TestHeader(r, "Last-Modified") == lastModified);
+}
+
+static string HttpDate(time_t t) {
+    char buf[64];
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return string(buf, strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm));
+}
+
+int main() {
+    string root = TestMakeRoot();
+    string res = root + "/resources/";
+    string body(3000, 'c');
+    TestWriteFile(res + "a.html", body);
+    time_t mtime = time(nullptr) - 1000;
+    struct timeval tv[2] = {{mtime, 0}, {mtime, 0}};
+    CHECK(utimes((res + "a.html").c_str(), tv) == 0);
+    CHECK(chdir(root.c_str()) == 0);
+
+    WebServer* server = new WebServer(PORT, 3, 60000, false,
+                                      3306, "root", "root", "webserver",
+                                      1, 2, false, 1, 0);
+    thread([server] { server->Start(); }).detach();
+    int fd = TestConnect(PORT);
+    CHECK(fd >= 0);
+
+    TestResponse first = TestGet(fd, Req("/a.html", ""));
+    CHECK(first.code == 200 && first.body == body);
+    string etag = TestHeader(first, "ETag");
+    string lm = TestHeader(first, "Last-Modified");
+    CHECK(etag.size() > 2 && etag[0] == '"' && lm == HttpDate(mtime));
+
+    // 多轮：首次加载之后是缓存命中，再之后进小文件层
+    for(int round = 0; round < 4; round++) {
+        CheckNotModified(Conditional(fd, "/a.html", Line("If-None-Match", etag), body), etag, lm);
+        CheckNotModified(Conditional(fd, "/a.html", Line("If-None-Match", "W/" + etag), body), etag, lm);
+        CheckNotModified(Conditional(fd, "/a.html", Line("If-None-Match", "\"x\", " + etag + " ,\"y\""), body),
+                         etag, lm);
+        CheckNotModified(Conditional(fd, "/a.html", Line("If-None-Match", "*"), body), etag, lm);
+        TestResponse head = TestGet(fd, Req("/a.html", Line("If-None-Match", etag), "HEAD"), true);
+        CheckNotModified(head, etag, lm);
+
+        TestResponse r = Conditional(fd, "/a.html", Line("If-None-Match", "\"stale\""), body);
+        CHECK(r.code == 200 && r.body == body);
+        r = Conditional(fd, "/a.html", Line("If-None-Match", "\"stale\"") + Line("If-Modified-Since", lm), body);
+        CHECK(r.code == 200 && r.body == body);
+
+        CheckNotModified(Conditional(fd, "/a.html", Line("If-Modified-Since", lm), body), etag, lm);
+        CheckNotModified(Conditional(fd, "/a.html", Line("If-Modified-Since", HttpDate(mtime + 500)), body),
+                         etag, lm);
+        r = Conditional(fd, "/a.html", Line("If-Modified-Since", HttpDate(mtime - 500)), body);
+        CHECK(r.code == 200 && r.body == body);
+        r = Conditional(fd, "/a.html", Line("If-Modified-Since", "yesterday"), body);
+        CHECK(r.code == 200 && r.body == body);
+    }
+
+    // 压缩变体：ETag和原文件不同，互不命中
+    string gzReq = Line("Accept-Encoding", "gzip");
+    TestResponse gz = TestGet(fd, Req("/a.html", gzReq));
+    CHECK(gz.code == 200 && TestHeader(gz, "Content-Encoding") == "gzip");
+    string gzEtag = TestHeader(gz, "ETag");
+    CHECK(!gzEtag.empty() && gzEtag != etag);
+    TestResponse r = TestGet(fd, Req("/a.html", gzReq + Line("If-None-Match", gzEtag)));
+    CheckNotModified(r, gzEtag, lm);
+    CHECK(TestHeader(r, "Vary") == "Accept-Encoding");
+    r = TestGet(fd, Req("/a.html", gzReq + Line("If-None-Match", etag)));
+    CHECK(r.code == 200 && r.body == gz.body);
+
+    // 文件改动后（inotify使缓存失效）旧ETag不再命中
+    string changed(3000, 'd');
+    TestWriteFile(res + "a.html", changed);
+    usleep(200000);
+    r = TestGet(fd, Req("/a.html", Line("If-None-Match", etag)));
+    CHECK(r.code == 200 && r.body == changed && TestHeader(r, "ETag") != etag);
+
+    close(fd);
+    printf("test_conditional: ok\n");
+    fflush(stdout);
+    _exit(0);   // 服务器线程没有退出接口，直接结束进程
+}
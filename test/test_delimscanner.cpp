@@ -0,0 +1,149 @@
+// DelimScanner的随机等价测试：FindSSE2/FindAVX2与FindScalar对同一输入必须返回同一位置。
+//   随机缓冲区（命中稀疏、密集、全是高位字节几种分布），set大小1~4（含重复字符和'\0'），
+//   枚举所有起止偏移，覆盖比16/32字节短的尾部和非对齐起点；
+//   另把数据放在一页的末尾、后面紧跟不可访问的保护页，越界读会直接崩溃。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_delimscanner.cpp ../http/delimscanner.cpp -o test_delimscanner
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <random>
+#include "../http/delimscanner.h"
+
+using namespace std;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); exit(1); } \
+} while(0)
+
+typedef const char* (*FindFunc)(const char*, const char*, const char*, int);
+
+static long checks = 0;
+
+static void Compare(FindFunc impl, const char* name, const char* begin, const char* end,
+                    const char* set, int n) {
+    const char* want = DelimScanner::FindScalar(begin, end, set, n);
+    const char* got = impl(begin, end, set, n);
+    if(got != want) {
+        fprintf(stderr, "%s: len=%ld n=%d set=%02x %02x %02x %02x: got %ld want %ld\n", name,
+                (long)(end - begin), n, (unsigned char)set[0], (unsigned char)set[1],
+                (unsigned char)set[2], (unsigned char)set[3],
+                (long)(got - begin), (long)(want - begin));
+        exit(1);
+    }
+    checks++;
+}
+
+static void CompareAll(const char* begin, const char* end, const char* set, int n) {
+    Compare(&DelimScanner::FindSSE2, "sse2", begin, end, set, n);
+    if(__builtin_cpu_supports("avx2")) {
+        Compare(&DelimScanner::FindAVX2, "avx2", begin, end, set, n);
+    }
+    Compare(&DelimScanner::Find, "dispatch", begin, end, set, n);
+}
+
+// density：每个字节属于set的概率（千分之几）
+static void FillRandom(mt19937& rng, char* buf, size_t len, const char* set, int n, int density) {
+    for(size_t i = 0; i < len; i++) {
+        if(static_cast<int>(rng() % 1000) < density) {
+            buf[i] = set[rng() % n];
+        } else {
+            buf[i] = static_cast<char>(rng() & 0xff);
+        }
+    }
+}
+
+static void RandomSet(mt19937& rng, char* set, int n) {
+    static const char COMMON[] = "\r\n:=&+% ";
+    for(int i = 0; i < 4; i++) {
+        switch(rng() % 4) {
+        case 0: set[i] = COMMON[rng() % (sizeof(COMMON) - 1)]; break;
+        case 1: set[i] = static_cast<char>(0x80 | (rng() & 0x7f)); break;    // 高位字节，检查符号扩展
+        case 2: set[i] = '\0'; break;
+        default: set[i] = static_cast<char>(rng() & 0xff); break;
+        }
+    }
+    if(n >= 2 && rng() % 4 == 0) set[1] = set[0];     // 重复字符
+}
+
+// 短缓冲区：枚举全部[begin,end)组合
+static void TestAllOffsets(mt19937& rng) {
+    const int LEN = 96;
+    alignas(64) char buf[LEN + 64];
+    for(int round = 0; round < 200; round++) {
+        for(int n = 1; n <= 4; n++) {
+            char set[4];
+            RandomSet(rng, set, n);
+            int density = (round % 4 == 0) ? 0 : (round % 4 == 1) ? 5 : (round % 4 == 2) ? 50 : 300;
+            int shift = round % 64;     // 相对64字节对齐的起点
+            char* data = buf + shift;
+            FillRandom(rng, data, LEN, set, n, density);
+            for(int b = 0; b <= LEN; b++) {
+                for(int e = b; e <= LEN; e++) {
+                    CompareAll(data + b, data + e, set, n);
+                }
+            }
+        }
+    }
+}
+
+// 长缓冲区：命中点落在各个16/32字节块的不同位置
+static void TestLongBuffers(mt19937& rng) {
+    const int LEN = 4096;
+    char* buf = static_cast<char*>(malloc(LEN + 64));
+    for(int round = 0; round < 2000; round++) {
+        int n = 1 + round % 4;
+        char set[4];
+        RandomSet(rng, set, n);
+        char* data = buf + rng() % 64;
+        size_t len = rng() % LEN;
+        FillRandom(rng, data, len, set, n, 0);
+        // 先去掉偶然命中的字节，再只放一个命中点
+        for(size_t i = 0; i < len; i++) {
+            for(int k = 0; k < n; k++) {
+                if(data[i] == set[k]) data[i] = static_cast<char>(set[0] ^ 0x55 ^ set[n - 1] ^ 0xaa);
+            }
+        }
+        if(len > 0 && round % 3) data[rng() % len] = set[rng() % n];
+        size_t b = len ? rng() % (len + 1) : 0;
+        CompareAll(data + b, data + len, set, n);
+        CompareAll(data, data + len, set, n);
+    }
+    free(buf);
+}
+
+// 数据紧贴保护页：任何实现读过end都会触发SIGSEGV
+static void TestGuardPage(mt19937& rng) {
+    long page = sysconf(_SC_PAGESIZE);
+    char* mem = static_cast<char*>(mmap(nullptr, page * 2, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    CHECK(mem != MAP_FAILED);
+    CHECK(mprotect(mem + page, page, PROT_NONE) == 0);
+    char* end = mem + page;
+    for(int len = 0; len <= 80; len++) {
+        for(int n = 1; n <= 4; n++) {
+            char set[4] = {'\r', '\n', ':', '='};
+            FillRandom(rng, end - len, len, set, n, 0);
+            for(int i = 0; i < len; i++) {
+                for(int k = 0; k < n; k++) {
+                    if(end[i - len] == set[k]) end[i - len] = 'x';
+                }
+            }
+            CompareAll(end - len, end, set, n);
+        }
+    }
+    munmap(mem, page * 2);
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20240601;
+    mt19937 rng(seed);
+    __builtin_cpu_init();
+    TestAllOffsets(rng);
+    TestLongBuffers(rng);
+    TestGuardPage(rng);
+    printf("test_delimscanner: ok (%s, seed %u, %ld comparisons)\n", DelimScanner::ImplName(), seed, checks);
+    return 0;
+}
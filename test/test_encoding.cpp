@@ -0,0 +1,119 @@
+// 按Accept-Encoding选压缩变体：
+//   1. 有.br和.gz兄弟文件时br优先，只接受gzip时发.gz；带Content-Encoding和Vary: Accept-Encoding，不带Accept-Ranges
+//   2. 不带Accept-Encoding时发原文件，有变体时仍带Vary
+//   3. 没有.gz兄弟文件的文本在内存里压缩一份，解压后与原文一致
+//   4. 兄弟文件缺失或比原文件旧（过期）时回退到原文件
+//   5. 太小的文件不压缩，没有Vary
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_encoding.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o test_encoding -lpthread -lz -lmysqlclient
+#include <thread>
+#include <time.h>
+#include <zlib.h>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18370;
+
+static string Req(const string& path, const string& encoding) {
+    string req = "GET " + path + " HTTP/1.1\r\nHost: t\r\nConnection: keep-alive\r\n";
+    if(!encoding.empty()) req += "Accept-Encoding: " + encoding + "\r\n";
+    return req + "\r\n";
+}
+
+static string Text(size_t len) {
+    string s;
+    while(s.size() < len) s += "line " + to_string(s.size() % 97) + " of a compressible text file\n";
+    return s.substr(0, len);
+}
+
+static string Gunzip(const string& data) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    CHECK(inflateInit2(&zs, 15 + 16) == Z_OK);
+    string out(1 << 20, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = data.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    CHECK(inflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+    return out;
+}
+
+// 原文件，没有Content-Encoding
+static void CheckIdentity(const TestResponse& r, const string& body, bool vary) {
+    CHECK(r.code == 200 && r.body == body);
+    CHECK(TestHeader(r, "Content-Encoding").empty());
+    CHECK(TestHeader(r, "Accept-Ranges") == "bytes");
+    CHECK(TestHeader(r, "Vary") == (vary ? "Accept-Encoding" : ""));
+}
+
+static void CheckEncoded(const TestResponse& r, const char* encoding) {
+    CHECK(r.code == 200);
+    CHECK(TestHeader(r, "Content-Encoding") == encoding);
+    CHECK(TestHeader(r, "Vary") == "Accept-Encoding");
+    CHECK(TestHeader(r, "Accept-Ranges").empty());
+}
+
+int main() {
+    string root = TestMakeRoot();
+    string res = root + "/resources/";
+    string page = Text(8000), style = Text(6000), script = Text(5000), tiny = Text(100);
+    string br = "fake brotli data", gz = "fake gzip data";
+    TestWriteFile(res + "page.html", page);
+    TestWriteFile(res + "page.html.br", br);
+    TestWriteFile(res + "page.html.gz", gz);
+    TestWriteFile(res + "style.css", style);
+    TestWriteFile(res + "app.js", script);
+    TestWriteFile(res + "app.js.br", br);
+    TestWriteFile(res + "tiny.txt", tiny);
+    // app.js.br比原文件旧：原文件改过之后没有重新压缩
+    struct timeval old[2] = {{time(nullptr) - 100, 0}, {time(nullptr) - 100, 0}};
+    CHECK(utimes((res + "app.js.br").c_str(), old) == 0);
+    CHECK(chdir(root.c_str()) == 0);
+
+    WebServer* server = new WebServer(PORT, 3, 60000, false,
+                                      3306, "root", "root", "webserver",
+                                      1, 2, false, 1, 0);
+    thread([server] { server->Start(); }).detach();
+    int fd = TestConnect(PORT);
+    CHECK(fd >= 0);
+
+    // 多轮请求，覆盖首次加载、缓存命中和小文件层
+    for(int round = 0; round < 4; round++) {
+        TestResponse r = TestGet(fd, Req("/page.html", "gzip, deflate, br"));
+        CheckEncoded(r, "br");
+        CHECK(r.body == br);
+        r = TestGet(fd, Req("/page.html", "gzip"));
+        CheckEncoded(r, "gzip");
+        CHECK(r.body == gz);
+        r = TestGet(fd, Req("/page.html", "br;q=0, gzip"));
+        CHECK(TestHeader(r, "Content-Encoding") == "gzip" && r.body == gz);
+        CheckIdentity(TestGet(fd, Req("/page.html", "")), page, true);
+        CheckIdentity(TestGet(fd, Req("/page.html", "identity")), page, true);
+
+        // 没有.gz兄弟文件：内存里压缩；没有.br时只接受br就回退到原文件
+        r = TestGet(fd, Req("/style.css", "gzip, br"));
+        CheckEncoded(r, "gzip");
+        CHECK(r.body.size() < style.size() && Gunzip(r.body) == style);
+        CheckIdentity(TestGet(fd, Req("/style.css", "br")), style, true);
+
+        // .br过期：不用它，只接受br时发原文件；接受gzip时用内存压缩的那份
+        CheckIdentity(TestGet(fd, Req("/app.js", "br")), script, true);
+        r = TestGet(fd, Req("/app.js", "br, gzip"));
+        CheckEncoded(r, "gzip");
+        CHECK(Gunzip(r.body) == script);
+
+        // 太小的文件不压缩
+        CheckIdentity(TestGet(fd, Req("/tiny.txt", "gzip, br")), tiny, false);
+    }
+    close(fd);
+    printf("test_encoding: ok\n");
+    fflush(stdout);
+    _exit(0);   // 服务器线程没有退出接口，直接结束进程
+}
@@ -0,0 +1,147 @@
+// 文件缓存的小文件层：
+//   1. 命中admitHits次后进入小文件层：header+正文连续存放在blob里，内容与文件一致
+//   2. 小文件层的内存块总量不超过smallBudget，超出后不再接纳，文件照常从映射提供
+//   3. 每片按预算从LRU表尾淘汰；淘汰/清空后不再被引用的内存块整块归还
+//   4. 文件被截断、inotify还没来得及使缓存失效时进入小文件层：不能从共享映射里读（会SIGBUS），
+//      读到的长度不对时放弃接纳
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_filecache.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o test_filecache -lpthread -lz -lmysqlclient
+#include <signal.h>
+#include <sys/wait.h>
+#include "testclient.h"
+#include "../http/filecache.h"
+
+using namespace std;
+
+static const size_t KB = 1024;
+static const size_t CHUNK = 1 << 20;    // FileCache::ARENA_CHUNK
+
+static string Content(size_t len, int seed) {
+    string s(len, 0);
+    for(size_t i = 0; i < len; i++) s[i] = static_cast<char>('a' + (i * 7 + seed) % 26);
+    return s;
+}
+
+static string Name(int i) {
+    return "/f" + to_string(i) + ".bin";
+}
+
+static void TestAdmit(const string& srcDir) {
+    FileCache* cache = FileCache::Instance();
+    cache->Init(srcDir, 64 << 20, 32 * KB, 4 * CHUNK, 2);
+    FileCache::FilePtr f = cache->Get(Name(0));
+    CHECK(f->Ok() && !f->blob && f->addr);
+    CHECK(cache->Get(Name(0))->blob == nullptr);    // 第1次命中
+    f = cache->Get(Name(0));                        // 第2次命中，进入小文件层
+    CHECK(f->blob && f->fd < 0 && !f->addr);
+    CHECK(string(f->blob, f->blobLen) == f->header + Content(8 * KB, 0));
+    FileCache::Stats s = cache->GetStats();
+    CHECK(s.admitted == 1 && s.misses == 1 && s.hits == 2 && s.smallHits == 1);
+    CHECK(s.arenaBytes == CHUNK);
+
+    // 超过smallMax的文件不进小文件层
+    for(int i = 0; i < 4; i++) f = cache->Get("/big.bin");
+    CHECK(f->Ok() && !f->blob && f->addr);
+    cache->Close();
+}
+
+static void TestBudget(const string& srcDir) {
+    FileCache* cache = FileCache::Instance();
+    // 每个文件约8KB，一个内存块放得下约120个；预算只有一个块
+    cache->Init(srcDir, 64 << 20, 32 * KB, CHUNK, 1);
+    FileCache::Stats before = cache->GetStats();    // 计数跨Init累加
+    int admitted = 0;
+    for(int i = 0; i < 200; i++) {
+        cache->Get(Name(i));
+        FileCache::FilePtr f = cache->Get(Name(i));
+        CHECK(f->Ok());
+        if(f->blob) {
+            admitted++;
+            CHECK(string(f->blob + f->header.size(), f->size) == Content(8 * KB, i));
+        } else {
+            CHECK(f->addr && string(f->addr, f->size) == Content(8 * KB, i));
+        }
+    }
+    FileCache::Stats s = cache->GetStats();
+    CHECK(admitted > 100 && admitted < 200);
+    CHECK(s.admitted - before.admitted == static_cast<uint64_t>(admitted));
+    CHECK(s.arenaBytes == CHUNK);
+    cache->Close();
+}
+
+static void TestEvict(const string& srcDir) {
+    FileCache* cache = FileCache::Instance();
+    // 16片，每片预算64KB，最多放7个8KB的文件；全部进小文件层
+    cache->Init(srcDir, 16 * 64 * KB, 32 * KB, 16 * CHUNK, 1);
+    FileCache::Stats before = cache->GetStats();
+    for(int i = 0; i < 200; i++) {
+        cache->Get(Name(i));
+        CHECK(cache->Get(Name(i))->blob);
+    }
+    FileCache::Stats s = cache->GetStats();
+    CHECK(s.admitted - before.admitted == 200);
+    CHECK(s.arenaBytes >= 2 * CHUNK);   // 200个超过一个块
+
+    // 每片不超过预算；最近的留在缓存里，淘汰的主要是最早的
+    CHECK(cache->Find(Name(199)) != nullptr);
+    int cached = 0, oldCached = 0, newCached = 0;
+    for(int i = 0; i < 200; i++) {
+        if(!cache->Find(Name(i))) continue;
+        cached++;
+        if(i < 50) oldCached++;
+        if(i >= 150) newCached++;
+    }
+    CHECK(cached <= 16 * 7);
+    CHECK(oldCached < newCached);
+
+    // 只有当前追加的块还被引用，其余的块随条目释放而归还
+    FileCache::FilePtr keep = cache->Get(Name(199));
+    cache->Clear();
+    CHECK(cache->GetStats().arenaBytes == CHUNK);
+    CHECK(keep->blob && string(keep->blob + keep->header.size(), keep->size) == Content(8 * KB, 199));
+    cache->Close();
+}
+
+// 通过另一个目录里的硬链接截断文件：资源目录上的inotify收不到，缓存条目还在，映射已经越过文件末尾
+static void TestTruncated(const string& root) {
+    string srcDir = root + "/resources/";
+    string other = root + "/other";
+    mkdir(other.c_str(), 0755);
+    TestWriteFile(srcDir + "t.txt", Content(16 * KB, 1));
+    CHECK(link((srcDir + "t.txt").c_str(), (other + "/t.txt").c_str()) == 0);
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if(pid == 0) {
+        FileCache* cache = FileCache::Instance();
+        cache->Init(srcDir, 64 << 20, 32 * KB, 4 * CHUNK, 2);
+        FileCache::Stats before = cache->GetStats();
+        FileCache::FilePtr f = cache->Get("/t.txt");
+        CHECK(f->Ok() && f->addr && f->size == 16 * KB);
+        CHECK(!cache->Get("/t.txt")->blob);
+        CHECK(truncate((other + "/t.txt").c_str(), 100) == 0);
+        usleep(100000);
+        f = cache->Get("/t.txt");       // 第2次命中，尝试进入小文件层
+        CHECK(f->Ok() && !f->blob);
+        CHECK(cache->GetStats().admitted == before.admitted);
+        _exit(0);
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(!WIFSIGNALED(status));
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main() {
+    string root = TestMakeRoot();
+    string srcDir = root + "/resources/";
+    for(int i = 0; i < 200; i++) TestWriteFile(srcDir + Name(i).substr(1), Content(8 * KB, i));
+    TestWriteFile(srcDir + "big.bin", Content(64 * KB, 0));
+    TestAdmit(srcDir);
+    TestBudget(srcDir);
+    TestEvict(srcDir);
+    TestTruncated(root);
+    printf("test_filecache: ok\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+// multipart/form-data上传：
+//   1. 请求体在每个位置切成两片、以及按各种长度切片到达：分隔符跨片、分隔符前的CRLF跨片、
+//      内容里出现分隔符的前缀，解析出的字段和文件内容都一致；前导内容和结束分隔符之后的内容忽略
+//   2. 缺少结束分隔符的请求体不算完成，已写的文件删除
+//   3. 部分个数、单个文件、普通字段超过上限：中止并标记TooLarge，请求回413，已写的文件删除
+//   4. 请求完成后处理函数没有认领的文件在下一个请求开始时删除，认领的保留
+//   5. 只有标记了upload的路由接收上传；其他路径（包括404）上的multipart请求体按普通请求体处理，不落盘
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_multipart.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o test_multipart -lpthread -lz -lmysqlclient
+#include <stdint.h>
+#include <dirent.h>
+#include "testclient.h"
+#include "../http/httprequest.h"
+#include "../http/router.h"
+
+using namespace std;
+
+static const string BOUNDARY = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+static const string TYPE = "multipart/form-data; boundary=" + BOUNDARY;
+
+static string title_ = "hello\r\n--not-the-boundary\r\n-";
+static string note_ = "\r\n--" + BOUNDARY.substr(0, 10);
+static string file1_;
+static string file2_;
+
+static string Part(const string& disposition, const string& type, const string& data) {
+    string part = "--" + BOUNDARY + "\r\nContent-Disposition: form-data; " + disposition + "\r\n";
+    if(!type.empty()) part += "Content-Type: " + type + "\r\n";
+    return part + "\r\n" + data + "\r\n";
+}
+
+static string Body() {
+    return "preamble is ignored\r\n" +
+           Part("name=\"title\"", "", title_) +
+           Part("name=\"file1\"; filename=\"a.txt\"", "text/plain", file1_) +
+           Part("name=\"empty\"; filename=\"\"", "application/octet-stream", "") +
+           Part("name=\"note\"", "", note_) +
+           Part("name=\"file2\"; filename=\"../../b.bin\"", "application/octet-stream", file2_) +
+           "--" + BOUNDARY + "--\r\nepilogue is ignored\r\n--" + BOUNDARY + "\r\n";
+}
+
+static string ReadFile(const string& path) {
+    string data;
+    FILE* fp = fopen(path.c_str(), "rb");
+    CHECK(fp);
+    char buf[4096];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), fp)) > 0) data.append(buf, n);
+    fclose(fp);
+    return data;
+}
+
+static int CountFiles(const string& dir) {
+    int cnt = 0;
+    DIR* d = opendir(dir.c_str());
+    CHECK(d);
+    while(struct dirent* ent = readdir(d)) {
+        if(ent->d_name[0] != '.') cnt++;
+    }
+    closedir(d);
+    return cnt;
+}
+
+static void CheckParsed(const unordered_map<string, string>& fields, const vector<MultipartParser::File>& files) {
+    CHECK(fields.size() == 2);
+    CHECK(fields.at("title") == title_ && fields.at("note") == note_);
+    CHECK(files.size() == 2);
+    CHECK(files[0].name == "file1" && files[0].filename == "a.txt" && files[0].contentType == "text/plain");
+    CHECK(files[0].size == file1_.size() && ReadFile(files[0].path) == file1_);
+    CHECK(files[1].name == "file2" && files[1].filename == "../../b.bin");
+    CHECK(files[1].size == file2_.size() && ReadFile(files[1].path) == file2_);
+    CHECK(files[1].path.compare(0, MultipartParser::uploadDir.size(), MultipartParser::uploadDir) == 0);
+}
+
+// 请求体在每个位置切成两片
+static void TestSplit() {
+    string body = Body();
+    for(size_t k = 0; k <= body.size(); k++) {
+        MultipartParser parser;
+        CHECK(parser.Init(TYPE));
+        CHECK(parser.OnData(body.data(), k));
+        CHECK(parser.OnData(body.data() + k, body.size() - k));
+        CHECK(parser.OnEnd());
+        CheckParsed(parser.Fields(), parser.Files());
+        parser.Clear();
+        CHECK(CountFiles(MultipartParser::uploadDir) == 0);
+    }
+}
+
+// 按固定长度和随机长度切片
+static void TestSlices() {
+    string body = Body();
+    unsigned seed = 1;
+    for(size_t slice : {1, 2, 3, 5, 13, 41, 42, 43, 500, 0}) {
+        MultipartParser parser;
+        CHECK(parser.Init(TYPE));
+        for(size_t pos = 0; pos < body.size(); ) {
+            size_t n = min(slice ? slice : 1 + rand_r(&seed) % 100, body.size() - pos);
+            CHECK(parser.OnData(body.data() + pos, n));
+            pos += n;
+        }
+        CHECK(parser.OnEnd());
+        CheckParsed(parser.Fields(), parser.Files());
+    }
+    CHECK(CountFiles(MultipartParser::uploadDir) == 0);   // 析构时删除
+}
+
+static void TestTruncated() {
+    string body = Body();
+    size_t end = body.find("--" + BOUNDARY + "--");
+    for(size_t cut : {body.size() / 2, end, end + BOUNDARY.size() + 3}) {
+        MultipartParser parser;
+        CHECK(parser.Init(TYPE));
+        CHECK(parser.OnData(body.data(), cut));
+        CHECK(!parser.OnEnd() && !parser.TooLarge());
+        CHECK(parser.Files().empty());
+        CHECK(CountFiles(MultipartParser::uploadDir) == 0);
+    }
+    // 分隔符后面既不是CRLF也不是"--"
+    MultipartParser parser;
+    CHECK(parser.Init(TYPE));
+    string bad = "--" + BOUNDARY + "x\r\n";
+    CHECK(!parser.OnData(bad.data(), bad.size()) && !parser.TooLarge());
+    // boundary缺失或太长
+    CHECK(!parser.Init("multipart/form-data"));
+    CHECK(!parser.Init("multipart/form-data; boundary=" + string(MultipartParser::MAX_BOUNDARY + 1, 'b')));
+}
+
+static void TestLimits() {
+    size_t saved = MultipartParser::maxFileSize;
+    MultipartParser::maxFileSize = 1000;
+    string body = Body();
+    MultipartParser parser;
+    CHECK(parser.Init(TYPE));
+    CHECK(!parser.OnData(body.data(), body.size()) && parser.TooLarge());
+    CHECK(parser.Files().empty() && CountFiles(MultipartParser::uploadDir) == 0);
+    MultipartParser::maxFileSize = saved;
+
+    string many;
+    for(size_t i = 0; i <= MultipartParser::MAX_PARTS; i++) many += Part("name=\"f" + to_string(i) + "\"", "", "v");
+    many += "--" + BOUNDARY + "--\r\n";
+    CHECK(parser.Init(TYPE));
+    CHECK(!parser.OnData(many.data(), many.size()) && parser.TooLarge());
+
+    string field = Part("name=\"big\"", "", string(MultipartParser::MAX_FIELD + 1, 'v')) + "--" + BOUNDARY + "--\r\n";
+    CHECK(parser.Init(TYPE));
+    CHECK(!parser.OnData(field.data(), field.size()) && parser.TooLarge());
+}
+
+static string Request(const string& path, const string& body) {
+    return "POST " + path + " HTTP/1.1\r\nHost: t\r\nContent-Type: " + TYPE + "\r\nContent-Length: " +
+           to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// 按slice切片喂给HttpRequest，返回parse的结果
+static bool Parse(HttpRequest& req, const string& data, size_t slice) {
+    Buffer buff;
+    for(size_t pos = 0; pos < data.size(); pos += slice) {
+        buff.Append(data.data() + pos, min(slice, data.size() - pos));
+        if(!req.parse(buff)) return false;
+    }
+    return true;
+}
+
+static void TestRequest() {
+    const string& dir = MultipartParser::uploadDir;
+    string body = Body();
+    for(size_t slice : {1, 7, 100, 100000}) {
+        HttpRequest req;
+        CHECK(Parse(req, Request("/upload", body), slice) && req.IsFinish());
+        CHECK(req.Uploads().size() == 2 && req.GetPost("title") == title_);
+        CHECK(CountFiles(dir) == 2);
+        // 没有认领：下一个请求开始时删除
+        req.Init();
+        CHECK(CountFiles(dir) == 0);
+
+        CHECK(Parse(req, Request("/upload?x=1", body), slice) && req.IsFinish());
+        string kept = req.ClaimUpload(1);
+        req.Init();
+        CHECK(CountFiles(dir) == 1 && ReadFile(kept) == file2_);
+        unlink(kept.c_str());
+    }
+
+    // 超过上限：413，已写的文件删除
+    size_t saved = MultipartParser::maxFileSize;
+    MultipartParser::maxFileSize = 1000;
+    {
+        HttpRequest req;
+        CHECK(!Parse(req, Request("/upload", body), 64) && req.ErrorCode() == 413);
+        CHECK(CountFiles(dir) == 0);
+    }
+    MultipartParser::maxFileSize = saved;
+
+    // 中途断开：连接关闭时HttpRequest随之析构
+    {
+        HttpRequest req;
+        CHECK(Parse(req, Request("/upload", body).substr(0, 2000), 64) && !req.IsFinish());
+        CHECK(CountFiles(dir) == 1);
+    }
+    CHECK(CountFiles(dir) == 0);
+
+    // 没有标记upload的路由、没有路由的路径：请求体按普通请求体保存，不落盘
+    for(const char* path : {"/plain", "/missing", "/upload/x"}) {
+        HttpRequest req;
+        CHECK(Parse(req, Request(path, body), 100) && req.IsFinish());
+        CHECK(req.Uploads().empty() && req.Body().Size() == body.size());
+        CHECK(CountFiles(dir) == 0);
+    }
+    size_t savedBody = HttpRequest::maxBody;
+    HttpRequest::maxBody = 1000;
+    {
+        HttpRequest req;
+        CHECK(!Parse(req, Request("/plain", body), 100) && req.ErrorCode() == 413);
+    }
+    HttpRequest::maxBody = savedBody;
+}
+
+int main() {
+    string root = TestMakeRoot();
+    MultipartParser::uploadDir = root + "/upload";
+    CHECK(mkdir(MultipartParser::uploadDir.c_str(), 0700) == 0);
+    for(int i = 0; i < 3000; i++) file1_ += static_cast<char>(i * 7 + i / 256);
+    file1_ += "\r\n--" + BOUNDARY.substr(0, BOUNDARY.size() - 1) + "\r\n-\r";   // 分隔符的前缀
+    file2_ = string(500, '\r') + "\r\n--" + string(300, '-');
+
+    Router* router = Router::Instance();
+    auto noop = [](HttpRequest&, const RouteParams&, HttpResponse&) {};
+    CHECK(router->Add("POST", "/upload", noop, false, true));
+    CHECK(router->Add("POST", "/plain", noop));
+    router->Freeze();
+
+    TestSplit();
+    TestSlices();
+    TestTruncated();
+    TestLimits();
+    TestRequest();
+    printf("test_multipart: ok\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+// OutputQueue的段顺序：文本、内存、文件交替出现时（如multipart/byteranges，
+// 所有分隔行先一次写进文本缓冲区，正文区间再逐段入队），发出的字节必须和拼接顺序一致。
+// 另一端每次只读一点，Write部分发送后从断点继续。
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_outputqueue.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o test_outputqueue -lpthread -lz -lmysqlclient
+#include <thread>
+#include <fcntl.h>
+#include "testclient.h"
+#include "../http/outputqueue.h"
+
+using namespace std;
+
+int main() {
+    string root = TestMakeRoot();
+    string file(300000, 0);
+    for(size_t i = 0; i < file.size(); i++) file[i] = static_cast<char>(i * 7 + (i >> 10));
+    TestWriteFile(root + "/data.bin", file);
+    int fileFd = open((root + "/data.bin").c_str(), O_RDONLY);
+    CHECK(fileFd >= 0);
+
+    // 文本一次生成：head | part1 | part2 | tail，正文区间分别跟在part1、part2之后
+    OutputQueue out;
+    Buffer& text = out.Text();
+    text.Append(string("head\r\n"));
+    text.Append(string("--part1\r\n"));
+    size_t end1 = text.ReadableBytes();
+    text.Append(string("--part2\r\n"));
+    size_t end2 = text.ReadableBytes();
+    text.Append(string("--tail--\r\n"));
+    out.AddText(end1);
+    out.AddFile(fileFd, 1000, 150000);
+    out.AddText(end2);
+    out.AddMemory(file.data() + 200000, 50000);
+    out.AddText(text.ReadableBytes());
+    out.Seal();
+    string expect = "head\r\n--part1\r\n" + file.substr(1000, 150000) + "--part2\r\n" +
+                    file.substr(200000, 50000) + "--tail--\r\n";
+    CHECK(out.Bytes() == expect.size());
+    CHECK(out.SegmentCount() == 5);
+
+    int sv[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+    int small = 16384;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    string got;
+    thread reader([&] {
+        char buf[3000];
+        while(got.size() < expect.size()) {
+            ssize_t n = read(sv[1], buf, sizeof(buf));
+            CHECK(n > 0);
+            got.append(buf, n);
+            usleep(50);
+        }
+    });
+    int writes = 0;
+    while(out.Bytes() > 0) {
+        int err = 0;
+        ssize_t n = out.Write(sv[0], &err);
+        if(n < 0) {
+            CHECK(err == EAGAIN);
+            usleep(100);
+        }
+        writes++;
+    }
+    reader.join();
+    CHECK(writes > 5);      // 确实经过多次部分发送
+    CHECK(got == expect);
+
+    close(sv[0]);
+    close(sv[1]);
+    close(fileFd);
+    printf("test_outputqueue: ok\n");
+    return 0;
+}
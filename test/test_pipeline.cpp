@@ -0,0 +1,106 @@
+// HTTP/1.1流水线：一次write发出的请求超过HttpConn::MAX_PIPELINE(16)个时，
+// 超出的部分已经在读缓冲区里，不会再有EPOLLIN（ET模式），必须在写完上一轮后接着处理。
+//   1. 40个keep-alive请求一次发出，40个响应全部按序到达
+//   2. 最后一个请求带Connection: close，全部响应之后服务端关闭连接
+//   3. 第一个请求带Connection: close，只回一个响应就关闭，后面的请求不处理
+// 工作线程路径和循环线程快速路径(inlineFast)各跑一遍；Router是单例，每种模式在子进程里起一个服务器
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_pipeline.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o test_pipeline -lpthread -lz -lmysqlclient
+#include <thread>
+#include <sys/wait.h>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18320;
+
+static string Requests(int n, const string& path, int closeAt) {
+    string data;
+    for(int i = 0; i < n; i++) {
+        data += "GET " + path + " HTTP/1.1\r\nHost: t\r\n";
+        data += (i == closeAt) ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    }
+    return data;
+}
+
+// 读到对端关闭为止，确认没有多余的响应
+static bool PeerClosed(int fd, const string& pending) {
+    char buf[256];
+    return pending.empty() && recv(fd, buf, sizeof(buf), 0) == 0;
+}
+
+static void RunClient(int port, const string& body) {
+    const int N = 40;
+    {
+        int fd = TestConnect(port);
+        CHECK(fd >= 0);
+        for(int round = 0; round < 3; round++) {
+            CHECK(TestSend(fd, Requests(N, "/index.html", -1)));
+            string pending;
+            vector<TestResponse> resps;
+            CHECK(TestRecv(fd, pending, resps, N));
+            for(auto& r : resps) {
+                CHECK(r.code == 200);
+                CHECK(r.body == body);
+            }
+            CHECK(pending.empty());
+        }
+        close(fd);
+    }
+    {
+        int fd = TestConnect(port);
+        CHECK(fd >= 0);
+        CHECK(TestSend(fd, Requests(N, "/index.html", N - 1)));
+        string pending;
+        vector<TestResponse> resps;
+        CHECK(TestRecv(fd, pending, resps, N));
+        for(auto& r : resps) CHECK(r.code == 200 && r.body == body);
+        CHECK(PeerClosed(fd, pending));
+        close(fd);
+    }
+    {
+        int fd = TestConnect(port);
+        CHECK(fd >= 0);
+        CHECK(TestSend(fd, Requests(N, "/index.html", 0)));
+        string pending;
+        vector<TestResponse> resps;
+        CHECK(TestRecv(fd, pending, resps, 1));
+        CHECK(resps[0].code == 200 && resps[0].body == body);
+        CHECK(PeerClosed(fd, pending));
+        close(fd);
+    }
+}
+
+static void RunMode(int port, bool inlineFast, const string& body) {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if(pid == 0) {
+        // ET模式（trigMode=3），单Reactor+线程池
+        WebServer* server = new WebServer(port, 3, 60000, false,
+                                          3306, "root", "root", "webserver",
+                                          1, 4, false, 1, 0,
+                                          0, Epoller::EPOLL, false, false, inlineFast);
+        thread([server] { server->Start(); }).detach();
+        RunClient(port, body);
+        _exit(0);   // 服务器线程没有退出接口，直接结束进程
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    printf("%s: ok\n", inlineFast ? "inline" : "threadpool");
+}
+
+int main() {
+    string root = TestMakeRoot();
+    string body(1500, 'p');
+    TestWriteFile(root + "/resources/index.html", body);
+    CHECK(chdir(root.c_str()) == 0);
+
+    RunMode(PORT, false, body);
+    RunMode(PORT + 1, true, body);
+    printf("test_pipeline: ok\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+// Range请求：
+//   1. 单区间 bytes=a-b、a-、-n（含越过文件末尾时截断）回206，Content-Range和正文对应
+//   2. 无法满足的区间回416，带Content-Range: bytes */文件长度，连接继续可用
+//   3. 语法错误、超过MAX_RANGES个区间时忽略Range，回200整个文件
+//   4. If-Range：ETag或Last-Modified匹配时按区间响应，过期的ETag、弱ETag回200整个文件
+//   5. 多区间multipart/byteranges：Content-length等于实际发出的字节数（后面流水线里的请求照常解析），
+//      逐部分核对Content-Range和数据；HEAD忽略Range
+//   6. 请求了区间时不选压缩变体
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_range.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o test_range -lpthread -lz -lmysqlclient
+#include <thread>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18372;
+static const size_t SIZE = 10000;
+
+static string data_;
+
+static string Req(const string& path, const string& range, const string& extra = "",
+                  const char* method = "GET") {
+    string req = string(method) + " " + path + " HTTP/1.1\r\nHost: t\r\nConnection: keep-alive\r\n";
+    if(!range.empty()) req += "Range: " + range + "\r\n";
+    return req + extra + "\r\n";
+}
+
+static string ContentRange(size_t first, size_t last) {
+    return "bytes " + to_string(first) + "-" + to_string(last) + "/" + to_string(SIZE);
+}
+
+static void CheckPartial(const TestResponse& r, size_t first, size_t last) {
+    CHECK(r.code == 206);
+    CHECK(TestHeader(r, "Content-Range") == ContentRange(first, last));
+    CHECK(r.body == data_.substr(first, last - first + 1));
+}
+
+static void CheckFull(const TestResponse& r) {
+    CHECK(r.code == 200 && r.body == data_);
+    CHECK(TestHeader(r, "Content-Range").empty());
+}
+
+static void TestSingle(int fd, const string& path) {
+    CheckPartial(TestGet(fd, Req(path, "bytes=0-99")), 0, 99);
+    CheckPartial(TestGet(fd, Req(path, "bytes=5000-5000")), 5000, 5000);
+    CheckPartial(TestGet(fd, Req(path, "bytes=9990-")), 9990, SIZE - 1);
+    CheckPartial(TestGet(fd, Req(path, "bytes=-300")), SIZE - 300, SIZE - 1);
+    CheckPartial(TestGet(fd, Req(path, "bytes=9000-20000")), 9000, SIZE - 1);
+    CheckPartial(TestGet(fd, Req(path, "bytes=-20000")), 0, SIZE - 1);
+    CheckPartial(TestGet(fd, Req(path, "bytes= 100-199 , 20000-")), 100, 199);   // 无法满足的一项被跳过
+
+    // 无法满足：416，错误正文有Content-length，同一连接上的下一个请求照常处理
+    for(const char* range : {"bytes=10000-", "bytes=-0", "bytes=20000-30000,-0"}) {
+        TestResponse r = TestGet(fd, Req(path, range));
+        CHECK(r.code == 416);
+        CHECK(TestHeader(r, "Content-Range") == "bytes */" + to_string(SIZE));
+        CHECK(!TestHeader(r, "Content-length").empty());
+    }
+    CheckPartial(TestGet(fd, Req(path, "bytes=1-2")), 1, 2);
+
+    // 语法错误、区间太多：按整个文件响应
+    for(const char* range : {"bytes=5-2", "items=0-1", "bytes=a-b", "bytes=", "bytes=1-2,-",
+                             "bytes=0-0,2-2,4-4,6-6,8-8,10-10,12-12,14-14,16-16"}) {
+        CheckFull(TestGet(fd, Req(path, range)));
+    }
+    // 压缩变体不参与区间
+    TestResponse r = TestGet(fd, Req(path, "bytes=0-9", "Accept-Encoding: gzip, br\r\n"));
+    CheckPartial(r, 0, 9);
+    CHECK(TestHeader(r, "Content-Encoding").empty());
+}
+
+static void TestIfRange(int fd, const string& path) {
+    TestResponse full = TestGet(fd, Req(path, ""));
+    CheckFull(full);
+    string etag = TestHeader(full, "ETag");
+    string lm = TestHeader(full, "Last-Modified");
+    CheckPartial(TestGet(fd, Req(path, "bytes=10-19", "If-Range: " + etag + "\r\n")), 10, 19);
+    CheckPartial(TestGet(fd, Req(path, "bytes=10-19", "If-Range: " + lm + "\r\n")), 10, 19);
+    CheckFull(TestGet(fd, Req(path, "bytes=10-19", "If-Range: \"stale\"\r\n")));
+    CheckFull(TestGet(fd, Req(path, "bytes=10-19", "If-Range: W/" + etag + "\r\n")));
+    CheckFull(TestGet(fd, Req(path, "bytes=10-19", "If-Range: Thu, 01 Jan 1970 00:00:00 GMT\r\n")));
+}
+
+// 解析multipart/byteranges正文，和期望的区间逐个核对
+static void CheckMultipart(const TestResponse& r, const vector<pair<size_t, size_t>>& ranges) {
+    CHECK(r.code == 206);
+    CHECK(TestHeader(r, "Content-Range").empty());
+    string type = TestHeader(r, "Content-type");
+    const string prefix = "multipart/byteranges; boundary=";
+    CHECK(type.compare(0, prefix.size(), prefix) == 0);
+    string boundary = type.substr(prefix.size());
+    CHECK(!boundary.empty());
+    CHECK(r.body.size() == strtoul(TestHeader(r, "Content-length").c_str(), nullptr, 10));
+
+    size_t pos = 0;
+    for(auto& range : ranges) {
+        string delim = "\r\n--" + boundary + "\r\n";
+        CHECK(r.body.compare(pos, delim.size(), delim) == 0);
+        pos += delim.size();
+        size_t end = r.body.find("\r\n\r\n", pos);
+        CHECK(end != string::npos);
+        string headers = r.body.substr(pos, end + 2 - pos);
+        CHECK(headers.find("Content-type: ") == 0);
+        CHECK(headers.find("Content-Range: " + ContentRange(range.first, range.second) + "\r\n") !=
+              string::npos);
+        pos = end + 4;
+        size_t len = range.second - range.first + 1;
+        CHECK(r.body.compare(pos, len, data_, range.first, len) == 0);
+        pos += len;
+    }
+    string tail = "\r\n--" + boundary + "--\r\n";
+    CHECK(r.body.compare(pos, string::npos, tail) == 0);
+}
+
+static void TestMulti(int fd, const string& path) {
+    vector<pair<size_t, size_t>> two = {{0, 9}, {SIZE - 10, SIZE - 1}};
+    vector<pair<size_t, size_t>> eight;
+    string range8 = "bytes=";
+    for(size_t i = 0; i < 8; i++) {
+        eight.push_back({i * 1000, i * 1000 + 99 + i});
+        range8 += (i ? "," : "") + to_string(i * 1000) + "-" + to_string(i * 1000 + 99 + i);
+    }
+    // 和一个普通请求一起发出：Content-length不对时下一个响应会错位
+    string pending;
+    vector<TestResponse> resps;
+    CHECK(TestSend(fd, Req(path, "bytes=0-9,-10") + Req(path, range8) + Req(path, "bytes=-5,100-104,9000-") +
+                       Req(path, "")));
+    CHECK(TestRecv(fd, pending, resps, 4));
+    CHECK(pending.empty());
+    CheckMultipart(resps[0], two);
+    CheckMultipart(resps[1], eight);
+    CheckMultipart(resps[2], {{SIZE - 5, SIZE - 1}, {100, 104}, {9000, SIZE - 1}});
+    CheckFull(resps[3]);
+
+    // 只有GET按区间响应，HEAD忽略Range
+    TestResponse head = TestGet(fd, Req(path, range8, "", "HEAD"), true);
+    CHECK(head.code == 200 && head.body.empty());
+    CHECK(TestHeader(head, "Content-length") == to_string(SIZE));
+    CheckMultipart(TestGet(fd, Req(path, range8)), eight);
+}
+
+int main() {
+    string root = TestMakeRoot();
+    data_.resize(SIZE);
+    for(size_t i = 0; i < SIZE; i++) data_[i] = static_cast<char>('A' + (i * 13 + i / 100) % 58);
+    TestWriteFile(root + "/resources/data.txt", data_);
+    CHECK(chdir(root.c_str()) == 0);
+
+    WebServer* server = new WebServer(PORT, 3, 60000, false,
+                                      3306, "root", "root", "webserver",
+                                      1, 2, false, 1, 0);
+    thread([server] { server->Start(); }).detach();
+    int fd = TestConnect(PORT);
+    CHECK(fd >= 0);
+    // 多轮：首次加载、映射命中、小文件层（blob）各覆盖到
+    for(int round = 0; round < 4; round++) {
+        TestSingle(fd, "/data.txt");
+        TestIfRange(fd, "/data.txt");
+        TestMulti(fd, "/data.txt");
+    }
+    close(fd);
+    printf("test_range: ok\n");
+    fflush(stdout);
+    _exit(0);   // 服务器线程没有退出接口，直接结束进程
+}
@@ -0,0 +1,106 @@
+// 预先拼好的响应头模板：
+//   1. 状态行+Connection头的close/keep-alive两种变体、内置错误正文，逐字节核对
+//   2. FormatUint/AppendContentLength的边界值
+//   3. HttpResponse用模板生成的完整响应：错误页文件缺失的404(close)、普通文件的200(keep-alive)
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_responsetemplate.cpp ../http/*.cpp ../buffer/*.cpp ../log/log.cpp
+//       ../pool/sqlconnpool.cpp ../time/cachedclock.cpp -o test_responsetemplate -lpthread -lz -lmysqlclient
+#include <stdint.h>
+#include "testclient.h"
+#include "../http/responsetemplate.h"
+#include "../http/httpresponse.h"
+
+using namespace std;
+
+static string Take(Buffer& buff) {
+    string s(buff.Peek(), buff.ReadableBytes());
+    buff.RetrieveAll();
+    return s;
+}
+
+static string HttpDate() {
+    CachedClock::Snapshot now;
+    CachedClock::Instance()->Now(&now);
+    return now.httpDate;
+}
+
+static void TestTemplate() {
+    ResponseTemplate tpl({{200, "OK"}, {404, "Not Found"}, {99, "Bad"}, {600, "Bad"}});
+    CHECK(tpl.Known(200) && tpl.Known(404));
+    CHECK(!tpl.Known(201) && !tpl.Known(99) && !tpl.Known(600) && !tpl.Known(-1));
+    CHECK(tpl.Prefix(200, false) == "HTTP/1.1 200 OK\r\nConnection: close\r\n");
+    CHECK(tpl.Prefix(200, true) == "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n");
+    CHECK(tpl.Prefix(404, false) == "HTTP/1.1 404 Not Found\r\nConnection: close\r\n");
+    CHECK(tpl.Prefix(201, true).empty());
+    CHECK(tpl.Status(404) == "Not Found");
+
+    string page = "<html><title>Error</title><body bgcolor=\"ffffff\">404 : Not Found\n"
+                  "<p>File NotFound!</p><hr><em>TinyWebServer</em></body></html>";
+    CHECK(tpl.ErrorBody(404) == "Content-type: text/html\r\nContent-length: " + to_string(page.size()) +
+                                "\r\n\r\n" + page);
+    CHECK(tpl.ErrorBody(201).empty());
+}
+
+static void TestFormat() {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    for(size_t n : {(size_t)0, (size_t)7, (size_t)10, (size_t)99, (size_t)100, (size_t)101,
+                    (size_t)12345, (size_t)1000000, SIZE_MAX}) {
+        char* p = ResponseTemplate::FormatUint(n, end);
+        CHECK(string(p, end) == to_string(n));
+    }
+    Buffer buff;
+    ResponseTemplate::AppendContentLength(buff, 0);
+    CHECK(Take(buff) == "Content-length: 0\r\n\r\n");
+    ResponseTemplate::AppendContentLength(buff, SIZE_MAX);
+    CHECK(Take(buff) == "Content-length: " + to_string(SIZE_MAX) + "\r\n\r\n");
+}
+
+static void TestResponse(const string& root) {
+    string srcDir = root + "/resources/";
+    FileCache::Instance()->Init(srcDir);
+    CachedClock::Instance()->Update();
+    Buffer buff;
+
+    // 404，错误页文件不存在：状态行(close) + Date + 内置错误正文
+    HttpResponse resp;
+    string path = "/missing.html";
+    resp.Init(srcDir.c_str(), path, false, -1);
+    resp.MakeResponse(buff);
+    CHECK(resp.Code() == 404 && resp.PieceCount() == 0);
+    string page = "<html><title>Error</title><body bgcolor=\"ffffff\">404 : Not Found\n"
+                  "<p>File NotFound!</p><hr><em>TinyWebServer</em></body></html>";
+    CHECK(Take(buff) == "HTTP/1.1 404 Not Found\r\nConnection: close\r\nDate: " + HttpDate() + "\r\n"
+                        "Content-type: text/html\r\nContent-length: " + to_string(page.size()) + "\r\n\r\n" + page);
+
+    // 同一个错误，HEAD只有头部
+    resp.Init(srcDir.c_str(), path, true, -1, 0, true);
+    resp.MakeResponse(buff);
+    CHECK(Take(buff) == "HTTP/1.1 404 Not Found\r\nConnection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n"
+                        "Date: " + HttpDate() + "\r\n"
+                        "Content-type: text/html\r\nContent-length: " + to_string(page.size()) + "\r\n\r\n");
+
+    // 200(keep-alive)：状态行 + Date + 缓存条目里预先拼好的头部，正文作为一段交给连接
+    path = "/a.txt";
+    resp.Init(srcDir.c_str(), path, true, -1);
+    resp.MakeResponse(buff);
+    CHECK(resp.Code() == 200 && resp.PieceCount() == 1);
+    FileCache::FilePtr file = resp.DetachFile();
+    CHECK(file && file->Ok() && !file->blob);
+    CHECK(file->header == "Content-type: text/plain\r\nAccept-Ranges: bytes\r\nETag: " + file->etag +
+                          "\r\nLast-Modified: " + file->lastModified + "\r\nContent-length: 5\r\n\r\n");
+    CHECK(Take(buff) == "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n"
+                        "Date: " + HttpDate() + "\r\n" + file->header);
+    CHECK(resp.Pieces()[0].off == 0 && resp.Pieces()[0].len == 5);
+    FileCache::Instance()->Close();
+}
+
+int main() {
+    string root = TestMakeRoot();
+    TestWriteFile(root + "/resources/a.txt", "hello");
+    TestTemplate();
+    TestFormat();
+    TestResponse(root);
+    printf("test_responsetemplate: ok\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+// 路由的405/Allow和HEAD响应：
+//   1. Router::Find对方法不匹配的路径给出注册过的方法集合，GET隐含HEAD，参数/通配节点的方法也并进来
+//   2. 服务器上HEAD只发头部（Content-length与GET相同），同一连接上紧接着的GET照常解析；
+//      小文件层（blob里头部和正文连在一起）和普通文件、错误页都覆盖到
+//   3. 方法不匹配时回405，Allow头列出这个路径能用的方法
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_router.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o test_router -lpthread -lz -lmysqlclient
+#include <thread>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18330;
+
+static void TestFindAllow() {
+    Router router;
+    auto nop = [](HttpRequest&, const RouteParams&, HttpResponse&) {};
+    CHECK(router.Add("GET", "/user/:id", nop));
+    CHECK(router.Add("DELETE", "/user/:id", nop));
+    CHECK(router.Add("PUT", "/user/me", nop));
+    CHECK(router.Add("POST", "/files/*path", nop));
+    router.Freeze();
+
+    RouteParams params;
+    uint32_t allow = 0;
+    CHECK(router.Find("GET", "/user/42", &params, &allow));
+    CHECK(params.Get("id") == "42");
+    CHECK(router.Find("HEAD", "/user/42", &params, &allow));    // 退回GET
+
+    CHECK(!router.Find("POST", "/user/42", &params, &allow));
+    CHECK(Router::AllowList(allow) == "GET, HEAD, DELETE");
+    // 静态节点只有PUT，回溯到参数节点后GET/DELETE也能匹配
+    CHECK(!router.Find("POST", "/user/me", &params, &allow));
+    CHECK(Router::AllowList(allow) == "GET, HEAD, PUT, DELETE");
+    CHECK(!router.Find("GET", "/files/a/b", &params, &allow));
+    CHECK(Router::AllowList(allow) == "POST");
+    CHECK(!router.Find("BREW", "/user/42", &params, &allow));
+    CHECK(Router::AllowList(allow) == "GET, HEAD, DELETE");
+    CHECK(!router.Find("GET", "/nothing", &params, &allow));
+    CHECK(allow == 0);
+}
+
+static string Req(const char* method, const char* path) {
+    return string(method) + " " + path + " HTTP/1.1\r\nHost: t\r\nContent-Length: 0\r\n"
+           "Connection: keep-alive\r\n\r\n";
+}
+
+static void TestServer() {
+    string root = TestMakeRoot();
+    string small(700, 's');
+    string large(300000, 'L');
+    TestWriteFile(root + "/resources/index.html", small);
+    TestWriteFile(root + "/resources/large.bin", large);
+    CHECK(chdir(root.c_str()) == 0);
+
+    WebServer* server = new WebServer(PORT, 3, 60000, false,
+                                      3306, "root", "root", "webserver",
+                                      1, 4, false, 1, 0);
+    thread([server] { server->Start(); }).detach();
+
+    int fd = TestConnect(PORT);
+    CHECK(fd >= 0);
+    // 多次请求，让小文件从普通条目升级进小文件层
+    for(int i = 0; i < 8; i++) {
+        for(const char* path : {"/index.html", "/large.bin"}) {
+            const string& body = path[1] == 'i' ? small : large;
+            TestResponse head = TestGet(fd, Req("HEAD", path), true);
+            CHECK(head.code == 200);
+            CHECK(TestHeader(head, "Content-length") == to_string(body.size()));
+            TestResponse get = TestGet(fd, Req("GET", path));
+            CHECK(get.code == 200);
+            CHECK(get.body == body);
+        }
+    }
+    // 错误页：头部里有Content-length，正文不发
+    TestResponse missing = TestGet(fd, Req("HEAD", "/missing.html"), true);
+    CHECK(missing.code == 404);
+    CHECK(!TestHeader(missing, "Content-length").empty());
+    // HEAD流水线：如果混进了正文，后面的响应会错位
+    {
+        string data;
+        for(int i = 0; i < 10; i++) data += Req("HEAD", "/index.html");
+        data += Req("GET", "/index.html");
+        string pending;
+        vector<TestResponse> resps;
+        CHECK(TestSend(fd, data));
+        CHECK(TestRecv(fd, pending, resps, 10, true));
+        for(auto& r : resps) CHECK(r.code == 200);
+        resps.clear();
+        CHECK(TestRecv(fd, pending, resps, 1));
+        CHECK(resps[0].code == 200 && resps[0].body == small);
+        CHECK(pending.empty());
+    }
+
+    TestResponse post = TestGet(fd, Req("POST", "/index.html"));
+    CHECK(post.code == 405);
+    CHECK(TestHeader(post, "Allow") == "GET, HEAD");
+    TestResponse del = TestGet(fd, Req("DELETE", "/login.html"));
+    CHECK(del.code == 405);
+    CHECK(TestHeader(del, "Allow") == "GET, HEAD, POST");
+    TestResponse get = TestGet(fd, Req("GET", "/index.html"));
+    CHECK(get.code == 200 && TestHeader(get, "Allow").empty());
+    close(fd);
+}
+
+int main() {
+    TestFindAllow();
+    TestServer();
+    printf("test_router: ok\n");
+    fflush(stdout);
+    _exit(0);   // 服务器线程没有退出接口，直接结束进程
+}
@@ -0,0 +1,143 @@
+// one loop per thread模式（loopNum>0）：
+//   1. 可能阻塞的路由（没有标记nonBlocking）交给线程池，执行期间同一个子Reactor上的其他连接照常响应
+//   2. 流水线里夹着阻塞请求，工作线程处理完回到子Reactor，三个响应按序到达，连接继续可用
+//   3. 大文件（sendfile）发给读得很慢的客户端：LT模式下一次write没写完也没遇到EAGAIN时要继续等EPOLLOUT，不能关连接
+// LT(trigMode=0)和ET(trigMode=3，常驻不用ONESHOT)各跑一遍；Router是单例，每种模式在子进程里起一个服务器
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_subreactor.cpp ../server/*.cpp ../http/*.cpp ../buffer/*.cpp
+//       ../log/log.cpp ../pool/sqlconnpool.cpp ../time/cachedclock.cpp ../time/timewheel.cpp
+//       -o test_subreactor -lpthread -lz -lmysqlclient
+#include <thread>
+#include <chrono>
+#include <sys/wait.h>
+#include "testclient.h"
+#include "../server/webserver.h"
+
+using namespace std;
+
+static const int PORT = 18360;
+static const int SLOW_MS = 400;
+
+static string Get(const string& path) {
+    return "GET " + path + " HTTP/1.1\r\nHost: t\r\nConnection: keep-alive\r\n\r\n";
+}
+
+static double MsSince(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+static void TestBlockingRoute(int port, const string& body) {
+    int fast = TestConnect(port);
+    CHECK(fast >= 0);
+    CHECK(TestGet(fast, Get("/index.html")).body == body);    // 预热：进入缓存
+
+    int slow = TestConnect(port);
+    CHECK(slow >= 0);
+    auto t0 = chrono::steady_clock::now();
+    CHECK(TestSend(slow, Get("/slow")));
+    usleep(50000);      // 确保/slow已经在工作线程上
+    for(int i = 0; i < 20; i++) {
+        TestResponse resp = TestGet(fast, Get("/index.html"));
+        CHECK(resp.code == 200 && resp.body == body);
+    }
+    CHECK(MsSince(t0) < SLOW_MS);  // 没有被/slow卡住
+    string pending;
+    vector<TestResponse> resps;
+    CHECK(TestRecv(slow, pending, resps, 1));
+    CHECK(resps[0].code == 200 && resps[0].body == body);
+    CHECK(MsSince(t0) >= SLOW_MS);
+
+    // 流水线：阻塞请求前后各一个
+    resps.clear();
+    CHECK(TestSend(slow, Get("/index.html") + Get("/slow") + Get("/index.html")));
+    CHECK(TestRecv(slow, pending, resps, 3));
+    for(auto& r : resps) CHECK(r.code == 200 && r.body == body);
+    CHECK(pending.empty());
+    CHECK(TestGet(slow, Get("/index.html")).body == body);
+    close(slow);
+    close(fast);
+}
+
+// 读得很慢的客户端：接收缓冲区较小，每次只读4KB，返回完整响应（头+正文）
+static string SlowRead(int port, const string& req) {
+    int fd = TestConnect(port);
+    CHECK(fd >= 0);
+    int small = 65536;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    CHECK(TestSend(fd, req));
+    string data;
+    char buf[4096];
+    size_t want = 0;
+    while(want == 0 || data.size() < want) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        CHECK(n > 0);
+        data.append(buf, n);
+        if(want == 0) {
+            size_t end = data.find("\r\n\r\n");
+            size_t len = data.find("Content-length: ");
+            if(end != string::npos) {
+                CHECK(len < end);
+                want = end + 4 + strtoul(data.c_str() + len + 16, nullptr, 10);
+            }
+        }
+        if(data.size() % 16 == 0) usleep(100);
+    }
+    CHECK(data.size() == want);
+    close(fd);
+    return data;
+}
+
+// 正文用sendfile发送：多区间响应的最后一个文件段发完后只剩几十字节的结尾分隔符，
+// LT模式下write就此返回，ret>0且没写完
+static void TestSlowReader(int port, const string& big) {
+    string resp = SlowRead(port, Get("/big.bin"));
+    CHECK(atoi(resp.c_str() + 9) == 200);
+    CHECK(resp.compare(resp.size() - big.size(), big.size(), big) == 0);
+
+    size_t half = big.size() / 2;
+    resp = SlowRead(port, "GET /big.bin HTTP/1.1\r\nHost: t\r\nRange: bytes=0-" + to_string(half - 1) + "," +
+                          to_string(half) + "-\r\n\r\n");
+    CHECK(atoi(resp.c_str() + 9) == 206);
+    CHECK(resp.find(big.substr(0, 4096)) != string::npos);
+    CHECK(resp.find(big.substr(big.size() - 4096)) != string::npos);
+    CHECK(resp.compare(resp.size() - 4, 4, "--\r\n") == 0);
+}
+
+static void RunMode(int port, int trigMode, const string& body, const string& big) {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if(pid == 0) {
+        // 单个子Reactor，连接都在同一个loop线程上
+        WebServer* server = new WebServer(port, trigMode, 60000, false,
+                                          3306, "root", "root", "webserver",
+                                          1, 2, false, 1, 0,
+                                          1, Epoller::EPOLL, false, true);
+        Router::Instance()->Add("GET", "/slow", [](HttpRequest&, const RouteParams&, HttpResponse& resp) {
+            usleep(SLOW_MS * 1000);
+            resp.SetPath("/index.html");
+        });
+        thread([server] { server->Start(); }).detach();
+        TestBlockingRoute(port, body);
+        TestSlowReader(port, big);
+        _exit(0);   // 服务器线程没有退出接口，直接结束进程
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    printf("%s: ok\n", trigMode == 0 ? "LT" : "ET");
+}
+
+int main() {
+    string root = TestMakeRoot();
+    string body(1500, 's');
+    string big(4 << 20, 0);
+    for(size_t i = 0; i < big.size(); i++) big[i] = static_cast<char>(i * 131 + (i >> 12));
+    TestWriteFile(root + "/resources/index.html", body);
+    TestWriteFile(root + "/resources/big.bin", big);
+    CHECK(chdir(root.c_str()) == 0);
+
+    RunMode(PORT, 0, body, big);
+    RunMode(PORT + 1, 3, body, big);
+    printf("test_subreactor: ok\n");
+    return 0;
+}
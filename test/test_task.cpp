@@ -0,0 +1,115 @@
+// Task和线程池分发路径的堆分配计数：替换全局operator new，统计分发期间（含工作线程执行）的分配次数。
+//   1. Task内联存放 std::bind(&Class::Func, this, arg)，构造、移动、调用都不分配
+//   2. ThreadPool / WorkStealingPool 从外部线程提交（即epoll主线程分发I/O事件）时零分配
+//   3. 例外：WorkStealingPool在工作线程内部的嵌套提交每次new一个Task节点（Chase-Lev队列
+//      只能存放指针）。服务器的I/O事件都从loop线程提交，走不到这条路径，这里只核对次数
+// 编译（在test目录下）：
+//   g++ -std=c++17 -O2 -I.. test_task.cpp -o test_task -lpthread
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include "../pool/threadpool.h"
+#include "../pool/workstealingpool.h"
+
+using namespace std;
+
+static atomic<long> allocs(0);
+
+void* operator new(size_t size) {
+    allocs.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if(!p) throw bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+#define CHECK(cond) do { \
+    if(!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); exit(1); } \
+} while(0)
+
+// 与WebServer::DealRead_里的 std::bind(&WebServer::OnRead_, this, client) 形状相同
+struct Conn { int fd; };
+class Server {
+public:
+    void OnRead_(Conn* client) {
+        handled_.fetch_add(client->fd, memory_order_release);
+    }
+    long Handled() const { return handled_.load(memory_order_acquire); }
+private:
+    atomic<long> handled_{0};
+};
+
+static const int EVENTS = 100000;
+static const int WAVE = 1000;
+
+static void TestTaskInline() {
+    Server server;
+    Conn conn{1};
+    long before = allocs.load();
+    Task task(std::bind(&Server::OnRead_, &server, &conn));
+    Task moved(std::move(task));
+    moved();
+    Task assigned;
+    assigned = std::move(moved);
+    assigned();
+    CHECK(allocs.load() == before);
+    CHECK(server.Handled() == 2);
+}
+
+// 按epoll_wait一轮最多1024个事件分批分发，每批处理完再发下一批
+template<typename Pool>
+static long DispatchAllocs(Pool& pool) {
+    Server server;
+    Conn conn{1};
+    long before = allocs.load();
+    for(int i = 0; i < EVENTS; i += WAVE) {
+        for(int j = 0; j < WAVE; j++) {
+            pool.AddTask(std::bind(&Server::OnRead_, &server, &conn));
+        }
+        while(server.Handled() < i + WAVE) this_thread::yield();
+    }
+    return allocs.load() - before;
+}
+
+static void TestThreadPool() {
+    ThreadPool pool(4);
+    long n = DispatchAllocs(pool);
+    printf("ThreadPool: %ld allocations for %d events\n", n, EVENTS);
+    CHECK(n == 0);
+}
+
+static void TestWorkStealingPool() {
+    WorkStealingPool pool(4);
+    long n = DispatchAllocs(pool);
+    printf("WorkStealingPool (external): %ld allocations for %d events\n", n, EVENTS);
+    CHECK(n == 0);
+}
+
+static void TestNestedSubmission() {
+    WorkStealingPool pool(4);
+    atomic<int> children(0);
+    const int PARENTS = 1000;
+    long before = allocs.load();
+    for(int i = 0; i < PARENTS; i++) {
+        pool.AddTask([&pool, &children] {
+            pool.AddTask([&children] { children.fetch_add(1, memory_order_release); });
+        });
+    }
+    while(children.load(memory_order_acquire) < PARENTS) this_thread::yield();
+    long n = allocs.load() - before;
+    printf("WorkStealingPool (nested): %ld allocations for %d submissions\n", n, PARENTS);
+    CHECK(n <= PARENTS);    // 每次嵌套提交至多一个节点（队列扩容另计，这里的积压达不到）
+}
+
+int main() {
+    TestTaskInline();
+    TestThreadPool();
+    TestWorkStealingPool();
+    TestNestedSubmission();
+    printf("test_task: ok\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+#ifndef TEST_CLIENT_H
+#define TEST_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// 测试用的最小HTTP客户端：阻塞socket，按Content-length切分响应
+
+#define CHECK(cond) do { \
+    if(!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); exit(1); } \
+} while(0)
+
+struct TestResponse {
+    int code = 0;
+    std::string header;
+    std::string body;
+};
+
+// 连接本机端口，失败时每隔10ms重试，等服务器起来
+inline int TestConnect(int port, int timeoutMs = 3000) {
+    for(int waited = 0; waited <= timeoutMs; waited += 10) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            struct timeval tv = {5, 0};     // 服务端卡住时测试失败而不是挂死
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+inline bool TestSend(int fd, const std::string& data) {
+    size_t sent = 0;
+    while(sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// 读出n个完整响应；isHead为true时响应没有正文，不按Content-length读
+inline bool TestRecv(int fd, std::string& pending, std::vector<TestResponse>& out, size_t n,
+                     bool isHead = false) {
+    char buf[65536];
+    while(out.size() < n) {
+        size_t end = pending.find("\r\n\r\n");
+        if(end != std::string::npos) {
+            TestResponse resp;
+            resp.header = pending.substr(0, end + 4);
+            resp.code = atoi(resp.header.c_str() + 9);
+            size_t len = 0;
+            for(size_t pos = 0; (pos = resp.header.find("\r\n", pos)) != std::string::npos; pos += 2) {
+                if(strncasecmp(resp.header.c_str() + pos + 2, "Content-length:", 15) == 0) {
+                    len = strtoul(resp.header.c_str() + pos + 17, nullptr, 10);
+                }
+            }
+            if(isHead) len = 0;
+            if(pending.size() >= end + 4 + len) {
+                resp.body = pending.substr(end + 4, len);
+                pending.erase(0, end + 4 + len);
+                out.push_back(std::move(resp));
+                continue;
+            }
+        }
+        ssize_t r = recv(fd, buf, sizeof(buf), 0);
+        if(r <= 0) return false;
+        pending.append(buf, r);
+    }
+    return true;
+}
+
+// 发一个请求读一个响应
+inline TestResponse TestGet(int fd, const std::string& req, bool isHead = false) {
+    std::string pending;
+    std::vector<TestResponse> out;
+    if(!TestSend(fd, req) || !TestRecv(fd, pending, out, 1, isHead)) return TestResponse();
+    return out[0];
+}
+
+// 响应头里name字段的值，没有时返回空串
+inline std::string TestHeader(const TestResponse& r, const char* name) {
+    size_t n = strlen(name);
+    for(size_t pos = 0; (pos = r.header.find("\r\n", pos)) != std::string::npos; pos += 2) {
+        if(strncasecmp(r.header.c_str() + pos + 2, name, n) == 0 && r.header[pos + 2 + n] == ':') {
+            size_t begin = pos + 2 + n + 1;
+            while(r.header[begin] == ' ') begin++;
+            return r.header.substr(begin, r.header.find("\r\n", begin) - begin);
+        }
+    }
+    return std::string();
+}
+
+// 在临时目录里建resources/，服务器以它为工作目录
+inline std::string TestMakeRoot() {
+    char tmpl[] = "/tmp/webserver-test-XXXXXX";
+    CHECK(mkdtemp(tmpl));
+    std::string root = tmpl;
+    mkdir((root + "/resources").c_str(), 0755);
+    return root;
+}
+
+inline void TestWriteFile(const std::string& path, const std::string& data) {
+    FILE* fp = fopen(path.c_str(), "wb");
+    CHECK(fp);
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+}
+
+#endif //TEST_CLIENT_H
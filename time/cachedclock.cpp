@@ -0,0 +1,74 @@
+#include "cachedclock.h"
+#include <stdio.h>
+
+static const char* WEEKDAY[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char* MONTH[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                               "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+thread_local CachedClock* CachedClock::bound_ = nullptr;
+
+CachedClock::CachedClock() : monoMs_(0), seq_(0), inited_(false), lastSec_(0) {
+    memset(&snap_, 0, sizeof(snap_));
+}
+
+CachedClock* CachedClock::Instance() {
+    if(bound_) return bound_;
+    static CachedClock clock;
+    return &clock;
+}
+
+void CachedClock::Bind(CachedClock* clock) {
+    bound_ = clock;
+}
+
+void CachedClock::Format_(time_t sec) {
+    struct tm gmt;
+    gmtime_r(&sec, &gmt);
+    snprintf(snap_.httpDate, sizeof(snap_.httpDate), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+             WEEKDAY[gmt.tm_wday], gmt.tm_mday, MONTH[gmt.tm_mon], gmt.tm_year + 1900,
+             gmt.tm_hour, gmt.tm_min, gmt.tm_sec);
+    localtime_r(&sec, &snap_.localTm);
+    strftime(snap_.logTime, sizeof(snap_.logTime), "%Y-%m-%d %H:%M:%S", &snap_.localTm);
+}
+
+// 每次epoll_wait返回由所属的loop线程调用一次；锁只防惰性初始化和loop线程同时写，正常不会争用
+void CachedClock::Update() {
+    std::unique_lock<std::mutex> locker(mtx_, std::defer_lock);
+    if(inited_.load(std::memory_order_acquire)) {
+        if(!locker.try_lock()) return;
+    } else {
+        locker.lock();
+    }
+
+    struct timespec mono, wall;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &wall);
+    int64_t monoMs = mono.tv_sec * 1000LL + mono.tv_nsec / 1000000;
+
+    seq_.fetch_add(1, std::memory_order_acq_rel);
+    snap_.monoMs = monoMs;
+    snap_.wallUs = wall.tv_sec * 1000000LL + wall.tv_nsec / 1000;
+    if(wall.tv_sec != lastSec_) {
+        Format_(wall.tv_sec);
+        lastSec_ = wall.tv_sec;
+    }
+    seq_.fetch_add(1, std::memory_order_release);
+    monoMs_.store(monoMs, std::memory_order_release);
+    inited_.store(true, std::memory_order_release);
+}
+
+int64_t CachedClock::NowMs() {
+    if(!inited_.load(std::memory_order_acquire)) Update();
+    return monoMs_.load(std::memory_order_acquire);
+}
+
+void CachedClock::Now(Snapshot* snap) {
+    if(!inited_.load(std::memory_order_acquire)) Update();
+    uint32_t begin, end;
+    do {
+        begin = seq_.load(std::memory_order_acquire);
+        memcpy(snap, &snap_, sizeof(Snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end = seq_.load(std::memory_order_relaxed);
+    } while((begin & 1) || begin != end);
+}
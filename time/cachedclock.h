@@ -0,0 +1,48 @@
+#ifndef CACHED_CLOCK_H
+#define CACHED_CLOCK_H
+
+#include <atomic>
+#include <mutex>
+#include <time.h>
+#include <string.h>
+#include <stdint.h>
+
+// 粗粒度缓存时钟：事件循环每次epoll_wait返回后调用一次Update()，
+// 定时器、日志和响应头都从这里读时间，热路径上不再调用gettimeofday/localtime/now()。
+// HTTP Date头和日志时间前缀只在秒数变化时重新格式化。
+// 每个事件循环一个时钟：子Reactor持有自己的实例并在线程启动时Bind，本线程的Instance()
+// 返回它，Reactor之间互不争用；没有Bind的线程（单Reactor的主线程和它的线程池）共用进程默认实例。
+// 写者只有所属的loop线程（首次读取时的惰性初始化除外），读者用seqlock拿到一致的快照
+class CachedClock {
+public:
+    struct Snapshot {
+        int64_t monoMs;         // 单调时钟，毫秒
+        int64_t wallUs;         // 墙上时间，微秒
+        struct tm localTm;      // 本地时间（日志按天切分文件用）
+        char httpDate[32];      // RFC 7231: "Sun, 06 Nov 1994 08:49:37 GMT"
+        char logTime[24];       // "2024-01-01 12:00:00"
+    };
+
+    CachedClock();
+
+    static CachedClock* Instance();     // 本线程Bind的时钟，没有则为进程默认实例
+    static void Bind(CachedClock* clock);
+
+    void Update();
+    int64_t NowMs();
+    void Now(Snapshot* snap);
+
+private:
+    void Format_(time_t sec);
+
+    static thread_local CachedClock* bound_;
+
+    std::atomic<int64_t> monoMs_;
+    std::atomic<uint32_t> seq_;     // 奇数表示正在写
+    std::atomic<bool> inited_;
+    Snapshot snap_;
+    time_t lastSec_;
+    std::mutex mtx_;
+};
+
+#endif //CACHED_CLOCK_H
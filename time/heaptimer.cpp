@@ -1,21 +1,20 @@
 #include "heaptimer.h"
 
 void HeapTimer::SwapNode_(size_t i,size_t j){
-    assert(i >= 0 && i <heap_.size());
-    assert(j >= 0 && j <heap_.size());
+    assert(i < heap_.size());
+    assert(j < heap_.size());
     swap(heap_[i],heap_[j]);
     ref_[heap_[i].id] = i;
     ref_[heap_[j].id] = j;
 }
 
 void HeapTimer::siftup_(size_t i){
-    assert(i>=0 && i < heap_.size());
-    size_t parent = (i-1)/2;
-    while(parent >= 0){
+    assert(i < heap_.size());
+    while(i > 0){
+        size_t parent = (i-1)/2;
         if(heap_[parent] > heap_[i]){
             SwapNode_(i,parent);
             i = parent;
-            parent = (i-1)/2;
         }else{
             break;
         }
@@ -25,27 +24,27 @@ void HeapTimer::siftup_(size_t i){
 
 // false: 不需要下滑 true: 下滑成功
 bool HeapTimer::siftdown_(size_t i, size_t n){
-    assert(i >= 0 && i < heap_.size());
-    assert(n <= 0 && n <= heap_.size());
+    assert(i < heap_.size());
+    assert(n <= heap_.size());
     auto index = i;
     auto child = 2*index+1;
     while(child < n){
         if(child + 1 < n && heap_[child+1] < heap_[child]){
             child++;
         }
-        if(heap_[child] < heap_[index]){
-            SwapNode_(index,child);
-            index = child;
-            child = 2*child+1;
+        if(!(heap_[child] < heap_[index])){
+            break;
         }
-        break;
+        SwapNode_(index,child);
+        index = child;
+        child = 2*child+1;
     }
     return index > i;
 }
 
 
 void HeapTimer::del_(size_t index){
-    assert(index>=0 && index < heap_.size());
+    assert(index < heap_.size());
     size_t tmp=index;
     size_t n = heap_.size()-1;
     assert(tmp <= n);
@@ -114,14 +113,11 @@ void HeapTimer::clear(){
 
 int HeapTimer::GetNextTick(){
     tick();
-    size_t res = -1;
+    int res = -1;
     if(!heap_.empty()){
-        res = std::chrono::duration_cast<MS>();
+        res = std::chrono::duration_cast<MS>(heap_.front().expires - Clock::now()).count();
         if(res < 0) res =0 ;
     }
     //返回最小剩余时间
     return res;
 }
-
-
-#endif
\ No newline at end of file
@@ -21,10 +21,10 @@ struct TimerNode{
     int id;
     TimeStamp expires;  // 超出时间点
     TimeoutCallBack cb; // 回调function<void()>
-    bool operator<(const TimerNode& t){ // 重载比较运算符
+    bool operator<(const TimerNode& t) const { // 重载比较运算符
         return expires < t.expires;
     }
-    bool operator>(const TimerNode& t){
+    bool operator>(const TimerNode& t) const {
         return expires > t.expires;
     }
 };
@@ -51,6 +51,6 @@ private:
     //key:id value:vector的下标
     std::unordered_map<int,size_t> ref_;
 
-}
+};
 
 #endif
@@ -0,0 +1,188 @@
+#include "timewheel.h"
+
+TimeWheel::TimeWheel(int maxId) : nodes_(maxId), current_(0), count_(0),
+    baseMs_(CachedClock::Instance()->NowMs()) {
+    assert(maxId > 0);
+    for(int i = 0; i < maxId; i++) {
+        nodes_[i].id = i;
+        nodes_[i].prev = nodes_[i].next = nullptr;
+        nodes_[i].active = false;
+    }
+    for(int l = 0; l < LEVELS; l++) {
+        for(int s = 0; s < WHEEL_SIZE; s++) {
+            wheel_[l][s].prev = wheel_[l][s].next = &wheel_[l][s];
+        }
+        bitmap_[l] = 0;
+    }
+}
+
+int64_t TimeWheel::Now_() const {
+    return CachedClock::Instance()->NowMs() - baseMs_;
+}
+
+// 按剩余时间选层，按到期时刻的对应位选槽
+void TimeWheel::Insert_(TimerNode* node) {
+    int64_t when = node->expires;
+    if(when < current_) when = current_;
+    if(when - current_ >= MAX_SPAN) when = current_ + MAX_SPAN - 1;   // 超出范围先挂最高层
+    int64_t delta = when - current_;
+    int level = 0;
+    while(level < LEVELS - 1 && delta >= (1LL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (when >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    TimerNode* head = &wheel_[level][slot];
+    node->level = level;
+    node->slot = slot;
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+    bitmap_[level] |= (1ULL << slot);
+}
+
+void TimeWheel::Unlink_(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+    TimerNode* head = &wheel_[node->level][node->slot];
+    if(head->next == head) {
+        bitmap_[node->level] &= ~(1ULL << node->slot);
+    }
+}
+
+// 把高层槽整体摘下，按新的剩余时间重新挂到低层
+void TimeWheel::Cascade_(int level, int slot) {
+    TimerNode* head = &wheel_[level][slot];
+    if(head->next == head) return;
+    TimerNode* node = head->next;
+    head->prev->next = nullptr;
+    head->prev = head->next = head;
+    bitmap_[level] &= ~(1ULL << slot);
+    while(node) {
+        TimerNode* next = node->next;
+        Insert_(node);
+        node = next;
+    }
+}
+
+// 最近一个需要处理的时刻：某层最近的非空槽对应的时间点（第0层是到期，其余层是降级）
+int64_t TimeWheel::NextEventTime_() const {
+    int64_t best = INT64_MAX;
+    for(int l = 0; l < LEVELS; l++) {
+        if(bitmap_[l] == 0) continue;
+        int shift = WHEEL_BITS * l;
+        int64_t cur = current_ >> shift;
+        int start = (cur + 1) & WHEEL_MASK;
+        uint64_t rot = (bitmap_[l] >> start) | (start ? bitmap_[l] << (WHEEL_SIZE - start) : 0);
+        int64_t k = __builtin_ctzll(rot) + 1;
+        int64_t t = (cur + k) << shift;
+        if(t < best) best = t;
+    }
+    return best;
+}
+
+// 从current_推进到target，中间跳过所有空槽
+void TimeWheel::Advance_(int64_t target) {
+    while(count_ > 0) {
+        int64_t next = NextEventTime_();
+        if(next > target) break;
+        current_ = next;
+        for(int l = LEVELS - 1; l > 0; l--) {
+            int shift = WHEEL_BITS * l;
+            if((next & ((1LL << shift) - 1)) == 0) {
+                Cascade_(l, (next >> shift) & WHEEL_MASK);
+            }
+        }
+        // 回调里可能删除/添加其他定时器，所以每次只取链表头
+        TimerNode* head = &wheel_[0][next & WHEEL_MASK];
+        while(head->next != head) {
+            TimerNode* node = head->next;
+            Unlink_(node);
+            if(node->expires > next) {
+                Insert_(node);
+                continue;
+            }
+            node->active = false;
+            count_--;
+            TimeoutCallBack cb = std::move(node->cb);
+            node->cb = nullptr;
+            if(cb) cb();
+        }
+    }
+    if(current_ < target) current_ = target;
+}
+
+void TimeWheel::add(int id, int timeOut, const TimeoutCallBack& cb) {
+    assert(id >= 0 && id < static_cast<int>(nodes_.size()));
+    TimerNode* node = &nodes_[id];
+    if(node->active) {
+        Unlink_(node);
+    } else {
+        node->active = true;
+        count_++;
+    }
+    node->expires = Now_() + timeOut;
+    if(node->expires <= current_) node->expires = current_ + 1;
+    node->cb = cb;
+    Insert_(node);
+}
+
+void TimeWheel::adjust(int id, int newExpires) {
+    assert(id >= 0 && id < static_cast<int>(nodes_.size()) && nodes_[id].active);
+    TimerNode* node = &nodes_[id];
+    Unlink_(node);
+    node->expires = Now_() + newExpires;
+    if(node->expires <= current_) node->expires = current_ + 1;
+    Insert_(node);
+}
+
+// 立即触发回调并删除
+void TimeWheel::doWork(int id) {
+    if(id < 0 || id >= static_cast<int>(nodes_.size()) || !nodes_[id].active) return;
+    TimerNode* node = &nodes_[id];
+    Unlink_(node);
+    node->active = false;
+    count_--;
+    TimeoutCallBack cb = std::move(node->cb);
+    node->cb = nullptr;
+    if(cb) cb();
+}
+
+// 删除但不触发回调
+void TimeWheel::del(int id) {
+    if(id < 0 || id >= static_cast<int>(nodes_.size()) || !nodes_[id].active) return;
+    TimerNode* node = &nodes_[id];
+    Unlink_(node);
+    node->active = false;
+    node->cb = nullptr;
+    count_--;
+}
+
+void TimeWheel::clear() {
+    for(auto& node : nodes_) {
+        node.prev = node.next = nullptr;
+        node.active = false;
+        node.cb = nullptr;
+    }
+    for(int l = 0; l < LEVELS; l++) {
+        for(int s = 0; s < WHEEL_SIZE; s++) {
+            wheel_[l][s].prev = wheel_[l][s].next = &wheel_[l][s];
+        }
+        bitmap_[l] = 0;
+    }
+    count_ = 0;
+}
+
+void TimeWheel::tick() {
+    Advance_(Now_());
+}
+
+int TimeWheel::GetNextTick() {
+    tick();
+    if(count_ == 0) return -1;
+    int64_t res = NextEventTime_() - Now_();
+    if(res < 0) res = 0;
+    //返回最小剩余时间（可能是一次降级而不是真正到期，早醒一次无妨）
+    return static_cast<int>(res);
+}
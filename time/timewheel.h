@@ -0,0 +1,63 @@
+#ifndef TIME_WHEEL_H
+#define TIME_WHEEL_H
+
+#include <vector>
+#include <functional>
+#include <assert.h>
+#include <stdint.h>
+#include "cachedclock.h"
+
+// 分层时间轮，替代HeapTimer，接口保持 add/adjust/doWork/tick/GetNextTick 不变。
+// 精度1ms，4层x64槽覆盖约4.6小时，更远的超时先挂在最高层，降级时重新计算。
+// 定时节点是侵入式双向链表节点，按id(fd)预分配，与连接槽一一对应：
+// 添加、刷新、删除都是O(1)的摘链/挂链，不需要哈希查找和堆调整；过期在每次tick里一次扫完。
+// 当前时间取自CachedClock，由事件循环在epoll_wait返回后刷新
+class TimeWheel {
+public:
+    typedef std::function<void()> TimeoutCallBack;
+
+    explicit TimeWheel(int maxId = 65536);
+    ~TimeWheel() { clear(); }
+
+    void adjust(int id, int newExpires);
+    void add(int id, int timeOut, const TimeoutCallBack& cb);
+    void doWork(int id);
+    void del(int id);
+    void clear();
+    void tick();
+    int GetNextTick();
+
+private:
+    static const int WHEEL_BITS = 6;
+    static const int WHEEL_SIZE = 1 << WHEEL_BITS;
+    static const int WHEEL_MASK = WHEEL_SIZE - 1;
+    static const int LEVELS = 4;
+    static const int64_t MAX_SPAN = 1LL << (WHEEL_BITS * LEVELS);
+
+    struct TimerNode {
+        int id;
+        int64_t expires;        // 到期时刻(ms)
+        TimeoutCallBack cb;
+        TimerNode* prev;
+        TimerNode* next;
+        int level;
+        int slot;
+        bool active;
+    };
+
+    int64_t Now_() const;
+    void Insert_(TimerNode* node);
+    void Unlink_(TimerNode* node);
+    void Cascade_(int level, int slot);
+    int64_t NextEventTime_() const;
+    void Advance_(int64_t target);
+
+    std::vector<TimerNode> nodes_;
+    TimerNode wheel_[LEVELS][WHEEL_SIZE];   // 每个槽一个哨兵节点，循环链表
+    uint64_t bitmap_[LEVELS];               // 非空槽位图，用于快速找下一个到期点
+    int64_t current_;                       // 已处理到的时刻
+    size_t count_;
+    int64_t baseMs_;
+};
+
+#endif //TIME_WHEEL_H